@@ -32,14 +32,23 @@ struct sched_param explicit_param;
 //#define MAX (0xFFFFFFFFULL)                  // primes between 0 and 2^32-1
 //#define MAX (0xFFFFFFFFFFFFFFFFULL)          // primes between 0 and 2^64-1
 #define CODE_LENGTH ((sizeof(unsigned char))*8ULL)
+#define WORD_LENGTH ((sizeof(unsigned long long int))*8ULL)
 //#define SCHED_POLICY SCHED_RR
 //#define SCHED_POLICY SCHED_FIFO
 #define SCHED_POLICY SCHED_OTHER
 
 
+// Mode may also be chosen with -D on the command line, see erast_seq in the Makefile
+#if !defined(THREAD_GRID_INVALIDATE) && !defined(SEQUENTIAL_INVALIDATE) && !defined(SEQUENTIAL_GRID_INVALIDATE)
 #define THREAD_GRID_INVALIDATE
 //#define SEQUENTIAL_INVALIDATE
 //#define SEQUENTIAL_GRID_INVALIDATE
+#endif
+
+// Bitmap update backend, striped semaphores by default. ATOMIC_ISPRIME sets and clears bits with relaxed
+// __atomic_fetch_or/__atomic_fetch_and on 64-bit words instead, no locks. Works with any of the modes above,
+// see erast_atomic in the Makefile and erast_contention for how the backends compare.
+//#define ATOMIC_ISPRIME
 
 //unsigned char isprime[(MAX/(CODE_LENGTH))+1];
 unsigned char *isprime;
@@ -88,6 +97,33 @@ void set_scheduler(void)
 }
 
 
+#if defined(ATOMIC_ISPRIME)
+
+// Word i/64 bit i%64 is byte i/8 bit i%8 only on little endian, so with atomics the bitmap is always read and
+// written as words
+int chk_isprime(unsigned long long int i)
+{
+    unsigned long long int *word = ((unsigned long long int *)isprime) + i/(WORD_LENGTH);
+
+    return((__atomic_load_n(word, __ATOMIC_RELAXED) >> (i % (WORD_LENGTH))) & 1);
+}
+
+int set_isprime(unsigned long long int i, unsigned char val)
+{
+    unsigned long long int *word = ((unsigned long long int *)isprime) + i/(WORD_LENGTH);
+    unsigned int bitpos = i % (WORD_LENGTH);
+
+    // Relaxed is enough, the join after each prime orders the updates for the next one
+    if(val > 0)
+        __atomic_fetch_or(word, (1ULL<<bitpos), __ATOMIC_RELAXED);
+    else
+        __atomic_fetch_and(word, ~(1ULL<<bitpos), __ATOMIC_RELAXED);
+
+    return bitpos;
+}
+
+#else
+
 int chk_isprime(unsigned long long int i)
 {
     unsigned long long int idx;
@@ -129,6 +165,8 @@ int set_isprime(unsigned long long int i, unsigned char val)
     return bitpos;
 }
 
+#endif
+
 
 void print_isprime(void)
 {
@@ -163,10 +201,15 @@ void *invalidate_thread(void *threadptr)
 
 int main(void)
 {
-        unsigned long long int i, j, final_thread_j;
+        unsigned long long int i, j;
         unsigned long long int p=2;
         unsigned int cnt=0;
+#if !defined(SEQUENTIAL_INVALIDATE)
         unsigned long long int thread_idx=0;
+#endif
+#if defined(THREAD_GRID_INVALIDATE)
+        unsigned long long int final_thread_j;
+#endif
         double fstart, fnow;
         struct timespec start, now;
 
@@ -184,7 +227,11 @@ int main(void)
 
         set_scheduler();
 	
+#if defined(ATOMIC_ISPRIME)
+        if(!((isprime=malloc((size_t)((MAX/(WORD_LENGTH))+1)*sizeof(unsigned long long int))) > 0))
+#else
         if(!((isprime=malloc((size_t)(MAX/(CODE_LENGTH))+1)) > 0))
+#endif
         {
             perror("malloc");
             exit(-1);
@@ -229,7 +276,11 @@ int main(void)
 
         // Not prime by definition
         // 0 & 1 not prime, 2 is prime, 3 is prime, assume others prime to start
+#if defined(ATOMIC_ISPRIME)
+        set_isprime(0, 0); set_isprime(1, 0);
+#else
         isprime[0]=0xFC; 
+#endif
         for(i=2; i<MAX; i++) { set_isprime(i, 1); }
   
         //for(i=0; i<MAX; i++) { printf("isprime=%d\n", chk_isprime(i)); }
@@ -320,6 +371,7 @@ int main(void)
 	clock_gettime(CLOCK_MONOTONIC, &now);
 	fnow = (double)now.tv_sec  + (double)now.tv_nsec / 1000000000.0;
 	printf("start test at %lf for %llu numbers with %u numbers per second\n", fnow-fstart, MAX, (unsigned int)(MAX / (fnow-fstart)));
+        printf("%u primes per second\n", (unsigned int)(cnt / (fnow-fstart)));
         printf("\nNumber of primes [0..%llu]=%u\n\n", MAX, cnt);
 
 }
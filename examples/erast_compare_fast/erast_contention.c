@@ -0,0 +1,277 @@
+// Bitmap update contention benchmark for erast
+//
+// Runs the erast sieve, clearing multiples of each prime p <= sqrt(max), with 1 to N threads and four ways of
+// keeping concurrent bit clears from losing each other's updates:
+//
+//   sem        - a sem_t per 64-bit word index mod NUM_LOCKS, so every bit of a word is under one lock
+//   mutex      - the same striping with pthread mutexes
+//   atomic     - relaxed __atomic_fetch_and on the 64-bit word holding the bit (erast -DATOMIC_ISPRIME)
+//   partition  - each thread owns a contiguous run of words and clears every multiple in it, no synchronization
+//
+// The first three use the THREAD_GRID_INVALIDATE split, thread t clears 2p + t*p in steps of threads*p, so all
+// threads write all over the bitmap. Every backend's prime count is checked against pi(max), from a table for
+// powers of ten or a plain sequential sieve otherwise, so a lost update shows up as a wrong count.
+//
+// Usage: erast_contention [max [threads]]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <time.h>
+
+#define MAX (10000000ULL)                    // primes between 0 and 10 million, the locked backends are slow
+#define MAX_THREADS (64)
+#define NUM_LOCKS (16)
+#define WORD_LENGTH (64ULL)
+
+typedef enum
+{
+    BACKEND_SEM,
+    BACKEND_MUTEX,
+    BACKEND_ATOMIC,
+    BACKEND_PARTITION,
+    NUM_BACKENDS
+} backend_t;
+
+const char *backend_name[NUM_BACKENDS] = {"sem", "mutex", "atomic", "partition"};
+
+typedef struct
+{
+    int thread_idx;
+} threadArgsType;
+
+unsigned long long int max, words;
+unsigned long long int *isprime;
+unsigned long long int *primes;
+unsigned int num_primes;
+int num_threads;
+backend_t backend;
+
+sem_t sem_stripe[NUM_LOCKS];
+pthread_mutex_t mutex_stripe[NUM_LOCKS];
+
+
+// Locks stripe over word indices, the unit of the read-modify-write
+static void clear_sem(unsigned long long int i)
+{
+    sem_t *sem = &sem_stripe[(i / WORD_LENGTH) % NUM_LOCKS];
+
+    sem_wait(sem);
+    isprime[i / WORD_LENGTH] &= ~(1ULL << (i % WORD_LENGTH));
+    sem_post(sem);
+}
+
+
+static void clear_mutex(unsigned long long int i)
+{
+    pthread_mutex_t *mutex = &mutex_stripe[(i / WORD_LENGTH) % NUM_LOCKS];
+
+    pthread_mutex_lock(mutex);
+    isprime[i / WORD_LENGTH] &= ~(1ULL << (i % WORD_LENGTH));
+    pthread_mutex_unlock(mutex);
+}
+
+
+static void clear_atomic(unsigned long long int i)
+{
+    __atomic_fetch_and(&isprime[i / WORD_LENGTH], ~(1ULL << (i % WORD_LENGTH)), __ATOMIC_RELAXED);
+}
+
+
+void *invalidate_thread(void *threadptr)
+{
+    threadArgsType *thargs = (threadArgsType *)threadptr;
+    unsigned long long int j, p, lo, hi;
+    unsigned int k;
+
+    if(backend == BACKEND_PARTITION)
+    {
+        // Whole words per thread so no two threads share one
+        lo = (words * thargs->thread_idx / num_threads) * WORD_LENGTH;
+        hi = (words * (thargs->thread_idx + 1) / num_threads) * WORD_LENGTH;
+        if(hi > max + 1) hi = max + 1;
+
+        for(k=0; k < num_primes; k++)
+        {
+            p = primes[k];
+            j = (lo + p - 1) / p * p;
+            if(j < 2*p) j = 2*p;
+            for(; j < hi; j += p)
+                isprime[j / WORD_LENGTH] &= ~(1ULL << (j % WORD_LENGTH));
+        }
+        return NULL;
+    }
+
+    for(k=0; k < num_primes; k++)
+    {
+        p = primes[k];
+        for(j=(2 + thargs->thread_idx)*p; j <= max; j += num_threads*p)
+        {
+            switch(backend)
+            {
+                case BACKEND_SEM: clear_sem(j); break;
+                case BACKEND_MUTEX: clear_mutex(j); break;
+                default: clear_atomic(j); break;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+
+// Primes up to sqrt(max) by a plain sequential sieve
+static void base_primes(void)
+{
+    unsigned long long int limit = 1, i, j;
+    unsigned char *composite;
+
+    while((limit + 1) * (limit + 1) <= max)
+        limit++;
+
+    composite = calloc(limit + 1, 1);
+    primes = malloc((limit + 1) * sizeof(unsigned long long int));
+    if(composite == NULL || primes == NULL)
+    {
+        perror("malloc");
+        exit(-1);
+    }
+
+    for(i=2; i <= limit; i++)
+    {
+        if(composite[i]) continue;
+        primes[num_primes++] = i;
+        for(j=i*i; j <= limit; j += i)
+            composite[j] = 1;
+    }
+    free(composite);
+}
+
+
+// pi(max), known values for powers of ten, otherwise counted with a sequential byte sieve independent of the
+// backends
+static unsigned long long int reference_count(void)
+{
+    static const unsigned long long int known[][2] = {
+        {10ULL, 4ULL}, {100ULL, 25ULL}, {1000ULL, 168ULL}, {10000ULL, 1229ULL}, {100000ULL, 9592ULL},
+        {1000000ULL, 78498ULL}, {10000000ULL, 664579ULL}, {100000000ULL, 5761455ULL},
+        {1000000000ULL, 50847534ULL}, {10000000000ULL, 455052511ULL}};
+    unsigned long long int i, j, cnt = 0;
+    unsigned char *composite;
+
+    for(i=0; i < sizeof(known) / sizeof(known[0]); i++)
+        if(known[i][0] == max)
+            return known[i][1];
+
+    if((composite = calloc(max + 1, 1)) == NULL)
+    {
+        perror("calloc");
+        exit(-1);
+    }
+    for(i=2; i <= max; i++)
+    {
+        if(composite[i]) continue;
+        cnt++;
+        for(j=i*i; j <= max; j += i)
+            composite[j] = 1;
+    }
+    free(composite);
+    return cnt;
+}
+
+
+static unsigned long long int count_primes(void)
+{
+    unsigned long long int cnt = 0, w;
+
+    for(w=0; w < words; w++)
+        cnt += __builtin_popcountll(isprime[w]);
+    return cnt;
+}
+
+
+int main(int argc, char *argv[])
+{
+    pthread_t threads[MAX_THREADS];
+    threadArgsType threadarg[MAX_THREADS];
+    int max_threads = 4, idx;
+    unsigned long long int cnt, expect;
+    double fstart, fnow, elapsed;
+    struct timespec start, now;
+
+    max = MAX;
+    if(argc > 1) max = strtoull(argv[1], NULL, 0);
+    if(argc > 2) max_threads = atoi(argv[2]);
+    if(max_threads < 1 || max_threads > MAX_THREADS || max < 2)
+    {
+        printf("Usage: erast_contention [max [threads]], threads 1..%d\n", MAX_THREADS);
+        exit(-1);
+    }
+
+    words = max / WORD_LENGTH + 1;
+    if((isprime = malloc(words * sizeof(unsigned long long int))) == NULL)
+    {
+        perror("malloc");
+        exit(-1);
+    }
+    base_primes();
+    expect = reference_count();
+
+    for(idx=0; idx < NUM_LOCKS; idx++)
+    {
+        if(sem_init(&sem_stripe[idx], 0, 1))
+        {
+            perror("sem_init");
+            exit(-1);
+        }
+        pthread_mutex_init(&mutex_stripe[idx], NULL);
+    }
+
+    printf("%llu numbers, %u sieving primes, %d lock stripes, seconds and numbers per second\n", max, num_primes,
+           NUM_LOCKS);
+    printf("%-10s %7s %8s %14s\n", "backend", "threads", "sec", "numbers/sec");
+
+    for(backend=0; backend < NUM_BACKENDS; backend++)
+    {
+        for(num_threads=1; num_threads <= max_threads; num_threads++)
+        {
+            // 0 and 1 are not prime, bits past max stay clear
+            memset(isprime, 0xFF, words * sizeof(unsigned long long int));
+            isprime[0] &= ~3ULL;
+            if((max + 1) % WORD_LENGTH)
+                isprime[words - 1] &= (1ULL << ((max + 1) % WORD_LENGTH)) - 1;
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            fstart = (double)start.tv_sec  + (double)start.tv_nsec / 1000000000.0;
+
+            for(idx=0; idx < num_threads; idx++)
+            {
+                threadarg[idx].thread_idx = idx;
+                if(pthread_create(&threads[idx], NULL, invalidate_thread, &threadarg[idx]) != 0)
+                {
+                    perror("pthread_create");
+                    exit(-1);
+                }
+            }
+            for(idx=0; idx < num_threads; idx++)
+                pthread_join(threads[idx], NULL);
+
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            fnow = (double)now.tv_sec  + (double)now.tv_nsec / 1000000000.0;
+            elapsed = fnow - fstart;
+
+            cnt = count_primes();
+            printf("%-10s %7d %8.3lf %14.0lf%s\n", backend_name[backend], num_threads, elapsed, max / elapsed,
+                   cnt == expect ? "" : "  WRONG COUNT");
+        }
+    }
+
+    printf("\nNumber of primes [0..%llu]=%llu\n\n", max, expect);
+
+    free(isprime);
+    free(primes);
+    return 0;
+}
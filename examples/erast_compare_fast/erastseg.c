@@ -0,0 +1,111 @@
+// Segmented parallel sieve of Eratosthenes, compare with erast
+//
+// erast clears one bit at a time under a semaphore and every thread strides the whole bitmap for each prime.
+// Here the wheel-30 bitmap from sievelib is split into L2 sized segments, each sieved start to finish by one worker
+// of a persistent pool, so there are no locks and each byte is touched while it is in cache.
+//
+// The run is repeated for 1 up to the given number of threads and the count is checked against the known value of
+// pi(max) for powers of 10 and 2^32-1. Build erast and erast_seq with the same MAX to compare numbers and primes
+// per second with the THREAD_GRID_INVALIDATE and SEQUENTIAL_INVALIDATE modes, or use make compare.
+//
+// With a sieve file the final sieve is saved with its rank index for sieveq to answer queries from.
+//
+// Usage: erastseg [max [threads [sieve_file]]]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "sievelib.h"
+
+#define MAX (100000000ULL)                   // primes between 0 and 100 million, as erast
+
+typedef struct
+{
+    unsigned long long int max;
+    unsigned long long int count;
+} known_count_t;
+
+known_count_t known[] =
+{
+    {1000000ULL, 78498ULL},
+    {10000000ULL, 664579ULL},
+    {100000000ULL, 5761455ULL},
+    {1000000000ULL, 50847534ULL},
+    {0xFFFFFFFFULL, 203280221ULL}
+};
+
+
+int main(int argc, char *argv[])
+{
+    unsigned long long int max = MAX;
+    const char *sieve_path = NULL;
+    int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN), threads;
+    unsigned int idx;
+    double fstart, fnow;
+    struct timespec start, now;
+    sieve_pool_t *pool;
+    sieve_t sieve;
+
+    if(argc > 1) max = strtoull(argv[1], NULL, 0);
+    if(argc > 2) nthreads = atoi(argv[2]);
+    if(argc > 3) sieve_path = argv[3];
+    if(nthreads < 1) nthreads = 1;
+    if(max > SIEVE_MAX_LIMIT)
+    {
+        printf("max must be at most %llu\n", SIEVE_MAX_LIMIT);
+        exit(-1);
+    }
+
+    printf("segmented sieve for %llu numbers, %d byte segments of %d numbers\n", max, SIEVE_SEGMENT_BYTES,
+           SIEVE_SEGMENT_BYTES * 30);
+
+    for(threads=1; threads <= nthreads; threads++)
+    {
+        if((pool = sieve_pool_create(threads)) == NULL)
+        {
+            printf("Error creating %d sieve threads\n", threads);
+            exit(-1);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        fstart = (double)start.tv_sec  + (double)start.tv_nsec / 1000000000.0;
+
+        if(sieve_run(pool, &sieve, max) < 0)
+        {
+            perror("sieve_run");
+            exit(-1);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        fnow = (double)now.tv_sec  + (double)now.tv_nsec / 1000000000.0;
+        printf("%d threads: %lf sec for %llu numbers with %.0lf numbers per second, %.0lf primes per second\n",
+               threads, fnow-fstart, max, max / (fnow-fstart), sieve.count / (fnow-fstart));
+
+        if(threads == nthreads)
+        {
+            printf("\nNumber of primes [0..%llu]=%llu\n", max, (unsigned long long)sieve.count);
+            for(idx=0; idx < sizeof(known) / sizeof(known[0]); idx++)
+            {
+                if(known[idx].max == max)
+                    printf("%s, pi(%llu)=%llu\n", known[idx].count == sieve.count ? "verified" : "MISMATCH",
+                           max, known[idx].count);
+            }
+            printf("\n");
+
+            if(sieve_path)
+            {
+                if(sieve_save(&sieve, sieve_path) < 0)
+                    perror(sieve_path);
+                else
+                    printf("saved %s\n\n", sieve_path);
+            }
+        }
+
+        sieve_free(&sieve);
+        sieve_pool_destroy(pool);
+    }
+
+    return 0;
+}
@@ -0,0 +1,557 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sievelib.h"
+
+const uint8_t sieve_wheel[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+
+// Bit of each residue mod 30 in a byte, -1 for residues sharing a factor with 30
+static const int8_t wheel_bit[30] =
+{
+    -1, 0, -1, -1, -1, -1, -1, 1, -1, -1, -1, 2, -1, 3, -1, -1, -1, 4, -1, 5, -1, -1, -1, 6, -1, -1, -1, -1, -1, 7
+};
+
+// A sieving prime p >= 7 crosses off p*q for every q >= p coprime to 30. Splitting q by its residue w mod 30,
+// q = 30t + w gives p*q = 30*p*t + p*w: byte p*t + (p*w)/30, always the same bit. So each prime is 8 progressions
+// of stride p bytes, one per wheel residue, each clearing one fixed bit.
+typedef struct
+{
+    uint32_t p;
+    uint32_t first[8];
+    uint8_t mask[8];
+} sieve_prime_t;
+
+// On disk header of a sieve file, followed by blocks uint32_t ranks then bytes of bitmap
+#define SIEVE_MAGIC "SIEVE30"
+#define SIEVE_VERSION (1)
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t rank_bits;
+    uint64_t max;
+    uint64_t bytes;
+    uint64_t blocks;
+    uint64_t count;
+} sieve_header_t;
+
+struct sieve_pool
+{
+    int nthreads;
+    pthread_t *threads;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned int generation;
+    int active;
+    int quit;
+
+    // Current job, segments are claimed with an atomic add on next
+    sieve_t *sieve;
+    const sieve_prime_t *primes;
+    int nprimes;
+    uint64_t next;
+};
+
+
+static uint64_t popcount_bytes(const uint8_t *bits, uint64_t n)
+{
+    uint64_t k, count = 0;
+
+    for(k=0; k + 8 <= n; k += 8)
+    {
+        uint64_t word;
+
+        memcpy(&word, bits + k, sizeof(word));
+        count += __builtin_popcountll(word);
+    }
+    for(; k < n; k++)
+        count += __builtin_popcount(bits[k]);
+
+    return count;
+}
+
+
+// Bits of a byte for residues <= r
+static uint8_t wheel_le_mask(unsigned int r)
+{
+    uint8_t mask = 0;
+    int j;
+
+    for(j=0; j < 8; j++)
+        if(sieve_wheel[j] <= r)
+            mask |= 1 << j;
+    return mask;
+}
+
+
+static void sieve_segment(const sieve_t *sieve, const sieve_prime_t *primes, int nprimes, uint64_t seg)
+{
+    uint64_t k0 = seg * SIEVE_SEGMENT_BYTES, k1 = k0 + SIEVE_SEGMENT_BYTES, k;
+    uint8_t *bits = sieve->bits + k0;
+    int i, j;
+
+    if(k1 > sieve->bytes) k1 = sieve->bytes;
+    memset(bits, 0xFF, k1 - k0);
+
+    for(i=0; i < nprimes; i++)
+    {
+        uint64_t p = primes[i].p;
+
+        // Primes are ascending and p*p is the first multiple crossed off, the rest start past this segment
+        if(p * p / 30 >= k1)
+            break;
+
+        for(j=0; j < 8; j++)
+        {
+            uint8_t mask = primes[i].mask[j];
+
+            k = primes[i].first[j];
+            if(k < k0)
+                k += ((k0 - k + p - 1) / p) * p;
+            for(; k < k1; k += p)
+                sieve->bits[k] &= mask;
+        }
+    }
+
+    // 1 is not prime, and the last byte may run past max
+    if(k0 == 0)
+        bits[0] &= 0xFE;
+    if(k1 == sieve->bytes)
+    {
+        uint64_t base = (sieve->bytes - 1) * 30;
+
+        for(j=0; j < 8; j++)
+            if(base + sieve_wheel[j] > sieve->max)
+                sieve->bits[sieve->bytes - 1] &= ~(1 << j);
+    }
+
+    sieve->segment_count[seg] = (uint32_t)popcount_bytes(bits, k1 - k0);
+}
+
+
+static void *sieve_worker(void *arg)
+{
+    sieve_pool_t *pool = (sieve_pool_t *)arg;
+    unsigned int seen = 0;
+    uint64_t seg;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while(!pool->quit && pool->generation == seen)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if(pool->quit)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        while((seg = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) < pool->sieve->segments)
+            sieve_segment(pool->sieve, pool->primes, pool->nprimes, seg);
+
+        pthread_mutex_lock(&pool->lock);
+        if(--pool->active == 0)
+            pthread_cond_signal(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+
+sieve_pool_t *sieve_pool_create(int nthreads)
+{
+    sieve_pool_t *pool;
+    int i;
+
+    if(nthreads <= 0)
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(nthreads <= 0)
+        nthreads = 1;
+
+    if((pool = calloc(1, sizeof(*pool))) == NULL)
+        return NULL;
+    if((pool->threads = calloc(nthreads, sizeof(pthread_t))) == NULL)
+    {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for(i=0; i < nthreads; i++)
+    {
+        if(pthread_create(&pool->threads[i], NULL, sieve_worker, pool) != 0)
+        {
+            perror("pthread_create");
+            pool->nthreads = i;
+            sieve_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    pool->nthreads = nthreads;
+
+    return pool;
+}
+
+
+void sieve_pool_destroy(sieve_pool_t *pool)
+{
+    int i;
+
+    if(pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(i=0; i < pool->nthreads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool);
+}
+
+
+int sieve_pool_threads(const sieve_pool_t *pool)
+{
+    return pool->nthreads;
+}
+
+
+// Sieving primes 7..limit by a plain byte sieve, limit is at most 65535
+static int base_primes(uint32_t limit, sieve_prime_t **out)
+{
+    uint8_t *composite;
+    sieve_prime_t *primes;
+    uint32_t i, j;
+    int n = 0, w;
+
+    if((composite = calloc(limit + 1, 1)) == NULL)
+        return -1;
+    if((primes = calloc(limit / 2 + 1, sizeof(sieve_prime_t))) == NULL)
+    {
+        free(composite);
+        return -1;
+    }
+
+    for(i=2; i * i <= limit; i++)
+        if(!composite[i])
+            for(j=i*i; j <= limit; j += i)
+                composite[j] = 1;
+
+    for(i=7; i <= limit; i++)
+    {
+        if(composite[i])
+            continue;
+
+        primes[n].p = i;
+        for(w=0; w < 8; w++)
+        {
+            uint32_t r = sieve_wheel[w], t0 = (i > r) ? (i - r + 29) / 30 : 0;
+
+            primes[n].first[w] = i * t0 + (i * r) / 30;
+            primes[n].mask[w] = (uint8_t)~(1 << wheel_bit[(i * r) % 30]);
+        }
+        n++;
+    }
+
+    free(composite);
+    *out = primes;
+    return n;
+}
+
+
+int sieve_run(sieve_pool_t *pool, sieve_t *sieve, uint64_t max)
+{
+    sieve_prime_t *primes;
+    uint32_t limit = 1;
+    int nprimes;
+    uint64_t seg;
+
+    memset(sieve, 0, sizeof(*sieve));
+    if(max > SIEVE_MAX_LIMIT)
+        return -1;
+
+    while((uint64_t)(limit + 1) * (limit + 1) <= max)
+        limit++;
+
+    sieve->max = max;
+    sieve->bytes = max / 30 + 1;
+    sieve->segments = (sieve->bytes + SIEVE_SEGMENT_BYTES - 1) / SIEVE_SEGMENT_BYTES;
+    sieve->bits = malloc(sieve->bytes);
+    sieve->segment_count = malloc(sieve->segments * sizeof(uint32_t));
+    if(sieve->bits == NULL || sieve->segment_count == NULL || (nprimes = base_primes(limit, &primes)) < 0)
+    {
+        sieve_free(sieve);
+        return -1;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->sieve = sieve;
+    pool->primes = primes;
+    pool->nprimes = nprimes;
+    pool->next = 0;
+    pool->active = pool->nthreads;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    while(pool->active > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+
+    free(primes);
+
+    // 2, 3 and 5 are not in the wheel
+    sieve->count = (max >= 2) + (max >= 3) + (max >= 5);
+    for(seg=0; seg < sieve->segments; seg++)
+        sieve->count += sieve->segment_count[seg];
+
+    return 0;
+}
+
+
+void sieve_free(sieve_t *sieve)
+{
+    free(sieve->bits);
+    free(sieve->segment_count);
+    sieve->bits = NULL;
+    sieve->segment_count = NULL;
+}
+
+
+int sieve_is_prime(const sieve_t *sieve, uint64_t n)
+{
+    int bit;
+
+    if(n > sieve->max || n < 2)
+        return 0;
+    if(n == 2 || n == 3 || n == 5)
+        return 1;
+    if((bit = wheel_bit[n % 30]) < 0)
+        return 0;
+
+    return (sieve->bits[n / 30] >> bit) & 1;
+}
+
+
+int sieve_save(const sieve_t *sieve, const char *path)
+{
+    sieve_header_t header;
+    uint32_t *rank;
+    uint64_t b, count = 0;
+    FILE *fp;
+    int rc = 0;
+
+    memset(&header, 0, sizeof(header));
+    strcpy(header.magic, SIEVE_MAGIC);
+    header.version = SIEVE_VERSION;
+    header.rank_bits = SIEVE_RANK_BITS;
+    header.max = sieve->max;
+    header.bytes = sieve->bytes;
+    header.blocks = (sieve->bytes + SIEVE_RANK_BYTES - 1) / SIEVE_RANK_BYTES;
+    header.count = sieve->count;
+
+    if((rank = malloc(header.blocks * sizeof(uint32_t))) == NULL)
+        return -1;
+    for(b=0; b < header.blocks; b++)
+    {
+        uint64_t k0 = b * SIEVE_RANK_BYTES, n = SIEVE_RANK_BYTES;
+
+        if(k0 + n > sieve->bytes) n = sieve->bytes - k0;
+        rank[b] = (uint32_t)count;
+        count += popcount_bytes(sieve->bits + k0, n);
+    }
+
+    if((fp = fopen(path, "wb")) == NULL)
+    {
+        free(rank);
+        return -1;
+    }
+    if(fwrite(&header, sizeof(header), 1, fp) != 1 ||
+       fwrite(rank, sizeof(uint32_t), header.blocks, fp) != header.blocks ||
+       fwrite(sieve->bits, 1, sieve->bytes, fp) != sieve->bytes)
+        rc = -1;
+    if(fclose(fp) != 0)
+        rc = -1;
+
+    free(rank);
+    return rc;
+}
+
+
+int sieve_open(sieve_file_t *file, const char *path)
+{
+    const sieve_header_t *header;
+    struct stat st;
+    uint64_t bytes, blocks;
+    int fd;
+
+    memset(file, 0, sizeof(*file));
+
+    if((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0)
+    {
+        perror(path);
+        if(fd >= 0) close(fd);
+        return -1;
+    }
+    if((size_t)st.st_size < sizeof(sieve_header_t))
+    {
+        printf("%s: not a sieve file\n", path);
+        close(fd);
+        return -1;
+    }
+
+    file->map_len = st.st_size;
+    file->map = mmap(NULL, file->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(file->map == MAP_FAILED)
+    {
+        perror("mmap");
+        file->map = NULL;
+        return -1;
+    }
+
+    // The queries index the bitmap and ranks from max alone, so the layout is recomputed from max and the header and
+    // file size must both match it before anything past the header is trusted
+    header = (const sieve_header_t *)file->map;
+    bytes = header->max / 30 + 1;
+    blocks = (bytes + SIEVE_RANK_BYTES - 1) / SIEVE_RANK_BYTES;
+    if(memcmp(header->magic, SIEVE_MAGIC, sizeof(SIEVE_MAGIC)) != 0 || header->version != SIEVE_VERSION ||
+       header->rank_bits != SIEVE_RANK_BITS || header->max > SIEVE_MAX_LIMIT ||
+       header->bytes != bytes || header->blocks != blocks ||
+       (uint64_t)st.st_size != sizeof(sieve_header_t) + blocks * sizeof(uint32_t) + bytes)
+    {
+        printf("%s: not a sieve file or wrong version\n", path);
+        sieve_close(file);
+        return -1;
+    }
+
+    file->max = header->max;
+    file->bytes = header->bytes;
+    file->blocks = header->blocks;
+    file->count = header->count;
+    file->rank = (const uint32_t *)(header + 1);
+    file->bits = (const uint8_t *)(file->rank + file->blocks);
+
+    return 0;
+}
+
+
+void sieve_close(sieve_file_t *file)
+{
+    if(file->map)
+        munmap(file->map, file->map_len);
+    file->map = NULL;
+}
+
+
+uint64_t sieve_pi(const sieve_file_t *file, uint64_t n)
+{
+    uint64_t byte, block;
+
+    if(n > file->max) n = file->max;
+    if(n < 7)
+        return (n >= 2) + (n >= 3) + (n >= 5);
+
+    byte = n / 30;
+    block = byte / SIEVE_RANK_BYTES;
+
+    return 3 + file->rank[block] + popcount_bytes(file->bits + block * SIEVE_RANK_BYTES, byte % SIEVE_RANK_BYTES) +
+           __builtin_popcount(file->bits[byte] & wheel_le_mask(n % 30));
+}
+
+
+uint64_t sieve_range_count(const sieve_file_t *file, uint64_t a, uint64_t b)
+{
+    if(a > b)
+        return 0;
+    return sieve_pi(file, b) - (a > 0 ? sieve_pi(file, a - 1) : 0);
+}
+
+
+uint64_t sieve_nth(const sieve_file_t *file, uint64_t k)
+{
+    static const uint64_t small[3] = {2, 3, 5};
+    uint64_t lo = 0, hi = file->blocks - 1, byte, count;
+    int j;
+
+    if(k == 0 || k > file->count)
+        return 0;
+    if(k <= 3)
+        return small[k - 1];
+    k -= 3;
+
+    // Last block with fewer than k primes before it
+    while(lo < hi)
+    {
+        uint64_t mid = (lo + hi + 1) / 2;
+
+        if(file->rank[mid] < k) lo = mid;
+        else hi = mid - 1;
+    }
+
+    count = file->rank[lo];
+    for(byte=lo * SIEVE_RANK_BYTES; byte < file->bytes; byte++)
+    {
+        uint64_t pc = __builtin_popcount(file->bits[byte]);
+
+        if(count + pc >= k)
+        {
+            for(j=0; j < 8; j++)
+                if(((file->bits[byte] >> j) & 1) && ++count == k)
+                    return byte * 30 + sieve_wheel[j];
+        }
+        count += pc;
+    }
+
+    return 0;
+}
+
+
+uint64_t sieve_next(const sieve_file_t *file, uint64_t n)
+{
+    uint64_t byte;
+    uint8_t bits;
+    int j;
+
+    if(n <= 5)
+    {
+        uint64_t p = (n <= 2) ? 2 : (n <= 3) ? 3 : 5;
+
+        return (p <= file->max) ? p : 0;
+    }
+    if(n > file->max)
+        return 0;
+
+    // Residues >= n % 30 in the first byte, then whole bytes
+    byte = n / 30;
+    bits = file->bits[byte];
+    if(n % 30 > 0)
+        bits &= ~wheel_le_mask(n % 30 - 1);
+    while(bits == 0)
+    {
+        if(++byte >= file->bytes)
+            return 0;
+        bits = file->bits[byte];
+    }
+
+    for(j=0; !((bits >> j) & 1); j++);
+    return byte * 30 + sieve_wheel[j];
+}
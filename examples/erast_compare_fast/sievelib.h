@@ -0,0 +1,93 @@
+#ifndef SIEVELIB_H
+#define SIEVELIB_H
+
+#include <stdint.h>
+
+// Segmented sieve of Eratosthenes with wheel-30 packing.
+//
+// Multiples of 2, 3 and 5 are left out entirely: each byte holds the 8 numbers 30k+1, 7, 11, 13, 17, 19, 23
+// and 29, so the bitmap for MAX = 2^32 is 143 MB instead of 512 MB for one bit per number.
+//
+// The bitmap is cut into SIEVE_SEGMENT_BYTES segments that fit in L2. A worker claims a whole segment and
+// crosses off multiples of every sieving prime inside it before moving on, so each byte is written by exactly one
+// thread and while it is in cache, and no bit clear needs a lock.
+//
+#define SIEVE_SEGMENT_BYTES (128*1024)
+
+// Largest MAX supported, sieving primes and their squares must fit in 32 and 64 bits
+#define SIEVE_MAX_LIMIT (0xFFFFFFFFULL)
+
+typedef struct
+{
+    uint64_t max;
+    uint64_t bytes;
+    uint8_t *bits;
+
+    // Primes in each segment and in [0, max]
+    uint64_t segments;
+    uint32_t *segment_count;
+    uint64_t count;
+} sieve_t;
+
+typedef struct sieve_pool sieve_pool_t;
+
+// Persistent workers, 0 for one per online CPU. Returns NULL if they could not be created.
+sieve_pool_t *sieve_pool_create(int nthreads);
+
+void sieve_pool_destroy(sieve_pool_t *pool);
+
+int sieve_pool_threads(const sieve_pool_t *pool);
+
+// Sieve [0, max] into sieve, allocating its bitmap. Returns 0, or -1 if max is above SIEVE_MAX_LIMIT or the
+// bitmap could not be allocated.
+int sieve_run(sieve_pool_t *pool, sieve_t *sieve, uint64_t max);
+
+void sieve_free(sieve_t *sieve);
+
+int sieve_is_prime(const sieve_t *sieve, uint64_t n);
+
+// Residues mod 30 of the 8 bits of each byte, lowest bit first
+extern const uint8_t sieve_wheel[8];
+
+// Sieve file: a header, then a rank index holding the number of wheel primes before every SIEVE_RANK_BITS bits of
+// the bitmap, then the bitmap itself. It is mapped read only and pages in on demand, so the first query after
+// opening costs a few page faults rather than a re-sieve.
+#define SIEVE_RANK_BITS (4096)
+#define SIEVE_RANK_BYTES (SIEVE_RANK_BITS / 8)
+
+typedef struct
+{
+    uint64_t max;
+    uint64_t bytes;
+    uint64_t blocks;
+    uint64_t count;
+    const uint32_t *rank;
+    const uint8_t *bits;
+
+    void *map;
+    size_t map_len;
+} sieve_file_t;
+
+// Write a finished sieve with its rank index. Returns 0 or -1 with errno set.
+int sieve_save(const sieve_t *sieve, const char *path);
+
+// Map a file written by sieve_save. Returns 0, or -1 with a message on stdout.
+int sieve_open(sieve_file_t *file, const char *path);
+
+void sieve_close(sieve_file_t *file);
+
+// pi(n), the number of primes <= n, n above max is treated as max. O(1): one rank lookup and at most
+// SIEVE_RANK_BYTES of popcount.
+uint64_t sieve_pi(const sieve_file_t *file, uint64_t n);
+
+// Primes in [a, b]
+uint64_t sieve_range_count(const sieve_file_t *file, uint64_t a, uint64_t b);
+
+// The kth prime counting from 1 for 2, or 0 if k is 0 or above the count. O(log n): a binary search of the rank
+// index then a scan of one block.
+uint64_t sieve_nth(const sieve_file_t *file, uint64_t k);
+
+// Smallest prime >= n, or 0 if there is none up to max
+uint64_t sieve_next(const sieve_file_t *file, uint64_t n);
+
+#endif
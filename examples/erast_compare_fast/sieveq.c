@@ -0,0 +1,106 @@
+// Prime queries over a sieve file saved by erastseg
+//
+// The file is mapped rather than read, so nothing is sieved and only the pages a query touches are loaded. The time
+// from start to the first answer is the cold start, drop the page cache first (echo 3 > /proc/sys/vm/drop_caches)
+// to include reading from the device.
+//
+// Queries, any number of them in order:
+//   pi N        number of primes <= N
+//   nth K       Kth prime, nth 1 is 2
+//   range A B   number of primes in [A, B]
+//   list A B    the primes in [A, B]
+//
+// Usage: sieveq sieve_file query...
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sievelib.h"
+
+
+static double now_sec(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+
+static void usage(void)
+{
+    printf("Usage: sieveq sieve_file [pi N | nth K | range A B | list A B]...\n");
+    exit(-1);
+}
+
+
+int main(int argc, char *argv[])
+{
+    double fstart, fopened, fnow, flast;
+    unsigned long long int a, b, p, result;
+    sieve_file_t file;
+    int arg, first = 1;
+
+    if(argc < 2)
+        usage();
+
+    fstart = now_sec();
+    if(sieve_open(&file, argv[1]) < 0)
+        exit(-1);
+    fopened = flast = now_sec();
+
+    printf("%s: primes [0..%llu]=%llu, %llu rank blocks, mapped in %.3lf ms\n", argv[1],
+           (unsigned long long)file.max, (unsigned long long)file.count, (unsigned long long)file.blocks,
+           (fopened - fstart) * 1000.0);
+
+    for(arg=2; arg < argc; arg++)
+    {
+        if(strcmp(argv[arg], "pi") == 0 && arg + 1 < argc)
+        {
+            a = strtoull(argv[++arg], NULL, 0);
+            result = sieve_pi(&file, a);
+            printf("pi(%llu)=%llu", a, result);
+        }
+        else if(strcmp(argv[arg], "nth") == 0 && arg + 1 < argc)
+        {
+            a = strtoull(argv[++arg], NULL, 0);
+            if((result = sieve_nth(&file, a)) == 0)
+                printf("nth(%llu) is past the end of the sieve", a);
+            else
+                printf("nth(%llu)=%llu", a, result);
+        }
+        else if(strcmp(argv[arg], "range") == 0 && arg + 2 < argc)
+        {
+            a = strtoull(argv[++arg], NULL, 0);
+            b = strtoull(argv[++arg], NULL, 0);
+            result = sieve_range_count(&file, a, b);
+            printf("primes in [%llu, %llu]=%llu", a, b, result);
+        }
+        else if(strcmp(argv[arg], "list") == 0 && arg + 2 < argc)
+        {
+            a = strtoull(argv[++arg], NULL, 0);
+            b = strtoull(argv[++arg], NULL, 0);
+            printf("primes in [%llu, %llu]:", a, b);
+            for(p=sieve_next(&file, a); p != 0 && p <= b; p=sieve_next(&file, p + 1))
+                printf(" %llu", p);
+        }
+        else
+        {
+            sieve_close(&file);
+            usage();
+        }
+
+        fnow = now_sec();
+        printf("  (%.3lf ms", (fnow - flast) * 1000.0);
+        if(first)
+            printf(", cold start %.3lf ms", (fnow - fstart) * 1000.0);
+        printf(")\n");
+        flast = fnow;
+        first = 0;
+    }
+
+    sieve_close(&file);
+    return 0;
+}
@@ -1,4 +1,380 @@
 #include "raidtest.h"
+#include "raidparity.h"
+#include "raidstripe.h"
+
+// Parity engine throughput, data bytes XORed per (engine, stripe width) and the size of each block
+#define PERF_BYTES (64 * 1024 * 1024)
+#define PERF_BLOCK_SIZE (64 * 1024)
+#define PERF_MAX_WIDTH (16)
+
+static const int perfWidths[] = {4, 8, 16};
+
+// Striping throughput, an odd sized file so the last stripe is partial
+#define PERF_FILE_BYTES (64 * 1024 * 1024 + 12345)
+#define PERF_INPUT_FILE "perftest_input.bin"
+#define PERF_OUTPUT_FILE "perftest_output.bin"
+
+static const int perfChunkSizes[] = {4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024};
+
+// Rebuild and scrub scaling, chunk size and the most workers tried if there are fewer CPUs
+#define PERF_SCALE_CHUNK (256 * 1024)
+#define PERF_SCALE_MIN_THREADS (4)
+
+
+static double secondsSince(struct timeval *start)
+{
+    struct timeval now;
+
+    gettimeofday(&now, 0);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+
+// TEST CASE #2
+//
+// Parity over stripes of 4, 8 and 16 data blocks for every engine the CPU supports, reported as GB/s of data in.
+// Each result is compared with the byte engine.
+//
+void parityEngineTest(void)
+{
+    unsigned char *data[PERF_MAX_WIDTH], *ref, *parity;
+    struct timeval StartTime;
+    int idx, eng, w, width, iterations;
+    size_t byteIdx;
+    double secs;
+
+    for (idx = 0; idx < PERF_MAX_WIDTH; idx++)
+    {
+        data[idx] = malloc(PERF_BLOCK_SIZE);
+        assert(data[idx] != NULL);
+        for (byteIdx = 0; byteIdx < PERF_BLOCK_SIZE; byteIdx++)
+            data[idx][byteIdx] = (unsigned char)rand();
+    }
+    ref = malloc(PERF_BLOCK_SIZE);
+    parity = malloc(PERF_BLOCK_SIZE);
+    assert((ref != NULL) && (parity != NULL));
+
+    printf("\nParity Engine Performance Test, %d KB blocks, best engine %s\n", PERF_BLOCK_SIZE / 1024,
+        parityBestEngine()->name);
+    printf("%-8s", "engine");
+    for (w = 0; w < (int)(sizeof(perfWidths) / sizeof(perfWidths[0])); w++)
+        printf("  %2d+1 GB/s", perfWidths[w]);
+    printf("\n");
+
+    for (eng = 0; eng < parityNumEngines; eng++)
+    {
+        if (!parityEngines[eng].supported())
+            continue;
+
+        printf("%-8s", parityEngines[eng].name);
+        for (w = 0; w < (int)(sizeof(perfWidths) / sizeof(perfWidths[0])); w++)
+        {
+            width = perfWidths[w];
+            iterations = PERF_BYTES / (width * PERF_BLOCK_SIZE);
+
+            parityEngines[0].xorBlocks(ref, (const unsigned char *const *)data, width, PERF_BLOCK_SIZE);
+
+            gettimeofday(&StartTime, 0);
+            for (idx = 0; idx < iterations; idx++)
+                parityEngines[eng].xorBlocks(parity, (const unsigned char *const *)data, width, PERF_BLOCK_SIZE);
+            secs = secondsSince(&StartTime);
+
+            printf("  %9.2lf%s", ((double)iterations * width * PERF_BLOCK_SIZE) / secs / 1.0e9,
+                (memcmp(ref, parity, PERF_BLOCK_SIZE) == 0) ? " " : "!");
+        }
+        printf("\n");
+    }
+    printf("(! marks parity that differs from the byte engine)\n");
+
+    for (idx = 0; idx < PERF_MAX_WIDTH; idx++)
+        free(data[idx]);
+    free(ref);
+    free(parity);
+}
+
+
+// TEST CASE #3
+//
+// stripeFileV, verifyStripes and restoreFileV with chunk 2 missing for each chunk size, as MB/s of file data.
+// The restored file is compared with the input. Without O_DIRECT this mostly measures the page cache.
+//
+void stripeIOTest(int direct)
+{
+    unsigned char *input, *output;
+    struct timeval StartTime;
+    stripeConfig config;
+    double stripeSecs, verifySecs, rebuildSecs, mbytes = PERF_FILE_BYTES / 1.0e6;
+    long long idx, bad;
+    int c, fd, ok;
+
+    input = malloc(PERF_FILE_BYTES);
+    output = malloc(PERF_FILE_BYTES);
+    assert((input != NULL) && (output != NULL));
+    for (idx = 0; idx < PERF_FILE_BYTES; idx++)
+        input[idx] = (unsigned char)rand();
+
+    fd = open(PERF_INPUT_FILE, O_WRONLY | O_CREAT | O_TRUNC, 00644);
+    assert((fd >= 0) && (write(fd, input, PERF_FILE_BYTES) == PERF_FILE_BYTES));
+    close(fd);
+
+    printf("\nStriping I/O Performance Test, %d byte file%s\n", PERF_FILE_BYTES, direct ? ", O_DIRECT" : "");
+    printf("%8s %8s %12s %12s %12s\n", "chunk", "stripes", "stripe MB/s", "verify MB/s", "rebuild MB/s");
+
+    for (c = 0; c < (int)(sizeof(perfChunkSizes) / sizeof(perfChunkSizes[0])); c++)
+    {
+        config.chunkSize = perfChunkSizes[c];
+        config.stripesPerIO = 0;
+        config.direct = direct;
+        config.threads = 1;
+        config.raid6 = FALSE;
+
+        gettimeofday(&StartTime, 0);
+        if (stripeFileV(PERF_INPUT_FILE, &config) != PERF_FILE_BYTES)
+        {
+            printf("stripeFileV failed\n");
+            break;
+        }
+        stripeSecs = secondsSince(&StartTime);
+
+        gettimeofday(&StartTime, 0);
+        bad = verifyStripes(PERF_FILE_BYTES, 0, 0, &config);
+        verifySecs = secondsSince(&StartTime);
+
+        gettimeofday(&StartTime, 0);
+        if (restoreFileV(PERF_OUTPUT_FILE, PERF_FILE_BYTES, 2, 0, &config) != PERF_FILE_BYTES)
+        {
+            printf("restoreFileV failed\n");
+            break;
+        }
+        rebuildSecs = secondsSince(&StartTime);
+
+        fd = open(PERF_OUTPUT_FILE, O_RDONLY);
+        ok = (fd >= 0) && (read(fd, output, PERF_FILE_BYTES) == PERF_FILE_BYTES) &&
+             (memcmp(input, output, PERF_FILE_BYTES) == 0);
+        if (fd >= 0)
+            close(fd);
+
+        printf("%7dK %8d %12.1lf %12.1lf %12.1lf  %s%s\n", config.chunkSize / 1024, stripeBatch(&config),
+            mbytes / stripeSecs, mbytes / verifySecs, mbytes / rebuildSecs, (bad == 0) ? "parity ok" : "PARITY BAD",
+            ok ? ", rebuild ok" : ", REBUILD MISMATCH");
+    }
+
+    unlink(PERF_INPUT_FILE);
+    unlink(PERF_OUTPUT_FILE);
+    free(input);
+    free(output);
+}
+
+
+// TEST CASE #4
+//
+// Multi-threaded rebuild of chunk 3 and scrub for 1 up to one worker per CPU (at least PERF_SCALE_MIN_THREADS).
+// With the chunk files in the page cache this shows the CPU side scaling, with O_DIRECT where the devices saturate.
+//
+void rebuildScaleTest(int direct)
+{
+    unsigned char *input;
+    struct timeval StartTime;
+    stripeConfig config;
+    double rebuildSecs, scrubSecs, mbytes = PERF_FILE_BYTES / 1.0e6;
+    long long idx, bad, restored;
+    int fd, threads, maxThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (maxThreads < PERF_SCALE_MIN_THREADS)
+        maxThreads = PERF_SCALE_MIN_THREADS;
+
+    input = malloc(PERF_FILE_BYTES);
+    assert(input != NULL);
+    for (idx = 0; idx < PERF_FILE_BYTES; idx++)
+        input[idx] = (unsigned char)rand();
+    fd = open(PERF_INPUT_FILE, O_WRONLY | O_CREAT | O_TRUNC, 00644);
+    assert((fd >= 0) && (write(fd, input, PERF_FILE_BYTES) == PERF_FILE_BYTES));
+    close(fd);
+    free(input);
+
+    config.chunkSize = PERF_SCALE_CHUNK;
+    config.stripesPerIO = 0;
+    config.direct = direct;
+    config.threads = 1;
+    config.raid6 = FALSE;
+    assert(stripeFileV(PERF_INPUT_FILE, &config) == PERF_FILE_BYTES);
+
+    printf("\nRebuild and Scrub Scaling Test, %dK chunks, %ld online CPUs\n", PERF_SCALE_CHUNK / 1024,
+        sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%8s %12s %12s\n", "threads", "rebuild MB/s", "scrub MB/s");
+
+    for (threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        config.threads = threads;
+
+        gettimeofday(&StartTime, 0);
+        restored = restoreFileV(PERF_OUTPUT_FILE, PERF_FILE_BYTES, 3, 0, &config);
+        rebuildSecs = secondsSince(&StartTime);
+
+        gettimeofday(&StartTime, 0);
+        bad = verifyStripes(PERF_FILE_BYTES, 0, 0, &config);
+        scrubSecs = secondsSince(&StartTime);
+
+        printf("%8d %12.1lf %12.1lf  %s\n", threads, mbytes / rebuildSecs, mbytes / scrubSecs,
+            ((restored == PERF_FILE_BYTES) && (bad == 0)) ? "ok" : "FAILED");
+    }
+
+    unlink(PERF_INPUT_FILE);
+    unlink(PERF_OUTPUT_FILE);
+}
+
+
+// TEST CASE #5
+//
+// RAID-6 for every engine the CPU supports: P alone, P+Q, and rebuilding two lost data blocks from P and Q, as GB/s
+// of data in a PERF_RAID6_WIDTH + 2 stripe. The rebuilt blocks are compared with the originals.
+//
+#define PERF_RAID6_WIDTH (8)
+
+void raid6EngineTest(void)
+{
+    unsigned char *orig[PERF_RAID6_WIDTH + 2], *work[PERF_RAID6_WIDTH + 2];
+    struct timeval StartTime;
+    double pSecs, pqSecs, rebuildSecs, gbytes;
+    int idx, eng, iterations = PERF_BYTES / (PERF_RAID6_WIDTH * PERF_BLOCK_SIZE), ok;
+    size_t byteIdx;
+
+    for (idx = 0; idx < PERF_RAID6_WIDTH + 2; idx++)
+    {
+        orig[idx] = malloc(PERF_BLOCK_SIZE);
+        work[idx] = malloc(PERF_BLOCK_SIZE);
+        assert((orig[idx] != NULL) && (work[idx] != NULL));
+        for (byteIdx = 0; byteIdx < PERF_BLOCK_SIZE; byteIdx++)
+            orig[idx][byteIdx] = (unsigned char)rand();
+    }
+    gbytes = (double)iterations * PERF_RAID6_WIDTH * PERF_BLOCK_SIZE / 1.0e9;
+
+    printf("\nRAID-6 Performance Test, %d+2 stripe of %d KB blocks\n", PERF_RAID6_WIDTH, PERF_BLOCK_SIZE / 1024);
+    printf("%-8s %10s %10s %14s\n", "engine", "P GB/s", "P+Q GB/s", "2 lost GB/s");
+
+    for (eng = 0; eng < parityNumEngines; eng++)
+    {
+        if (paritySetEngine(parityEngines[eng].name) == ERROR)
+            continue;
+
+        gettimeofday(&StartTime, 0);
+        for (idx = 0; idx < iterations; idx++)
+            xorParity(orig[PERF_RAID6_WIDTH], (const unsigned char *const *)orig, PERF_RAID6_WIDTH, PERF_BLOCK_SIZE);
+        pSecs = secondsSince(&StartTime);
+
+        gettimeofday(&StartTime, 0);
+        for (idx = 0; idx < iterations; idx++)
+            pqParity(orig[PERF_RAID6_WIDTH], orig[PERF_RAID6_WIDTH + 1], (const unsigned char *const *)orig,
+                PERF_RAID6_WIDTH, PERF_BLOCK_SIZE);
+        pqSecs = secondsSince(&StartTime);
+
+        // Rebuild data blocks 1 and 5, the slowest case as it needs both syndromes
+        for (idx = 0; idx < PERF_RAID6_WIDTH + 2; idx++)
+            memcpy(work[idx], orig[idx], PERF_BLOCK_SIZE);
+        gettimeofday(&StartTime, 0);
+        for (idx = 0; idx < iterations; idx++)
+            pqRecover(work, PERF_RAID6_WIDTH, 1, 5, PERF_BLOCK_SIZE);
+        rebuildSecs = secondsSince(&StartTime);
+
+        for (idx = 0, ok = TRUE; idx < PERF_RAID6_WIDTH + 2; idx++)
+            ok = ok && (memcmp(work[idx], orig[idx], PERF_BLOCK_SIZE) == 0);
+
+        printf("%-8s %10.2lf %10.2lf %14.2lf  %s\n", parityEngines[eng].name, gbytes / pSecs, gbytes / pqSecs,
+            gbytes / rebuildSecs, ok ? "rebuild ok" : "REBUILD MISMATCH");
+    }
+    paritySetEngine(parityBestEngine()->name);
+
+    for (idx = 0; idx < PERF_RAID6_WIDTH + 2; idx++)
+    {
+        free(orig[idx]);
+        free(work[idx]);
+    }
+}
+
+
+// TEST CASE #6
+//
+// RAID-6 chunk files: stripe with the Q chunk, then restore with every pair of chunk files missing and compare with
+// the input, reporting MB/s for each pair. Then one byte of the Q chunk file is flipped and a scrub must find it,
+// with all chunks present and with one data chunk missing so only Q is left to check against.
+//
+#define PERF_RAID6_CHUNK (64 * 1024)
+
+void raid6FileTest(int direct)
+{
+    unsigned char *input, *output, byte;
+    struct timeval StartTime;
+    stripeConfig config;
+    double secs, mbytes = PERF_FILE_BYTES / 1.0e6;
+    long long idx, bad;
+    int a, b, fd, ok, allOk = TRUE;
+
+    input = malloc(PERF_FILE_BYTES);
+    output = malloc(PERF_FILE_BYTES);
+    assert((input != NULL) && (output != NULL));
+    for (idx = 0; idx < PERF_FILE_BYTES; idx++)
+        input[idx] = (unsigned char)rand();
+    fd = open(PERF_INPUT_FILE, O_WRONLY | O_CREAT | O_TRUNC, 00644);
+    assert((fd >= 0) && (write(fd, input, PERF_FILE_BYTES) == PERF_FILE_BYTES));
+    close(fd);
+
+    config.chunkSize = PERF_RAID6_CHUNK;
+    config.stripesPerIO = 0;
+    config.direct = direct;
+    config.threads = 0;
+    config.raid6 = TRUE;
+
+    gettimeofday(&StartTime, 0);
+    assert(stripeFileV(PERF_INPUT_FILE, &config) == PERF_FILE_BYTES);
+    secs = secondsSince(&StartTime);
+
+    printf("\nRAID-6 Chunk File Test, %dK chunks, 4 data + XOR + Q, stripe %.1lf MB/s\n", PERF_RAID6_CHUNK / 1024,
+        mbytes / secs);
+    printf("%-20s %-20s %12s\n", "lost", "lost", "rebuild MB/s");
+
+    for (a = 1; a <= STRIPE_CHUNKS; a++)
+    {
+        for (b = a + 1; b <= STRIPE_CHUNKS; b++)
+        {
+            memset(output, 0, PERF_FILE_BYTES);
+            gettimeofday(&StartTime, 0);
+            ok = (restoreFileV(PERF_OUTPUT_FILE, PERF_FILE_BYTES, a, b, &config) == PERF_FILE_BYTES);
+            secs = secondsSince(&StartTime);
+
+            fd = open(PERF_OUTPUT_FILE, O_RDONLY);
+            ok = ok && (fd >= 0) && (read(fd, output, PERF_FILE_BYTES) == PERF_FILE_BYTES) &&
+                 (memcmp(input, output, PERF_FILE_BYTES) == 0);
+            if (fd >= 0)
+                close(fd);
+            allOk = allOk && ok;
+
+            printf("%-20s %-20s %12.1lf  %s\n", stripeChunkNames[a - 1], stripeChunkNames[b - 1], mbytes / secs,
+                ok ? "rebuild ok" : "REBUILD MISMATCH");
+        }
+    }
+
+    // Corrupt one byte of Q in the second stripe
+    fd = open(stripeChunkNames[STRIPE_Q_CHUNK - 1], O_RDWR);
+    assert((fd >= 0) && (pread(fd, &byte, 1, PERF_RAID6_CHUNK + 100) == 1));
+    byte ^= 0x5a;
+    assert(pwrite(fd, &byte, 1, PERF_RAID6_CHUNK + 100) == 1);
+    close(fd);
+
+    bad = verifyStripes(PERF_FILE_BYTES, 0, 0, &config);
+    printf("scrub with Q corrupted: %lld bad stripe%s %s\n", bad, (bad == 1) ? "" : "s", (bad == 1) ? "ok" : "FAILED");
+    allOk = allOk && (bad == 1);
+    bad = verifyStripes(PERF_FILE_BYTES, 2, 0, &config);
+    printf("scrub with Q corrupted and chunk 2 missing: %lld bad stripe%s %s\n", bad, (bad == 1) ? "" : "s",
+        (bad == 1) ? "ok" : "FAILED");
+    allOk = allOk && (bad == 1);
+    printf("%s\n", allOk ? "RAID-6 chunk files ok" : "RAID-6 CHUNK FILES FAILED");
+
+    unlink(PERF_INPUT_FILE);
+    unlink(PERF_OUTPUT_FILE);
+    unlink(stripeChunkNames[STRIPE_Q_CHUNK - 1]);
+    free(input);
+    free(output);
+}
 
 
 int main(int argc, char *argv[])
@@ -72,4 +448,14 @@ int main(int argc, char *argv[])
     printf("%lf RAID ops computed per second\n", rate);
     //
     // END TEST CASE #1
+
+    parityEngineTest();
+
+    raid6EngineTest();
+
+    stripeIOTest((argc > 2) && (strcmp(argv[2], "direct") == 0));
+
+    rebuildScaleTest((argc > 2) && (strcmp(argv[2], "direct") == 0));
+
+    raid6FileTest((argc > 2) && (strcmp(argv[2], "direct") == 0));
 }
@@ -8,6 +8,7 @@
 #include <sys/types.h>
 
 #include "raidlib.h"
+#include "raidparity.h"
 
 #ifdef RAID64
 #include "raidlib64.h"
@@ -31,12 +32,13 @@
 // POST-CONDITIONS:
 // 1) Contents of PLBA is modified and contains the computed parity using XOR
 //
+// Uses the word wide parity engine, see raidparity.h for any other stripe width.
+//
 void xorLBA(unsigned char *LBA1, unsigned char *LBA2, unsigned char *LBA3, unsigned char *LBA4, unsigned char *PLBA)
 {
-    int idx;
+    const unsigned char *src[4] = {LBA1, LBA2, LBA3, LBA4};
 
-    for (idx = 0; idx < SECTOR_SIZE; idx++)
-        *(PLBA + idx) = (*(LBA1 + idx)) ^ (*(LBA2 + idx)) ^ (*(LBA3 + idx)) ^ (*(LBA4 + idx));
+    xorParity(PLBA, src, 4, SECTOR_SIZE);
 }
 
 
@@ -48,18 +50,43 @@ void xorLBA(unsigned char *LBA1, unsigned char *LBA2, unsigned char *LBA3, unsig
 //
 void rebuildLBA(unsigned char *LBA1, unsigned char *LBA2, unsigned char *LBA3, unsigned char *PLBA, unsigned char *RLBA)
 {
-    int idx;
-    unsigned char checkParity;
+    // Parity check word is simply XOR of remaining good LBAs, and the rebuilt
+    // LBA is the XOR of that with the original parity, so one XOR of all four
+    const unsigned char *src[4] = {LBA1, LBA2, LBA3, PLBA};
 
-    for (idx = 0; idx < SECTOR_SIZE; idx++)
-    {
-        // Parity check word is simply XOR of remaining good LBAs
-        checkParity = (*(LBA1 + idx)) ^ (*(LBA2 + idx)) ^ (*(LBA3 + idx));
+    xorParity(RLBA, src, 4, SECTOR_SIZE);
+}
 
-        // Rebuilt LBA is simply XOR of original parity and parity check word
-        // which will preserve original parity computed over the 4 LBAs
-        *(RLBA + idx) = (*(PLBA + idx)) ^ (checkParity);
-    }
+
+// RAID-6 encoding
+//
+// This is 66% capacity with 2/6 LBAs used for P (XOR) and Q (Reed-Solomon)
+// syndromes, see raidparity.h.
+//
+// Handles double faults.
+//
+// POST-CONDITIONS:
+// 1) Contents of PLBA and QLBA are modified and contain the P and Q syndromes
+//
+void pqLBA(unsigned char *LBA1, unsigned char *LBA2, unsigned char *LBA3, unsigned char *LBA4, unsigned char *PLBA,
+    unsigned char *QLBA)
+{
+    const unsigned char *src[4] = {LBA1, LBA2, LBA3, LBA4};
+
+    pqParity(PLBA, QLBA, src, 4, SECTOR_SIZE);
+}
+
+
+// RAID-6 Rebuild
+//
+// stripe[0..3] are the data LBAs, stripe[4] is P and stripe[5] is Q. Any two
+// of the six (lostLBA2 = -1 for one) are rebuilt in place from the other four.
+//
+// returns OK or ERROR for bad indices
+//
+int rebuildTwoLBA(unsigned char *stripe[6], int lostLBA1, int lostLBA2)
+{
+    return pqRecover(stripe, 4, lostLBA1, lostLBA2, SECTOR_SIZE);
 }
 
 
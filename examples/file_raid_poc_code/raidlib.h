@@ -16,6 +16,11 @@ void rebuildLBA(
     unsigned char *LBA1, unsigned char *LBA2, unsigned char *LBA3, unsigned char *PLBA, unsigned char *RLBA);
 
 
+void pqLBA(unsigned char *LBA1, unsigned char *LBA2, unsigned char *LBA3, unsigned char *LBA4, unsigned char *PLBA,
+    unsigned char *QLBA);
+
+int rebuildTwoLBA(unsigned char *stripe[6], int lostLBA1, int lostLBA2);
+
 int checkEquivLBA(unsigned char *LBA1, unsigned char *LBA2);
 
 int stripeFile(char *inputFileName, int offsetSectors);
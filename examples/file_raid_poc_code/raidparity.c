@@ -0,0 +1,737 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "raidlib.h"
+#include "raidparity.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PARITY_X86
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PARITY_NEON
+#endif
+
+
+// GF(2^8) with polynomial x^8 + x^4 + x^3 + x^2 + 1, gfExp is doubled so a sum of two logs needs no mod 255
+#define GF_POLY (0x1d)
+
+static unsigned char gfExp[512];
+static unsigned char gfLog[256];
+static pthread_once_t gfOnce = PTHREAD_ONCE_INIT;
+
+
+static void gfInitTables(void)
+{
+    int idx, x = 1;
+
+    for (idx = 0; idx < 255; idx++)
+    {
+        gfExp[idx] = gfExp[idx + 255] = (unsigned char)x;
+        gfLog[x] = (unsigned char)idx;
+        x <<= 1;
+        if (x & 0x100)
+            x ^= 0x100 | GF_POLY;
+    }
+    gfExp[510] = gfExp[511] = gfExp[0];
+}
+
+
+unsigned char gfMul(unsigned char a, unsigned char b)
+{
+    pthread_once(&gfOnce, gfInitTables);
+    if ((a == 0) || (b == 0))
+        return 0;
+
+    return gfExp[gfLog[a] + gfLog[b]];
+}
+
+
+unsigned char gfInv(unsigned char a)
+{
+    pthread_once(&gfOnce, gfInitTables);
+    if (a == 0)
+        return 0;
+
+    return gfExp[255 - gfLog[a]];
+}
+
+
+// Products of c with every low nibble and every high nibble, c*x = lo[x & 15] ^ hi[x >> 4]
+static void gfNibbleTables(unsigned char c, unsigned char lo[16], unsigned char hi[16])
+{
+    int x;
+
+    for (x = 0; x < 16; x++)
+    {
+        lo[x] = gfMul(c, (unsigned char)x);
+        hi[x] = gfMul(c, (unsigned char)(x << 4));
+    }
+}
+
+
+static int alwaysSupported(void)
+{
+    return TRUE;
+}
+
+
+// Reference, one byte at a time as the original xorLBA
+static void xorBytes(unsigned char *dst, const unsigned char *const *src, int nsrc, size_t len)
+{
+    size_t idx;
+    int s;
+    unsigned char acc;
+
+    for (idx = 0; idx < len; idx++)
+    {
+        acc = src[0][idx];
+        for (s = 1; s < nsrc; s++)
+            acc ^= src[s][idx];
+        dst[idx] = acc;
+    }
+}
+
+
+static inline unsigned char gfMul2(unsigned char q)
+{
+    return (unsigned char)((q << 1) ^ ((q & 0x80) ? GF_POLY : 0));
+}
+
+
+// Reference P+Q, Horner's rule from the highest source down: Q = (...(D[n-1]*g + D[n-2])*g ...)*g + D[0]
+static void pqBytes(unsigned char *P, unsigned char *Q, const unsigned char *const *src, int nsrc, size_t len)
+{
+    size_t idx;
+    int s;
+    unsigned char p, q;
+
+    for (idx = 0; idx < len; idx++)
+    {
+        p = q = src[nsrc - 1][idx];
+        for (s = nsrc - 2; s >= 0; s--)
+        {
+            p ^= src[s][idx];
+            q = gfMul2(q) ^ src[s][idx];
+        }
+        P[idx] = p;
+        Q[idx] = q;
+    }
+}
+
+
+// Reference multiply through a 256 entry row of products
+static void mulBytes(unsigned char *dst, const unsigned char *src, unsigned char c, size_t len, int accumulate)
+{
+    unsigned char row[256];
+    size_t idx;
+    int x;
+
+    for (x = 0; x < 256; x++)
+        row[x] = gfMul(c, (unsigned char)x);
+
+    for (idx = 0; idx < len; idx++)
+        dst[idx] = accumulate ? (dst[idx] ^ row[src[idx]]) : row[src[idx]];
+}
+
+
+// Tails shorter than a register go to the reference code with the pointers moved along
+static void pqTail(unsigned char *P, unsigned char *Q, const unsigned char *const *src, int nsrc, size_t idx,
+    size_t len)
+{
+    const unsigned char *tail[PQ_MAX_DATA];
+    int s;
+
+    if (idx >= len)
+        return;
+    for (s = 0; s < nsrc; s++)
+        tail[s] = src[s] + idx;
+    pqBytes(P + idx, Q + idx, tail, nsrc, len - idx);
+}
+
+
+// 64-bit words, four at a time so each source pointer is loaded once per 32 bytes
+static void xorWord64(unsigned char *dst, const unsigned char *const *src, int nsrc, size_t len)
+{
+    size_t idx = 0;
+    int s;
+
+    for (; idx + 32 <= len; idx += 32)
+    {
+        uint64_t a[4], b[4];
+
+        memcpy(a, src[0] + idx, sizeof(a));
+        for (s = 1; s < nsrc; s++)
+        {
+            memcpy(b, src[s] + idx, sizeof(b));
+            a[0] ^= b[0];
+            a[1] ^= b[1];
+            a[2] ^= b[2];
+            a[3] ^= b[3];
+        }
+        memcpy(dst + idx, a, sizeof(a));
+    }
+
+    if (idx < len)
+    {
+        const unsigned char *tail[nsrc];
+
+        for (s = 0; s < nsrc; s++)
+            tail[s] = src[s] + idx;
+        xorBytes(dst + idx, tail, nsrc, len - idx);
+    }
+}
+
+
+// Eight bytes at once multiplied by g: shift each byte left and fold the polynomial into those that overflowed
+static inline uint64_t gfMul2Word(uint64_t q)
+{
+    uint64_t high = (q & 0x8080808080808080ULL) >> 7;
+
+    return ((q << 1) & 0xfefefefefefefefeULL) ^ (high * GF_POLY);
+}
+
+
+static void pqWord64(unsigned char *P, unsigned char *Q, const unsigned char *const *src, int nsrc, size_t len)
+{
+    size_t idx = 0;
+    int s, w;
+
+    for (; idx + 32 <= len; idx += 32)
+    {
+        uint64_t p[4], q[4], d[4];
+
+        memcpy(p, src[nsrc - 1] + idx, sizeof(p));
+        memcpy(q, p, sizeof(q));
+        for (s = nsrc - 2; s >= 0; s--)
+        {
+            memcpy(d, src[s] + idx, sizeof(d));
+            for (w = 0; w < 4; w++)
+            {
+                p[w] ^= d[w];
+                q[w] = gfMul2Word(q[w]) ^ d[w];
+            }
+        }
+        memcpy(P + idx, p, sizeof(p));
+        memcpy(Q + idx, q, sizeof(q));
+    }
+
+    pqTail(P, Q, src, nsrc, idx, len);
+}
+
+
+#ifdef PARITY_X86
+
+static int sse2Supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+
+static int ssse3Supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+}
+
+
+static int avx2Supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+
+__attribute__((target("sse2"))) static void xorSSE2(
+    unsigned char *dst, const unsigned char *const *src, int nsrc, size_t len)
+{
+    size_t idx = 0;
+    int s;
+
+    for (; idx + 64 <= len; idx += 64)
+    {
+        const unsigned char *p = src[0] + idx;
+        __m128i a0 = _mm_loadu_si128((const __m128i *)(p + 0));
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(p + 16));
+        __m128i a2 = _mm_loadu_si128((const __m128i *)(p + 32));
+        __m128i a3 = _mm_loadu_si128((const __m128i *)(p + 48));
+
+        for (s = 1; s < nsrc; s++)
+        {
+            p = src[s] + idx;
+            a0 = _mm_xor_si128(a0, _mm_loadu_si128((const __m128i *)(p + 0)));
+            a1 = _mm_xor_si128(a1, _mm_loadu_si128((const __m128i *)(p + 16)));
+            a2 = _mm_xor_si128(a2, _mm_loadu_si128((const __m128i *)(p + 32)));
+            a3 = _mm_xor_si128(a3, _mm_loadu_si128((const __m128i *)(p + 48)));
+        }
+        _mm_storeu_si128((__m128i *)(dst + idx + 0), a0);
+        _mm_storeu_si128((__m128i *)(dst + idx + 16), a1);
+        _mm_storeu_si128((__m128i *)(dst + idx + 32), a2);
+        _mm_storeu_si128((__m128i *)(dst + idx + 48), a3);
+    }
+
+    if (idx < len)
+    {
+        const unsigned char *tail[nsrc];
+
+        for (s = 0; s < nsrc; s++)
+            tail[s] = src[s] + idx;
+        xorWord64(dst + idx, tail, nsrc, len - idx);
+    }
+}
+
+
+__attribute__((target("avx2"))) static void xorAVX2(
+    unsigned char *dst, const unsigned char *const *src, int nsrc, size_t len)
+{
+    size_t idx = 0;
+    int s;
+
+    for (; idx + 128 <= len; idx += 128)
+    {
+        const unsigned char *p = src[0] + idx;
+        __m256i a0 = _mm256_loadu_si256((const __m256i *)(p + 0));
+        __m256i a1 = _mm256_loadu_si256((const __m256i *)(p + 32));
+        __m256i a2 = _mm256_loadu_si256((const __m256i *)(p + 64));
+        __m256i a3 = _mm256_loadu_si256((const __m256i *)(p + 96));
+
+        for (s = 1; s < nsrc; s++)
+        {
+            p = src[s] + idx;
+            a0 = _mm256_xor_si256(a0, _mm256_loadu_si256((const __m256i *)(p + 0)));
+            a1 = _mm256_xor_si256(a1, _mm256_loadu_si256((const __m256i *)(p + 32)));
+            a2 = _mm256_xor_si256(a2, _mm256_loadu_si256((const __m256i *)(p + 64)));
+            a3 = _mm256_xor_si256(a3, _mm256_loadu_si256((const __m256i *)(p + 96)));
+        }
+        _mm256_storeu_si256((__m256i *)(dst + idx + 0), a0);
+        _mm256_storeu_si256((__m256i *)(dst + idx + 32), a1);
+        _mm256_storeu_si256((__m256i *)(dst + idx + 64), a2);
+        _mm256_storeu_si256((__m256i *)(dst + idx + 96), a3);
+    }
+
+    if (idx < len)
+    {
+        const unsigned char *tail[nsrc];
+
+        for (s = 0; s < nsrc; s++)
+            tail[s] = src[s] + idx;
+        xorWord64(dst + idx, tail, nsrc, len - idx);
+    }
+}
+
+// Bytes with the top bit set compare below zero, giving the mask of bytes that take the polynomial
+__attribute__((target("sse2"))) static void pqSSE2(
+    unsigned char *P, unsigned char *Q, const unsigned char *const *src, int nsrc, size_t len)
+{
+    const __m128i poly = _mm_set1_epi8(GF_POLY), zero = _mm_setzero_si128();
+    size_t idx = 0;
+    int s;
+
+    for (; idx + 32 <= len; idx += 32)
+    {
+        __m128i p0 = _mm_loadu_si128((const __m128i *)(src[nsrc - 1] + idx));
+        __m128i p1 = _mm_loadu_si128((const __m128i *)(src[nsrc - 1] + idx + 16));
+        __m128i q0 = p0, q1 = p1, d0, d1;
+
+        for (s = nsrc - 2; s >= 0; s--)
+        {
+            d0 = _mm_loadu_si128((const __m128i *)(src[s] + idx));
+            d1 = _mm_loadu_si128((const __m128i *)(src[s] + idx + 16));
+            p0 = _mm_xor_si128(p0, d0);
+            p1 = _mm_xor_si128(p1, d1);
+            q0 = _mm_xor_si128(_mm_add_epi8(q0, q0), _mm_and_si128(_mm_cmpgt_epi8(zero, q0), poly));
+            q1 = _mm_xor_si128(_mm_add_epi8(q1, q1), _mm_and_si128(_mm_cmpgt_epi8(zero, q1), poly));
+            q0 = _mm_xor_si128(q0, d0);
+            q1 = _mm_xor_si128(q1, d1);
+        }
+        _mm_storeu_si128((__m128i *)(P + idx), p0);
+        _mm_storeu_si128((__m128i *)(P + idx + 16), p1);
+        _mm_storeu_si128((__m128i *)(Q + idx), q0);
+        _mm_storeu_si128((__m128i *)(Q + idx + 16), q1);
+    }
+
+    pqTail(P, Q, src, nsrc, idx, len);
+}
+
+
+__attribute__((target("avx2"))) static void pqAVX2(
+    unsigned char *P, unsigned char *Q, const unsigned char *const *src, int nsrc, size_t len)
+{
+    const __m256i poly = _mm256_set1_epi8(GF_POLY), zero = _mm256_setzero_si256();
+    size_t idx = 0;
+    int s;
+
+    for (; idx + 64 <= len; idx += 64)
+    {
+        __m256i p0 = _mm256_loadu_si256((const __m256i *)(src[nsrc - 1] + idx));
+        __m256i p1 = _mm256_loadu_si256((const __m256i *)(src[nsrc - 1] + idx + 32));
+        __m256i q0 = p0, q1 = p1, d0, d1;
+
+        for (s = nsrc - 2; s >= 0; s--)
+        {
+            d0 = _mm256_loadu_si256((const __m256i *)(src[s] + idx));
+            d1 = _mm256_loadu_si256((const __m256i *)(src[s] + idx + 32));
+            p0 = _mm256_xor_si256(p0, d0);
+            p1 = _mm256_xor_si256(p1, d1);
+            q0 = _mm256_xor_si256(_mm256_add_epi8(q0, q0), _mm256_and_si256(_mm256_cmpgt_epi8(zero, q0), poly));
+            q1 = _mm256_xor_si256(_mm256_add_epi8(q1, q1), _mm256_and_si256(_mm256_cmpgt_epi8(zero, q1), poly));
+            q0 = _mm256_xor_si256(q0, d0);
+            q1 = _mm256_xor_si256(q1, d1);
+        }
+        _mm256_storeu_si256((__m256i *)(P + idx), p0);
+        _mm256_storeu_si256((__m256i *)(P + idx + 32), p1);
+        _mm256_storeu_si256((__m256i *)(Q + idx), q0);
+        _mm256_storeu_si256((__m256i *)(Q + idx + 32), q1);
+    }
+
+    pqTail(P, Q, src, nsrc, idx, len);
+}
+
+
+// Split nibble multiply, pshufb looks up 16 products at once for the low and the high nibbles
+__attribute__((target("ssse3"))) static void mulSSSE3(
+    unsigned char *dst, const unsigned char *src, unsigned char c, size_t len, int accumulate)
+{
+    unsigned char lo[16], hi[16];
+    __m128i tlo, thi, mask = _mm_set1_epi8(0x0f), v, r;
+    size_t idx = 0;
+
+    gfNibbleTables(c, lo, hi);
+    tlo = _mm_loadu_si128((const __m128i *)lo);
+    thi = _mm_loadu_si128((const __m128i *)hi);
+
+    for (; idx + 16 <= len; idx += 16)
+    {
+        v = _mm_loadu_si128((const __m128i *)(src + idx));
+        r = _mm_xor_si128(_mm_shuffle_epi8(tlo, _mm_and_si128(v, mask)),
+            _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi16(v, 4), mask)));
+        if (accumulate)
+            r = _mm_xor_si128(r, _mm_loadu_si128((const __m128i *)(dst + idx)));
+        _mm_storeu_si128((__m128i *)(dst + idx), r);
+    }
+
+    if (idx < len)
+        mulBytes(dst + idx, src + idx, c, len - idx, accumulate);
+}
+
+
+__attribute__((target("avx2"))) static void mulAVX2(
+    unsigned char *dst, const unsigned char *src, unsigned char c, size_t len, int accumulate)
+{
+    unsigned char lo[16], hi[16];
+    __m256i tlo, thi, mask = _mm256_set1_epi8(0x0f), v, r;
+    size_t idx = 0;
+
+    gfNibbleTables(c, lo, hi);
+    tlo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)lo));
+    thi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)hi));
+
+    for (; idx + 32 <= len; idx += 32)
+    {
+        v = _mm256_loadu_si256((const __m256i *)(src + idx));
+        r = _mm256_xor_si256(_mm256_shuffle_epi8(tlo, _mm256_and_si256(v, mask)),
+            _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask)));
+        if (accumulate)
+            r = _mm256_xor_si256(r, _mm256_loadu_si256((const __m256i *)(dst + idx)));
+        _mm256_storeu_si256((__m256i *)(dst + idx), r);
+    }
+
+    if (idx < len)
+        mulBytes(dst + idx, src + idx, c, len - idx, accumulate);
+}
+
+#endif
+
+
+#ifdef PARITY_NEON
+
+static void xorNEON(unsigned char *dst, const unsigned char *const *src, int nsrc, size_t len)
+{
+    size_t idx = 0;
+    int s;
+
+    for (; idx + 64 <= len; idx += 64)
+    {
+        const unsigned char *p = src[0] + idx;
+        uint8x16_t a0 = vld1q_u8(p + 0);
+        uint8x16_t a1 = vld1q_u8(p + 16);
+        uint8x16_t a2 = vld1q_u8(p + 32);
+        uint8x16_t a3 = vld1q_u8(p + 48);
+
+        for (s = 1; s < nsrc; s++)
+        {
+            p = src[s] + idx;
+            a0 = veorq_u8(a0, vld1q_u8(p + 0));
+            a1 = veorq_u8(a1, vld1q_u8(p + 16));
+            a2 = veorq_u8(a2, vld1q_u8(p + 32));
+            a3 = veorq_u8(a3, vld1q_u8(p + 48));
+        }
+        vst1q_u8(dst + idx + 0, a0);
+        vst1q_u8(dst + idx + 16, a1);
+        vst1q_u8(dst + idx + 32, a2);
+        vst1q_u8(dst + idx + 48, a3);
+    }
+
+    if (idx < len)
+    {
+        const unsigned char *tail[nsrc];
+
+        for (s = 0; s < nsrc; s++)
+            tail[s] = src[s] + idx;
+        xorWord64(dst + idx, tail, nsrc, len - idx);
+    }
+}
+
+static void pqNEON(unsigned char *P, unsigned char *Q, const unsigned char *const *src, int nsrc, size_t len)
+{
+    const uint8x16_t poly = vdupq_n_u8(GF_POLY);
+    size_t idx = 0;
+    int s;
+
+    for (; idx + 32 <= len; idx += 32)
+    {
+        uint8x16_t p0 = vld1q_u8(src[nsrc - 1] + idx);
+        uint8x16_t p1 = vld1q_u8(src[nsrc - 1] + idx + 16);
+        uint8x16_t q0 = p0, q1 = p1, d0, d1, m0, m1;
+
+        for (s = nsrc - 2; s >= 0; s--)
+        {
+            d0 = vld1q_u8(src[s] + idx);
+            d1 = vld1q_u8(src[s] + idx + 16);
+            p0 = veorq_u8(p0, d0);
+            p1 = veorq_u8(p1, d1);
+
+            // Arithmetic shift spreads the top bit over the byte
+            m0 = vreinterpretq_u8_s8(vshrq_n_s8(vreinterpretq_s8_u8(q0), 7));
+            m1 = vreinterpretq_u8_s8(vshrq_n_s8(vreinterpretq_s8_u8(q1), 7));
+            q0 = veorq_u8(veorq_u8(vshlq_n_u8(q0, 1), vandq_u8(m0, poly)), d0);
+            q1 = veorq_u8(veorq_u8(vshlq_n_u8(q1, 1), vandq_u8(m1, poly)), d1);
+        }
+        vst1q_u8(P + idx, p0);
+        vst1q_u8(P + idx + 16, p1);
+        vst1q_u8(Q + idx, q0);
+        vst1q_u8(Q + idx + 16, q1);
+    }
+
+    pqTail(P, Q, src, nsrc, idx, len);
+}
+
+
+// Split nibble multiply, a 16 entry vtbl lookup per nibble (two 8 byte lookups on ARMv7)
+static inline uint8x16_t lookupNEON(const unsigned char table[16], uint8x16_t index)
+{
+#if defined(__aarch64__)
+    return vqtbl1q_u8(vld1q_u8(table), index);
+#else
+    uint8x8x2_t t;
+
+    t.val[0] = vld1_u8(table);
+    t.val[1] = vld1_u8(table + 8);
+    return vcombine_u8(vtbl2_u8(t, vget_low_u8(index)), vtbl2_u8(t, vget_high_u8(index)));
+#endif
+}
+
+
+static void mulNEON(unsigned char *dst, const unsigned char *src, unsigned char c, size_t len, int accumulate)
+{
+    unsigned char lo[16], hi[16];
+    const uint8x16_t mask = vdupq_n_u8(0x0f);
+    uint8x16_t v, r;
+    size_t idx = 0;
+
+    gfNibbleTables(c, lo, hi);
+
+    for (; idx + 16 <= len; idx += 16)
+    {
+        v = vld1q_u8(src + idx);
+        r = veorq_u8(lookupNEON(lo, vandq_u8(v, mask)), lookupNEON(hi, vshrq_n_u8(v, 4)));
+        if (accumulate)
+            r = veorq_u8(r, vld1q_u8(dst + idx));
+        vst1q_u8(dst + idx, r);
+    }
+
+    if (idx < len)
+        mulBytes(dst + idx, src + idx, c, len - idx, accumulate);
+}
+
+#endif
+
+
+// Slowest first, parityBestEngine takes the last supported one
+const parityEngine parityEngines[] = {
+    {"byte", alwaysSupported, xorBytes, pqBytes, mulBytes},
+    {"word64", alwaysSupported, xorWord64, pqWord64, mulBytes},
+#ifdef PARITY_X86
+    {"sse2", sse2Supported, xorSSE2, pqSSE2, mulBytes},
+    {"ssse3", ssse3Supported, xorSSE2, pqSSE2, mulSSSE3},
+    {"avx2", avx2Supported, xorAVX2, pqAVX2, mulAVX2},
+#endif
+#ifdef PARITY_NEON
+    {"neon", alwaysSupported, xorNEON, pqNEON, mulNEON},
+#endif
+};
+
+const int parityNumEngines = sizeof(parityEngines) / sizeof(parityEngines[0]);
+
+// Resolved once on first use, so concurrent callers such as the stripe workers all see the same engine
+static const parityEngine *currentEngine = NULL;
+static pthread_once_t engineOnce = PTHREAD_ONCE_INIT;
+
+
+const parityEngine *parityBestEngine(void)
+{
+    int idx;
+
+    for (idx = parityNumEngines - 1; idx > 0; idx--)
+        if (parityEngines[idx].supported())
+            break;
+
+    return &parityEngines[idx];
+}
+
+
+static void engineInit(void)
+{
+    __atomic_store_n(&currentEngine, parityBestEngine(), __ATOMIC_RELEASE);
+}
+
+
+const parityEngine *parityCurrentEngine(void)
+{
+    pthread_once(&engineOnce, engineInit);
+    return __atomic_load_n(&currentEngine, __ATOMIC_ACQUIRE);
+}
+
+
+int paritySetEngine(const char *name)
+{
+    int idx;
+
+    // Resolve the default first so it cannot later overwrite this choice
+    pthread_once(&engineOnce, engineInit);
+
+    for (idx = 0; idx < parityNumEngines; idx++)
+    {
+        if ((strcmp(parityEngines[idx].name, name) == 0) && parityEngines[idx].supported())
+        {
+            __atomic_store_n(&currentEngine, &parityEngines[idx], __ATOMIC_RELEASE);
+            return OK;
+        }
+    }
+
+    return ERROR;
+}
+
+
+void xorParity(unsigned char *dst, const unsigned char *const *src, int nsrc, size_t len)
+{
+    parityCurrentEngine()->xorBlocks(dst, src, nsrc, len);
+}
+
+
+void pqParity(unsigned char *P, unsigned char *Q, const unsigned char *const *src, int nsrc, size_t len)
+{
+    parityCurrentEngine()->pqBlocks(P, Q, src, nsrc, len);
+}
+
+
+void mulParity(unsigned char *dst, const unsigned char *src, unsigned char c, size_t len, int accumulate)
+{
+    parityCurrentEngine()->mulBlocks(dst, src, c, len, accumulate);
+}
+
+
+// Lost data block x is the XOR of P and the other data blocks
+static void recoverFromP(unsigned char **blocks, int ndata, int x, size_t len)
+{
+    const unsigned char *src[PQ_MAX_DATA];
+    int idx, n = 0;
+
+    for (idx = 0; idx <= ndata; idx++)
+        if (idx != x)
+            src[n++] = blocks[idx];
+    xorParity(blocks[x], src, n, len);
+}
+
+
+int pqRecover(unsigned char **blocks, int ndata, int lostA, int lostB, size_t len)
+{
+    const unsigned char *src[2];
+    int P = ndata, Q = ndata + 1, x, y;
+    unsigned char gyx, inv;
+
+    if (lostB >= 0 && lostB < lostA)
+    {
+        x = lostA;
+        lostA = lostB;
+        lostB = x;
+    }
+    if ((ndata < 1) || (ndata > PQ_MAX_DATA) || (lostA < 0) || (lostB > Q) || (lostA == lostB) || (lostA > Q))
+        return ERROR;
+
+    pthread_once(&gfOnce, gfInitTables);
+    x = lostA;
+    y = lostB;
+
+    if (y < 0)
+    {
+        // One block, Q alone is regenerated along with an unchanged P
+        if (x < P)
+            recoverFromP(blocks, ndata, x, len);
+        else if (x == P)
+            xorParity(blocks[P], (const unsigned char *const *)blocks, ndata, len);
+        else
+            pqParity(blocks[P], blocks[Q], (const unsigned char *const *)blocks, ndata, len);
+        return OK;
+    }
+
+    if ((x == P) || (y == Q))
+    {
+        // Both syndromes, or data x and Q: P still gives x, then regenerate the syndromes
+        if (x < P)
+            recoverFromP(blocks, ndata, x, len);
+        pqParity(blocks[P], blocks[Q], (const unsigned char *const *)blocks, ndata, len);
+        return OK;
+    }
+
+    if (y == P)
+    {
+        // Data x and P: Q of the rest with x as zero, Dx = (Q ^ Q') * g^-x, then P again
+        memset(blocks[x], 0, len);
+        pqParity(blocks[P], blocks[x], (const unsigned char *const *)blocks, ndata, len);
+        src[0] = blocks[x];
+        src[1] = blocks[Q];
+        xorParity(blocks[x], src, 2, len);
+        mulParity(blocks[x], blocks[x], gfExp[255 - x], len, FALSE);
+        xorParity(blocks[P], (const unsigned char *const *)blocks, ndata, len);
+        return OK;
+    }
+
+    // Data x and y: with both as zero Pxy = P ^ P' and Qxy = Q ^ Q', then
+    // Dx = A*Pxy ^ B*Qxy and Dy = Pxy ^ Dx for A = g^(y-x) / (g^(y-x) ^ 1), B = g^-x / (g^(y-x) ^ 1)
+    memset(blocks[x], 0, len);
+    memset(blocks[y], 0, len);
+    pqParity(blocks[x], blocks[y], (const unsigned char *const *)blocks, ndata, len);
+    src[0] = blocks[x];
+    src[1] = blocks[P];
+    xorParity(blocks[x], src, 2, len);
+    src[0] = blocks[y];
+    src[1] = blocks[Q];
+    xorParity(blocks[y], src, 2, len);
+
+    gyx = gfExp[y - x];
+    inv = gfInv(gyx ^ 1);
+
+    // y = B*Qxy ^ (A^1)*Pxy is Dy, then x = Pxy ^ Dy is Dx
+    mulParity(blocks[y], blocks[y], gfMul(gfExp[255 - x], inv), len, FALSE);
+    mulParity(blocks[y], blocks[x], gfMul(gyx, inv) ^ 1, len, TRUE);
+    src[0] = blocks[x];
+    src[1] = blocks[y];
+    xorParity(blocks[x], src, 2, len);
+
+    return OK;
+}
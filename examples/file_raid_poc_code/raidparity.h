@@ -0,0 +1,62 @@
+#ifndef RAIDPARITY_H
+#define RAIDPARITY_H
+
+#include <stddef.h>
+
+// XOR and RAID-6 parity engine
+//
+// Parity is the XOR of any number of equal sized blocks, so one routine both encodes (data blocks in, parity out)
+// and rebuilds (surviving data blocks plus parity in, lost block out) for any stripe width.
+//
+// RAID-6 adds a second syndrome Q = g^0*D0 + g^1*D1 + ... over GF(2^8) with generator g = 2 and polynomial 0x11d,
+// so any two lost blocks of a stripe can be rebuilt. Q is generated by Horner's rule, which only ever multiplies by
+// g, a shift and a conditional XOR per byte. Recovery multiplies whole blocks by constants, done with the log/exp
+// tables a byte at a time, or with two 16 entry tables (low and high nibble) and a byte shuffle 16 or 32 bytes at a
+// time where the CPU has one (SSSE3/AVX2 pshufb, NEON vtbl).
+//
+// Each backend works a register at a time rather than a byte at a time. The best one the CPU supports is picked on
+// first use, or one can be forced by name for comparison.
+//
+#define PQ_MAX_DATA (255)
+
+typedef void (*parityXorFn)(unsigned char *dst, const unsigned char *const *src, int nsrc, size_t len);
+typedef void (*parityPQFn)(unsigned char *P, unsigned char *Q, const unsigned char *const *src, int nsrc, size_t len);
+typedef void (*parityMulFn)(unsigned char *dst, const unsigned char *src, unsigned char c, size_t len, int accumulate);
+
+typedef struct
+{
+    const char *name;
+    int (*supported)(void);
+    parityXorFn xorBlocks;
+    parityPQFn pqBlocks;
+    parityMulFn mulBlocks;
+} parityEngine;
+
+extern const parityEngine parityEngines[];
+extern const int parityNumEngines;
+
+// Fastest supported engine, and the one the parity functions use unless paritySetEngine was called
+const parityEngine *parityBestEngine(void);
+const parityEngine *parityCurrentEngine(void);
+
+// Returns OK, or ERROR if the name is unknown or the CPU does not support it
+int paritySetEngine(const char *name);
+
+// dst = src[0] ^ src[1] ^ ... ^ src[nsrc-1] over len bytes. dst may be one of the sources. No alignment needed.
+void xorParity(unsigned char *dst, const unsigned char *const *src, int nsrc, size_t len);
+
+// GF(2^8) product and inverse from the log/exp tables
+unsigned char gfMul(unsigned char a, unsigned char b);
+unsigned char gfInv(unsigned char a);
+
+// P and Q of nsrc (at most PQ_MAX_DATA) data blocks. P or Q may be one of the sources.
+void pqParity(unsigned char *P, unsigned char *Q, const unsigned char *const *src, int nsrc, size_t len);
+
+// dst = c * src, or dst ^= c * src with accumulate. dst may be src.
+void mulParity(unsigned char *dst, const unsigned char *src, unsigned char c, size_t len, int accumulate);
+
+// Rebuild up to two lost blocks of a RAID-6 stripe in place. blocks[0 .. ndata-1] are data, blocks[ndata] is P and
+// blocks[ndata+1] is Q. lostB is -1 if only lostA is lost. Returns OK, or ERROR for bad indices.
+int pqRecover(unsigned char **blocks, int ndata, int lostA, int lostB, size_t len);
+
+#endif
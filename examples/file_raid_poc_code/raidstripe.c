@@ -0,0 +1,586 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "raidlib.h"
+#include "raidparity.h"
+#include "raidstripe.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX (1024)
+#endif
+
+// O_DIRECT needs buffers, offsets and lengths aligned to the logical block size, 4 KB covers common devices
+#define STRIPE_ALIGN (4096)
+
+const char *stripeChunkNames[STRIPE_CHUNKS] = {"StripeChunk1.bin", "StripeChunk2.bin", "StripeChunk3.bin",
+    "StripeChunk4.bin", "StripeChunkXOR.bin", "StripeChunkQ.bin"};
+
+
+// Chunk files in use, the Q chunk only for RAID-6
+static int chunkFiles(const stripeConfig *config)
+{
+    return config->raid6 ? STRIPE_CHUNKS : STRIPE_CHUNKS - 1;
+}
+
+
+int stripeBatch(const stripeConfig *config)
+{
+    int batch;
+
+    if ((config->chunkSize < STRIPE_MIN_CHUNK) || (config->chunkSize > STRIPE_MAX_CHUNK) ||
+        (config->chunkSize % STRIPE_ALIGN) || (config->stripesPerIO < 0) || (config->stripesPerIO > IOV_MAX))
+        return ERROR;
+
+    batch = config->stripesPerIO;
+    if (batch == 0)
+        batch = STRIPE_BATCH_BYTES / (STRIPE_DATA_CHUNKS * config->chunkSize);
+    if (batch < 1)
+        batch = 1;
+    if (batch > IOV_MAX)
+        batch = IOV_MAX;
+
+    return batch;
+}
+
+
+// Opens the chunk files except missingA and missingB (1 based, 0 for none), -1 in fd for those skipped and for
+// the Q chunk without RAID-6
+static int openChunks(int fd[STRIPE_CHUNKS], int flags, int missingA, int missingB, const stripeConfig *config)
+{
+    int idx;
+
+    for (idx = 0; idx < STRIPE_CHUNKS; idx++)
+        fd[idx] = -1;
+
+    for (idx = 0; idx < chunkFiles(config); idx++)
+    {
+        if ((idx + 1 == missingA) || (idx + 1 == missingB))
+            continue;
+
+        if (config->direct)
+        {
+            fd[idx] = open(stripeChunkNames[idx], flags | O_DIRECT, 00644);
+            if ((fd[idx] < 0) && (errno == EINVAL))
+                printf("%s: O_DIRECT not supported, using buffered I/O\n", stripeChunkNames[idx]);
+        }
+        if (fd[idx] < 0)
+            fd[idx] = open(stripeChunkNames[idx], flags, 00644);
+        if (fd[idx] < 0)
+        {
+            perror(stripeChunkNames[idx]);
+            while (--idx >= 0)
+                if (fd[idx] >= 0)
+                    close(fd[idx]);
+            return ERROR;
+        }
+    }
+
+    return OK;
+}
+
+
+static void closeChunks(int fd[STRIPE_CHUNKS])
+{
+    int idx;
+
+    for (idx = 0; idx < STRIPE_CHUNKS; idx++)
+        if (fd[idx] >= 0)
+            close(fd[idx]);
+}
+
+
+// Read until len bytes or end of file, returns bytes read or ERROR
+static long long fullRead(int fd, unsigned char *buf, long long len)
+{
+    long long done = 0;
+    ssize_t rc;
+
+    while (done < len)
+    {
+        rc = read(fd, buf + done, len - done);
+        if ((rc < 0) && (errno == EINTR))
+            continue;
+        if (rc < 0)
+            return ERROR;
+        if (rc == 0)
+            break;
+        done += rc;
+    }
+
+    return done;
+}
+
+
+static int fullPwrite(int fd, const unsigned char *buf, long long len, off_t offset)
+{
+    ssize_t rc;
+
+    while (len > 0)
+    {
+        rc = pwrite(fd, buf, len, offset);
+        if ((rc < 0) && (errno == EINTR))
+            continue;
+        if (rc <= 0)
+            return ERROR;
+        buf += rc;
+        len -= rc;
+        offset += rc;
+    }
+
+    return OK;
+}
+
+
+// pwritev or preadv all of iov, picking up after a short transfer. iov is modified.
+static int fullVector(int fd, struct iovec *iov, int iovcnt, off_t offset, int writing)
+{
+    ssize_t rc;
+
+    while (iovcnt > 0)
+    {
+        rc = writing ? pwritev(fd, iov, iovcnt, offset) : preadv(fd, iov, iovcnt, offset);
+        if ((rc < 0) && (errno == EINTR))
+            continue;
+        if (rc <= 0)
+            return ERROR;
+
+        offset += rc;
+        while ((iovcnt > 0) && ((size_t)rc >= iov->iov_len))
+        {
+            rc -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (unsigned char *)iov->iov_base + rc;
+            iov->iov_len -= rc;
+        }
+    }
+
+    return OK;
+}
+
+
+// Chunk k of each of count stripes in the stripe major buffer, as one vector
+static void chunkVector(struct iovec *iov, unsigned char *stripes, int count, int k, int chunkSize)
+{
+    int s;
+
+    for (s = 0; s < count; s++)
+    {
+        iov[s].iov_base = stripes + ((size_t)s * STRIPE_DATA_CHUNKS + k) * chunkSize;
+        iov[s].iov_len = chunkSize;
+    }
+}
+
+
+// Stripe major data buffer and a parity buffer for batch stripes, aligned for O_DIRECT. With RAID-6 the parity
+// buffer holds the XOR chunks of the batch followed by the Q chunks.
+static int allocBatch(int batch, int chunkSize, int raid6, unsigned char **stripes, unsigned char **parity,
+    struct iovec **iov)
+{
+    *stripes = NULL;
+    *parity = NULL;
+    *iov = malloc(batch * sizeof(struct iovec));
+
+    if ((*iov == NULL) ||
+        posix_memalign((void **)stripes, STRIPE_ALIGN, (size_t)batch * STRIPE_DATA_CHUNKS * chunkSize) ||
+        posix_memalign((void **)parity, STRIPE_ALIGN, (size_t)(raid6 ? 2 : 1) * batch * chunkSize))
+    {
+        free(*iov);
+        free(*stripes);
+        free(*parity);
+        return ERROR;
+    }
+
+    return OK;
+}
+
+
+static void freeBatch(unsigned char *stripes, unsigned char *parity, struct iovec *iov)
+{
+    free(stripes);
+    free(parity);
+    free(iov);
+}
+
+
+long long stripeFileV(const char *inputFileName, const stripeConfig *config)
+{
+    int fd[STRIPE_CHUNKS], fdin, batch, count, s, k, rc = OK;
+    int chunkSize = config->chunkSize, stripeData = STRIPE_DATA_CHUNKS * config->chunkSize;
+    long long bread, byteCnt = 0, stripeIdx = 0;
+    unsigned char *stripes, *parity, *q;
+    const unsigned char *src[STRIPE_DATA_CHUNKS];
+    struct iovec *iov;
+
+    if ((batch = stripeBatch(config)) == ERROR)
+        return ERROR;
+    if ((fdin = open(inputFileName, O_RDONLY)) < 0)
+    {
+        perror(inputFileName);
+        return ERROR;
+    }
+    if (openChunks(fd, O_RDWR | O_CREAT | O_TRUNC, 0, 0, config) == ERROR)
+    {
+        close(fdin);
+        return ERROR;
+    }
+    if (allocBatch(batch, chunkSize, config->raid6, &stripes, &parity, &iov) == ERROR)
+    {
+        close(fdin);
+        closeChunks(fd);
+        return ERROR;
+    }
+    q = parity + (size_t)batch * chunkSize;
+
+    do
+    {
+        if ((bread = fullRead(fdin, stripes, (long long)batch * stripeData)) <= 0)
+        {
+            rc = (int)bread;
+            break;
+        }
+
+        // Zero fill the last stripe
+        count = (int)((bread + stripeData - 1) / stripeData);
+        memset(stripes + bread, 0, (size_t)count * stripeData - bread);
+
+        for (s = 0; s < count; s++)
+        {
+            for (k = 0; k < STRIPE_DATA_CHUNKS; k++)
+                src[k] = stripes + ((size_t)s * STRIPE_DATA_CHUNKS + k) * chunkSize;
+            if (config->raid6)
+                pqParity(parity + (size_t)s * chunkSize, q + (size_t)s * chunkSize, src, STRIPE_DATA_CHUNKS, chunkSize);
+            else
+                xorParity(parity + (size_t)s * chunkSize, src, STRIPE_DATA_CHUNKS, chunkSize);
+        }
+
+        for (k = 0; (k < STRIPE_DATA_CHUNKS) && (rc == OK); k++)
+        {
+            chunkVector(iov, stripes, count, k, chunkSize);
+            rc = fullVector(fd[k], iov, count, (off_t)stripeIdx * chunkSize, TRUE);
+        }
+        if (rc == OK)
+            rc = fullPwrite(fd[STRIPE_DATA_CHUNKS], parity, (long long)count * chunkSize, (off_t)stripeIdx * chunkSize);
+        if ((rc == OK) && config->raid6)
+            rc = fullPwrite(fd[STRIPE_DATA_CHUNKS + 1], q, (long long)count * chunkSize, (off_t)stripeIdx * chunkSize);
+
+        byteCnt += bread;
+        stripeIdx += count;
+
+    } while ((rc == OK) && (bread == (long long)batch * stripeData));
+
+    if (rc == ERROR)
+        perror("stripeFileV");
+
+    freeBatch(stripes, parity, iov);
+    close(fdin);
+    closeChunks(fd);
+
+    return (rc == ERROR) ? ERROR : byteCnt;
+}
+
+
+// Read count stripes starting at stripeIdx into the batch buffers, skipping the chunk files that are not open
+static int readStripes(int fd[STRIPE_CHUNKS], unsigned char *stripes, unsigned char *parity, unsigned char *q,
+    struct iovec *iov, int count, long long stripeIdx, int chunkSize)
+{
+    int k;
+
+    for (k = 0; k < STRIPE_DATA_CHUNKS; k++)
+    {
+        if (fd[k] < 0)
+            continue;
+        chunkVector(iov, stripes, count, k, chunkSize);
+        if (fullVector(fd[k], iov, count, (off_t)stripeIdx * chunkSize, FALSE) == ERROR)
+            return ERROR;
+    }
+
+    for (k = STRIPE_DATA_CHUNKS; k < STRIPE_CHUNKS; k++)
+    {
+        if (fd[k] < 0)
+            continue;
+        iov[0].iov_base = (k == STRIPE_DATA_CHUNKS) ? parity : q;
+        iov[0].iov_len = (size_t)count * chunkSize;
+        if (fullVector(fd[k], iov, 1, (off_t)stripeIdx * chunkSize, FALSE) == ERROR)
+            return ERROR;
+    }
+
+    return OK;
+}
+
+
+// A restore or scrub split over workers. Each worker claims batch stripes at a time, reads them with positional
+// reads of its own and, for a restore, writes its part of the output with positional writes, so the workers share
+// the file descriptors and nothing else.
+typedef struct
+{
+    const stripeConfig *config;
+    int fd[STRIPE_CHUNKS];
+    int fdout; // -1 to scrub instead of restore
+    int missingA, missingB;
+    int batch;
+    long long fileLength;
+    long long stripeCnt;
+
+    long long nextStripe;
+    long long badCnt;
+    int rc;
+} stripeJob;
+
+
+// Rebuild the lost chunks of each stripe, data and parity alike. Without q there is only the XOR to rebuild from
+// and missingB is 0, with q any two chunks are rebuilt by pqRecover.
+static void rebuildStripes(unsigned char *stripes, unsigned char *parity, unsigned char *q, int count, int missingA,
+    int missingB, int chunkSize)
+{
+    unsigned char *blocks[STRIPE_CHUNKS];
+    int s, k;
+
+    if (missingA == 0)
+        return;
+
+    for (s = 0; s < count; s++)
+    {
+        for (k = 0; k < STRIPE_DATA_CHUNKS; k++)
+            blocks[k] = stripes + ((size_t)s * STRIPE_DATA_CHUNKS + k) * chunkSize;
+        blocks[STRIPE_DATA_CHUNKS] = parity + (size_t)s * chunkSize;
+
+        if (q != NULL)
+        {
+            blocks[STRIPE_DATA_CHUNKS + 1] = q + (size_t)s * chunkSize;
+            pqRecover(blocks, STRIPE_DATA_CHUNKS, missingA - 1, missingB - 1, chunkSize);
+        }
+        else if (missingA == STRIPE_XOR_CHUNK)
+            xorParity(blocks[STRIPE_DATA_CHUNKS], (const unsigned char *const *)blocks, STRIPE_DATA_CHUNKS, chunkSize);
+        else
+        {
+            // The lost chunk is the XOR of the others, so XOR all five with its slot as zero
+            memset(blocks[missingA - 1], 0, chunkSize);
+            xorParity(blocks[missingA - 1], (const unsigned char *const *)blocks, STRIPE_DATA_CHUNKS + 1, chunkSize);
+        }
+    }
+}
+
+
+// Regenerate the parity of each stripe from its data and compare it with the parity read, XOR and, when q is
+// given, Q. check holds one chunk, two with q. Returns the number of stripes that do not match.
+static long long checkStripes(unsigned char *stripes, unsigned char *parity, unsigned char *q, unsigned char *check,
+    int count, int chunkSize)
+{
+    const unsigned char *src[STRIPE_DATA_CHUNKS];
+    long long badCnt = 0;
+    int s, k;
+
+    for (s = 0; s < count; s++)
+    {
+        for (k = 0; k < STRIPE_DATA_CHUNKS; k++)
+            src[k] = stripes + ((size_t)s * STRIPE_DATA_CHUNKS + k) * chunkSize;
+
+        if (q != NULL)
+        {
+            pqParity(check, check + chunkSize, src, STRIPE_DATA_CHUNKS, chunkSize);
+            if ((memcmp(check, parity + (size_t)s * chunkSize, chunkSize) != 0) ||
+                (memcmp(check + chunkSize, q + (size_t)s * chunkSize, chunkSize) != 0))
+                badCnt++;
+        }
+        else
+        {
+            xorParity(check, src, STRIPE_DATA_CHUNKS, chunkSize);
+            if (memcmp(check, parity + (size_t)s * chunkSize, chunkSize) != 0)
+                badCnt++;
+        }
+    }
+
+    return badCnt;
+}
+
+
+static void *stripeWorker(void *arg)
+{
+    stripeJob *job = (stripeJob *)arg;
+    int chunkSize = job->config->chunkSize, stripeData = STRIPE_DATA_CHUNKS * job->config->chunkSize, count;
+    int raid6 = job->config->raid6;
+    unsigned char *stripes, *parity, *q = NULL, *check = NULL;
+    long long stripeIdx, towrite, badCnt = 0;
+    struct iovec *iov;
+    int rc = OK;
+
+    if (allocBatch(job->batch, chunkSize, raid6, &stripes, &parity, &iov) == ERROR)
+    {
+        __atomic_store_n(&job->rc, ERROR, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    if (raid6)
+        q = parity + (size_t)job->batch * chunkSize;
+    if ((job->fdout < 0) && ((check = malloc((size_t)(raid6 ? 2 : 1) * chunkSize)) == NULL))
+        rc = ERROR;
+
+    while ((rc == OK) && (__atomic_load_n(&job->rc, __ATOMIC_RELAXED) == OK) &&
+           ((stripeIdx = __atomic_fetch_add(&job->nextStripe, job->batch, __ATOMIC_RELAXED)) < job->stripeCnt))
+    {
+        count = (job->stripeCnt - stripeIdx < job->batch) ? (int)(job->stripeCnt - stripeIdx) : job->batch;
+
+        if ((rc = readStripes(job->fd, stripes, parity, q, iov, count, stripeIdx, chunkSize)) == ERROR)
+            break;
+
+        rebuildStripes(stripes, parity, q, count, job->missingA, job->missingB, chunkSize);
+
+        if (job->fdout < 0)
+        {
+            badCnt += checkStripes(stripes, parity, q, check, count, chunkSize);
+            continue;
+        }
+
+        towrite = (long long)count * stripeData;
+        if (stripeIdx * stripeData + towrite > job->fileLength)
+            towrite = job->fileLength - stripeIdx * stripeData;
+        rc = fullPwrite(job->fdout, stripes, towrite, (off_t)stripeIdx * stripeData);
+    }
+
+    __atomic_fetch_add(&job->badCnt, badCnt, __ATOMIC_RELAXED);
+    if (rc == ERROR)
+        __atomic_store_n(&job->rc, ERROR, __ATOMIC_RELAXED);
+
+    freeBatch(stripes, parity, iov);
+    free(check);
+    return NULL;
+}
+
+
+int stripeThreads(const stripeConfig *config)
+{
+    int threads = config->threads;
+
+    if (threads <= 0)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1)
+        threads = 1;
+    if (threads > STRIPE_MAX_THREADS)
+        threads = STRIPE_MAX_THREADS;
+
+    return threads;
+}
+
+
+// Runs the job on the calling thread alone or on a pool of workers
+static int runStripeJob(stripeJob *job)
+{
+    pthread_t threads[STRIPE_MAX_THREADS];
+    int idx, started, nthreads = stripeThreads(job->config);
+
+    job->stripeCnt = (job->fileLength + (long long)STRIPE_DATA_CHUNKS * job->config->chunkSize - 1) /
+                     ((long long)STRIPE_DATA_CHUNKS * job->config->chunkSize);
+    job->nextStripe = 0;
+    job->badCnt = 0;
+    job->rc = OK;
+
+    if (nthreads == 1)
+    {
+        stripeWorker(job);
+        return job->rc;
+    }
+
+    for (started = 0; started < nthreads; started++)
+        if (pthread_create(&threads[started], NULL, stripeWorker, job) != 0)
+            break;
+
+    // Whatever started still finishes the job, only none at all is an error
+    for (idx = 0; idx < started; idx++)
+        pthread_join(threads[idx], NULL);
+    if (started == 0)
+        job->rc = ERROR;
+
+    return job->rc;
+}
+
+
+// Checks the missing chunks against config and orders them so missingA is set whenever missingB is
+static int missingChunks(int *missingA, int *missingB, const stripeConfig *config)
+{
+    int swap;
+
+    if ((*missingA < 0) || (*missingA > chunkFiles(config)) || (*missingB < 0) || (*missingB > chunkFiles(config)))
+        return ERROR;
+    if (*missingA == 0)
+    {
+        swap = *missingA;
+        *missingA = *missingB;
+        *missingB = swap;
+    }
+    if ((*missingB != 0) && (!config->raid6 || (*missingA == *missingB)))
+        return ERROR;
+
+    return OK;
+}
+
+
+long long restoreFileV(const char *outputFileName, long long fileLength, int missingA, int missingB,
+    const stripeConfig *config)
+{
+    stripeJob job;
+
+    if (((job.batch = stripeBatch(config)) == ERROR) || (missingChunks(&missingA, &missingB, config) == ERROR))
+        return ERROR;
+
+    job.config = config;
+    job.missingA = missingA;
+    job.missingB = missingB;
+    job.fileLength = fileLength;
+
+    if ((job.fdout = open(outputFileName, O_WRONLY | O_CREAT | O_TRUNC, 00644)) < 0)
+    {
+        perror(outputFileName);
+        return ERROR;
+    }
+    if (openChunks(job.fd, O_RDONLY, missingA, missingB, config) == ERROR)
+    {
+        close(job.fdout);
+        return ERROR;
+    }
+
+    if (runStripeJob(&job) == ERROR)
+        perror("restoreFileV");
+
+    close(job.fdout);
+    closeChunks(job.fd);
+
+    return (job.rc == ERROR) ? ERROR : fileLength;
+}
+
+
+long long verifyStripes(long long fileLength, int missingA, int missingB, const stripeConfig *config)
+{
+    stripeJob job;
+
+    if (((job.batch = stripeBatch(config)) == ERROR) || (missingChunks(&missingA, &missingB, config) == ERROR))
+        return ERROR;
+
+    job.config = config;
+    job.fdout = -1;
+    job.missingA = missingA;
+    job.missingB = missingB;
+    job.fileLength = fileLength;
+
+    if (openChunks(job.fd, O_RDONLY, missingA, missingB, config) == ERROR)
+        return ERROR;
+
+    if (runStripeJob(&job) == ERROR)
+        perror("verifyStripes");
+
+    closeChunks(job.fd);
+
+    return (job.rc == ERROR) ? ERROR : job.badCnt;
+}
@@ -0,0 +1,66 @@
+#ifndef RAIDSTRIPE_H
+#define RAIDSTRIPE_H
+
+// Large stripe striping engine
+//
+// Same 4 data + 1 XOR chunk files as stripeFile/restoreFile, but with a configurable chunk size and many stripes
+// moved per system call. With config->raid6 a sixth chunk file holds the RAID-6 Q syndrome of raidparity.h, so
+// restore and verify survive any two lost chunk files. stripeFile/restoreFile themselves stay single parity.
+//
+// A batch of stripes is read from the input file with one pread, then scattered to each chunk file with one pwritev
+// whose iovecs point at that chunk of every stripe in the batch. Restore gathers with preadv the same way and writes
+// the output with one pwrite per batch.
+//
+// restoreFileV and verifyStripes split the stripes over config->threads workers, each with its own buffers and
+// positional reads and writes on shared descriptors, so rebuild and scrub scale until the devices saturate.
+//
+// Chunk file k holds chunk k of stripe 0, 1, 2, ... back to back, so with a 512 byte chunk the layout would be
+// the one stripeFile writes. Chunks past the end of the input are zero filled.
+//
+#define STRIPE_DATA_CHUNKS (4)
+#define STRIPE_CHUNKS (STRIPE_DATA_CHUNKS + 2)
+
+// Chunk numbers as passed to restoreFileV and verifyStripes, 1 ... 4 are the data chunks
+#define STRIPE_XOR_CHUNK (STRIPE_DATA_CHUNKS + 1)
+#define STRIPE_Q_CHUNK (STRIPE_DATA_CHUNKS + 2)
+
+#define STRIPE_MIN_CHUNK (4 * 1024)
+#define STRIPE_MAX_CHUNK (1024 * 1024)
+
+// Default amount of input per batch when stripesPerIO is 0
+#define STRIPE_BATCH_BYTES (8 * 1024 * 1024)
+
+#define STRIPE_MAX_THREADS (64)
+
+typedef struct
+{
+    int chunkSize;    // bytes per chunk, a multiple of 4 KB from STRIPE_MIN_CHUNK to STRIPE_MAX_CHUNK
+    int stripesPerIO; // stripes per system call, 0 for STRIPE_BATCH_BYTES worth, at most IOV_MAX
+    int direct;       // open the chunk files O_DIRECT, falls back to buffered I/O if the file system refuses
+    int threads;      // workers for restore and verify, 0 for one per online CPU, at most STRIPE_MAX_THREADS
+    int raid6;        // also write and use the Q chunk file, the same setting must be used to restore and verify
+} stripeConfig;
+
+extern const char *stripeChunkNames[STRIPE_CHUNKS];
+
+// Returns the number of stripes moved per call for config, or ERROR if config is out of range
+int stripeBatch(const stripeConfig *config);
+
+// Returns the number of workers restore and verify use for config
+int stripeThreads(const stripeConfig *config);
+
+// Stripe inputFileName into the chunk files. Returns bytes striped or ERROR.
+long long stripeFileV(const char *inputFileName, const stripeConfig *config);
+
+// Rebuild fileLength bytes into outputFileName. missingA and missingB are 0 for none, 1 ... 4 for a data chunk,
+// STRIPE_XOR_CHUNK or STRIPE_Q_CHUNK, and those files are not opened. Only one chunk may be missing without
+// config->raid6. Returns bytes restored or ERROR.
+long long restoreFileV(const char *outputFileName, long long fileLength, int missingA, int missingB,
+    const stripeConfig *config);
+
+// Scrub: check that the parity of every stripe of a fileLength byte file matches its data, XOR and with
+// config->raid6 also Q. Missing chunks are rebuilt first, so a stripe is only checked against the redundancy left.
+// Returns the number of bad stripes or ERROR.
+long long verifyStripes(long long fileLength, int missingA, int missingB, const stripeConfig *config);
+
+#endif
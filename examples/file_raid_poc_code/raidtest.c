@@ -166,5 +166,47 @@ int main(int argc, char *argv[])
     //
     // END TEST CASE #2
 
+
+    // TEST CASE #3
+    //
+    // RAID-6 double fault: for every pair of the 4 data + P + Q LBAs, wipe
+    // both and verify the rebuild against the originals.
+    //
+    printf("TEST CASE 3 (RAID-6 rebuild of every pair of lost LBAs):\n");
+
+    for (idx = 0; idx < numTestIterations; idx++)
+    {
+        unsigned char orig[6][SECTOR_SIZE], work[6][SECTOR_SIZE], *stripe[6];
+        int lostA, lostB, lba;
+
+        LBAidx = idx % MAX_LBAS;
+        memcpy(orig[0], testLBA1[LBAidx], SECTOR_SIZE);
+        memcpy(orig[1], testLBA2[LBAidx], SECTOR_SIZE);
+        memcpy(orig[2], testLBA3[LBAidx], SECTOR_SIZE);
+        memcpy(orig[3], testLBA4[LBAidx], SECTOR_SIZE);
+        modifyBuffer(orig[idx % 4], idx);
+        pqLBA(orig[0], orig[1], orig[2], orig[3], orig[4], orig[5]);
+
+        for (lostA = 0; lostA < 6; lostA++)
+        {
+            for (lostB = lostA + 1; lostB < 6; lostB++)
+            {
+                memcpy(work, orig, sizeof(work));
+                for (lba = 0; lba < 6; lba++)
+                    stripe[lba] = work[lba];
+                memcpy(work[lostA], NULL_RAID_STRING, SECTOR_SIZE);
+                memcpy(work[lostB], NULL_RAID_STRING, SECTOR_SIZE);
+
+                rc = rebuildTwoLBA(stripe, lostA, lostB);
+                assert(rc == OK);
+                assert(memcmp(work, orig, sizeof(work)) == 0);
+            }
+        }
+    }
+    printf("%d stripes x 15 pairs rebuilt\n", numTestIterations);
+
+    //
+    // END TEST CASE #3
+
     printf("FINISHED\n");
 }
@@ -0,0 +1,177 @@
+#include <pthread.h>
+
+#include "ecc72lib.h"
+
+// ecc72_syn[k][b] is the XOR of the encoded positions of the set bits of byte b in data byte k of the word, so
+// the check bits of a word are 8 lookups. ecc72_data[s] is the data bit at position s, or -1 for a check bit.
+static unsigned char ecc72_syn[8][256];
+static signed char ecc72_data[128];
+static int ecc72_pos[64];
+static pthread_once_t tables_once=PTHREAD_ONCE_INIT;
+
+static void build_tables(void)
+{
+    int bit, pos, byte, value;
+
+    for(pos=0; pos < 128; pos++) ecc72_data[pos]=-1;
+
+    for(bit=0, pos=3; bit < 64; pos++)
+    {
+        if((pos & (pos - 1)) == 0) continue;
+        ecc72_pos[bit]=pos;
+        ecc72_data[pos]=bit++;
+    }
+
+    for(byte=0; byte < 8; byte++)
+        for(value=0; value < 256; value++)
+        {
+            ecc72_syn[byte][value]=0;
+            for(bit=0; bit < 8; bit++)
+                if(value & (1 << bit)) ecc72_syn[byte][value] ^= ecc72_pos[byte*8 + bit];
+        }
+}
+
+
+static void init_tables(void)
+{
+    pthread_once(&tables_once, build_tables);
+}
+
+
+static inline unsigned char syndrome72(uint64_t word)
+{
+    return ecc72_syn[0][word & 0xFF] ^ ecc72_syn[1][(word >> 8) & 0xFF] ^
+           ecc72_syn[2][(word >> 16) & 0xFF] ^ ecc72_syn[3][(word >> 24) & 0xFF] ^
+           ecc72_syn[4][(word >> 32) & 0xFF] ^ ecc72_syn[5][(word >> 40) & 0xFF] ^
+           ecc72_syn[6][(word >> 48) & 0xFF] ^ ecc72_syn[7][word >> 56];
+}
+
+
+static inline unsigned char encode72(uint64_t word)
+{
+    unsigned char syn = syndrome72(word);
+
+    return syn | ((__builtin_parityll(word) ^ __builtin_parity(syn)) << 7);
+}
+
+
+// Same decision as read_byte: SYNDROME from the check bits, pW from the parity of all 72 bits
+static inline int status72(uint64_t word, unsigned char code)
+{
+    unsigned char syn = (syndrome72(word) ^ code) & P72_BITS;
+    int pw = __builtin_parityll(word) ^ __builtin_parity(code);
+
+    if((syn == 0) && !pw) return NO_ERROR;
+    if(syn == 0) return PW_ERROR;
+    if(!pw) return DOUBLE_BIT_ERROR;
+    if(syn >= ECC72_POSITIONS) return UNKNOWN_ERROR;
+    return syn;
+}
+
+
+unsigned char get_codeword72(uint64_t word)
+{
+    init_tables();
+    return encode72(word);
+}
+
+
+int data_bit_position72(int bit)
+{
+    init_tables();
+    return ecc72_pos[bit];
+}
+
+
+int ecc72_check_word(uint64_t word, unsigned char code)
+{
+    init_tables();
+    return status72(word, code);
+}
+
+
+// Repair one word and its code after status72, DBEs and MBEs are left alone
+static inline void correct72(uint64_t *word, unsigned char *code, int rc)
+{
+    if(rc == DOUBLE_BIT_ERROR || rc == UNKNOWN_ERROR) return;
+
+    if(rc > 0 && ecc72_data[rc] >= 0) *word ^= 1ULL << ecc72_data[rc];
+    *code = encode72(*word);
+}
+
+
+int write_word(ecc72_t *ecc, uint64_t *address, uint64_t wordToWrite)
+{
+    unsigned int offset = address - ecc->data_memory;
+
+    ecc->data_memory[offset] = wordToWrite;
+    ecc->code_memory[offset] = get_codeword72(wordToWrite);
+
+    return NO_ERROR;
+}
+
+
+int read_word(ecc72_t *ecc, uint64_t *address, uint64_t *wordRead)
+{
+    unsigned int offset = address - ecc->data_memory;
+    int rc;
+
+    rc = ecc72_check_word(ecc->data_memory[offset], ecc->code_memory[offset]);
+    if(rc != NO_ERROR) correct72(&ecc->data_memory[offset], &ecc->code_memory[offset], rc);
+
+    *wordRead = ecc->data_memory[offset];
+    return rc;
+}
+
+
+uint64_t *enable_ecc72_memory(ecc72_t *ecc)
+{
+    int idx;
+
+    init_tables();
+    for(idx=0; idx < ECC72_WORDS; idx++) ecc->code_memory[idx]=0;
+    return ecc->data_memory;
+}
+
+
+void ecc72_encode_block(const uint64_t *data, unsigned char *code, size_t words)
+{
+    size_t idx;
+
+    init_tables();
+    for(idx=0; idx < words; idx++)
+        code[idx] = encode72(data[idx]);
+}
+
+
+size_t ecc72_check_block(uint64_t *data, unsigned char *code, size_t words, ecc_counts_t *counts, int correct)
+{
+    size_t idx, bad=0;
+    int rc;
+
+    init_tables();
+
+    for(idx=0; idx < words; idx++)
+    {
+        if((rc = status72(data[idx], code[idx])) == NO_ERROR) continue;
+
+        if(counts)
+        {
+            if(rc == PW_ERROR) counts->pw++;
+            else if(rc == DOUBLE_BIT_ERROR) counts->dbe++;
+            else if(rc == UNKNOWN_ERROR) counts->mbe++;
+            else counts->sbe++;
+        }
+
+        if(rc == DOUBLE_BIT_ERROR || rc == UNKNOWN_ERROR) bad++;
+        else if(correct) correct72(&data[idx], &code[idx], rc);
+    }
+
+    return bad;
+}
+
+
+size_t ecc72_scrub(ecc72_t *ecc, ecc_counts_t *counts)
+{
+    return ecc72_check_block(ecc->data_memory, ecc->code_memory, ECC72_WORDS, counts, 1);
+}
@@ -0,0 +1,51 @@
+#ifndef ECC72LIB_H
+#define ECC72LIB_H
+
+#include <stdint.h>
+
+#include "ecclib.h"
+
+// (72,64) SECDED word layout
+//
+// The byte layout keeps a whole code byte per data byte, 100% overhead. Here each 64-bit data word gets one code
+// byte, 12.5% overhead, the way ECC DIMMs protect a 72 bit bus word. It is the same Hamming code as the byte
+// layout, just wider: encoded bit positions 1..71 with check bits p1..p7 at positions 1, 2, 4, ... 64, the 64
+// data bits at the other positions in order, and pW at position 0 for even parity over all 72 bits.
+//
+// Code byte: p1..p7 in bits 0..6 (P72_BITS), pW in bit 7 (PW72_BIT). The return codes are read_byte's, an SBE
+// returns its position in the encoded word.
+//
+#define ECC72_WORDS (MEM_SIZE / 8)
+#define ECC72_POSITIONS (72)
+
+#define P72_BITS (0x7F)
+#define PW72_BIT (0x80)
+
+typedef struct emulated_ecc72
+{
+    uint64_t data_memory[ECC72_WORDS];
+    unsigned char code_memory[ECC72_WORDS];
+} ecc72_t;
+
+unsigned char get_codeword72(uint64_t word);
+
+// Encoded word position (1..71) of data bit 0..63
+int data_bit_position72(int bit);
+
+// Same return codes as read_word for a data word and its stored code byte
+int ecc72_check_word(uint64_t word, unsigned char code);
+
+int write_word(ecc72_t *ecc, uint64_t *address, uint64_t wordToWrite);
+
+// Returns NO_ERROR, PW_ERROR, DOUBLE_BIT_ERROR, UNKNOWN_ERROR for a syndrome past position 71, or the position of
+// a single bit error. SBEs and pW errors are corrected in memory and in *wordRead.
+int read_word(ecc72_t *ecc, uint64_t *address, uint64_t *wordRead);
+
+uint64_t *enable_ecc72_memory(ecc72_t *ecc);
+
+// Bulk forms over any number of words, as ecc_encode_block and ecc_check_block
+void ecc72_encode_block(const uint64_t *data, unsigned char *code, size_t words);
+size_t ecc72_check_block(uint64_t *data, unsigned char *code, size_t words, ecc_counts_t *counts, int correct);
+size_t ecc72_scrub(ecc72_t *ecc, ecc_counts_t *counts);
+
+#endif
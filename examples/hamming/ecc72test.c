@@ -0,0 +1,151 @@
+#include <assert.h>
+#include <string.h>
+#include "ecc72lib.h"
+
+void flip_bit72(ecc72_t *ecc, uint64_t *address, unsigned short position);
+unsigned char reference_codeword72(uint64_t word);
+
+#define PATTERNS (6)
+
+int main(void)
+{
+    static const uint64_t pattern[PATTERNS] = {0x0ULL, 0xFFFFFFFFFFFFFFFFULL, 0xABABABABABABABABULL,
+                                                0x0123456789ABCDEFULL, 0x8000000000000001ULL, 0x5A5A5A5AA5A5A5A5ULL};
+    static ecc72_t ECC;
+    uint64_t *base_addr=enable_ecc72_memory(&ECC);
+    unsigned int offset=0, sbes=0, dbes=0;
+    int p, i, j, rc;
+    uint64_t wordToRead;
+    ecc_counts_t counts;
+
+    printf("(72,64) SECDED: %d data bytes, %d code bytes, %.1lf%% overhead\n\n",
+           (int)sizeof(ECC.data_memory), (int)sizeof(ECC.code_memory),
+           100.0 * sizeof(ECC.code_memory) / sizeof(ECC.data_memory));
+
+    // TEST CASE 1: the table driven code matches a bit at a time Hamming encoder
+    printf("**** TEST CASE 1: Encode matches reference *******\n");
+    for(p=0; p < PATTERNS; p++)
+        assert(get_codeword72(pattern[p]) == reference_codeword72(pattern[p]));
+    for(i=0; i < 64; i++)
+        assert(get_codeword72(1ULL << i) == reference_codeword72(1ULL << i));
+    printf("**** END TEST CASE 1 *****************************\n\n");
+
+
+    // TEST CASE 2: every SBE, 72 positions, is found at its position and corrected
+    printf("**** TEST CASE 2: All %d SBE cases ***************\n", ECC72_POSITIONS);
+    for(p=0; p < PATTERNS; p++)
+        for(i=0; i < ECC72_POSITIONS; i++)
+        {
+            write_word(&ECC, base_addr+offset, pattern[p]);
+            flip_bit72(&ECC, base_addr+offset, i);
+            rc=read_word(&ECC, base_addr+offset, &wordToRead);
+            assert(rc == (i == 0 ? PW_ERROR : i));
+            assert(wordToRead == pattern[p]);
+            assert((rc=read_word(&ECC, base_addr+offset, &wordToRead)) == NO_ERROR);
+            sbes++;
+        }
+    printf("%u SBE cases passed\n", sbes);
+    printf("**** END TEST CASE 2 *****************************\n\n");
+
+
+    // TEST CASE 3: every DBE, 72*71/2 = 2556 pairs, is detected and left alone
+    printf("**** TEST CASE 3: All %d DBE cases *************\n", ECC72_POSITIONS * (ECC72_POSITIONS - 1) / 2);
+    for(p=0; p < PATTERNS; p++)
+        for(i=0; i < ECC72_POSITIONS; i++)
+            for(j=i+1; j < ECC72_POSITIONS; j++)
+            {
+                write_word(&ECC, base_addr+offset, pattern[p]);
+                flip_bit72(&ECC, base_addr+offset, i);
+                flip_bit72(&ECC, base_addr+offset, j);
+                assert((rc=read_word(&ECC, base_addr+offset, &wordToRead)) == DOUBLE_BIT_ERROR);
+                flip_bit72(&ECC, base_addr+offset, j);
+                flip_bit72(&ECC, base_addr+offset, i);
+                assert((rc=read_word(&ECC, base_addr+offset, &wordToRead)) == NO_ERROR);
+                dbes++;
+            }
+    printf("%u DBE cases passed\n", dbes);
+    printf("**** END TEST CASE 3 *****************************\n\n");
+
+
+    // TEST CASE 4: Read after Write all, then scrub an SBE out of every word
+    printf("**** TEST CASE 4: Write all, scrub all ***********\n");
+    for(offset=0; offset < ECC72_WORDS; offset++)
+        write_word(&ECC, base_addr+offset, pattern[offset % PATTERNS] ^ ((uint64_t)offset << 17));
+    for(offset=0; offset < ECC72_WORDS; offset++)
+        assert((rc=read_word(&ECC, base_addr+offset, &wordToRead)) == NO_ERROR);
+
+    for(offset=0; offset < ECC72_WORDS; offset++)
+        flip_bit72(&ECC, base_addr+offset, offset % ECC72_POSITIONS);
+    memset(&counts, 0, sizeof(counts));
+    assert(ecc72_scrub(&ECC, &counts) == 0);
+    assert(counts.sbe + counts.pw == ECC72_WORDS && counts.dbe == 0 && counts.mbe == 0);
+
+    for(offset=0; offset < ECC72_WORDS; offset++)
+    {
+        assert((rc=read_word(&ECC, base_addr+offset, &wordToRead)) == NO_ERROR);
+        assert(wordToRead == (pattern[offset % PATTERNS] ^ ((uint64_t)offset << 17)));
+    }
+    printf("**** END TEST CASE 4 *****************************\n\n");
+
+    return NO_ERROR;
+}
+
+
+// flip bit at an encoded word position: pW p1 p2 d0 p3 d1 d2 d3 p4 d4 ... d63
+// position:                            00 01 02 03 04 05 06 07 08 09 ... 71
+void flip_bit72(ecc72_t *ecc, uint64_t *address, unsigned short position)
+{
+    unsigned int offset = address - ecc->data_memory;
+    int bit;
+
+    if(position >= ECC72_POSITIONS)
+    {
+        printf("flipped bit OUT OF RANGE\n");
+        return;
+    }
+
+    if(position == 0)
+    {
+        ecc->code_memory[offset] ^= PW72_BIT;
+        return;
+    }
+
+    // check bit pK sits at position 2^(K-1), which is also its mask in the code byte
+    if((position & (position - 1)) == 0)
+    {
+        ecc->code_memory[offset] ^= (unsigned char)position;
+        return;
+    }
+
+    for(bit=0; bit < 64; bit++)
+        if(data_bit_position72(bit) == position)
+        {
+            ecc->data_memory[offset] ^= 1ULL << bit;
+            return;
+        }
+}
+
+
+// Each check bit pK covers the positions with bit K-1 set, pW makes all 72 bits even
+unsigned char reference_codeword72(uint64_t word)
+{
+    unsigned char codeword=0;
+    int check, bit, ones=0;
+
+    for(check=0; check < 7; check++)
+    {
+        int parity=0;
+
+        for(bit=0; bit < 64; bit++)
+            if((word >> bit) & 1)
+                parity ^= (data_bit_position72(bit) >> check) & 1;
+
+        codeword |= parity << check;
+    }
+
+    for(bit=0; bit < 64; bit++) ones += (word >> bit) & 1;
+    for(check=0; check < 7; check++) ones += (codeword >> check) & 1;
+    if(ones & 1) codeword |= PW72_BIT;
+
+    return codeword;
+}
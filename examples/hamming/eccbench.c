@@ -0,0 +1,193 @@
+// Bulk ECC encode and scrub throughput
+//
+// Times the per-byte write_byte/read_byte path over an ecc_t against ecc_encode_block and ecc_check_block over a
+// large buffer, then injects single and double bit errors across the buffer and checks the scrub finds and fixes
+// every one of them. The same again for the (72,64) word layout, with the cost per 64-bit word of each.
+//
+// Usage: eccbench [MB]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ecc72lib.h"
+
+#define DEFAULT_MB (64)
+#define PASSES (4)
+
+
+static void report(const char *name, size_t bytes, double seconds)
+{
+    printf("%-18s %9.1lf MB/s %8.2lf ns/word\n", name, bytes / seconds / (1024.0 * 1024.0),
+           seconds * 1000000000.0 / (bytes / 8));
+}
+
+
+static double now_sec(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    static ecc_t ECC;
+    static ecc72_t ECC72;
+    unsigned char *base_addr=enable_ecc_memory(&ECC);
+    uint64_t *base_addr72=enable_ecc72_memory(&ECC72), wordRead, *words;
+    unsigned char *data, *code, byteRead;
+    size_t len, idx, bad;
+    ecc_counts_t counts;
+    double fstart, fstop;
+    int pass, offset, errors=0;
+    unsigned int sbes=0, dbes=0;
+
+    len = (size_t)(argc > 1 ? atoi(argv[1]) : DEFAULT_MB) * 1024 * 1024;
+    if(len == 0 || (data=malloc(len)) == NULL || (code=malloc(len)) == NULL)
+    {
+        printf("Usage: eccbench [MB]\n");
+        exit(-1);
+    }
+
+    srandom(1);
+    for(idx=0; idx < len; idx++) data[idx]=(unsigned char)random();
+
+    printf("bulk path %s, %zu MB\n", ecc_block_path(), len / (1024 * 1024));
+
+    // per-byte reference, MEM_SIZE at a time
+    fstart=now_sec();
+    for(idx=0; idx < len; idx+=MEM_SIZE)
+        for(offset=0; offset < MEM_SIZE; offset++)
+            write_byte(&ECC, base_addr+offset, data[idx+offset]);
+    fstop=now_sec();
+    report("write_byte", len, fstop - fstart);
+
+    fstart=now_sec();
+    for(idx=0; idx < len; idx+=MEM_SIZE)
+        for(offset=0; offset < MEM_SIZE; offset++)
+            errors+=(read_byte(&ECC, base_addr+offset, &byteRead) != NO_ERROR);
+    fstop=now_sec();
+    report("read_byte", len, fstop - fstart);
+
+    fstart=now_sec();
+    for(idx=0; idx < len; idx+=MEM_SIZE)
+        errors+=ecc_scrub(&ECC, NULL);
+    fstop=now_sec();
+    report("ecc_scrub", len, fstop - fstart);
+
+    fstart=now_sec();
+    for(pass=0; pass < PASSES; pass++)
+        ecc_encode_block(data, code, len);
+    fstop=now_sec();
+    report("ecc_encode_block", PASSES * len, fstop - fstart);
+
+    // bulk must match the per-byte code exactly
+    for(idx=0; idx < len; idx+=len / 4096)
+    {
+        ECC.data_memory[0]=data[idx];
+        if(code[idx] != get_codeword(&ECC, 0))
+            errors++;
+    }
+
+    fstart=now_sec();
+    for(pass=0; pass < PASSES; pass++)
+        errors+=ecc_check_block(data, code, len, NULL, 0);
+    fstop=now_sec();
+    report("ecc_check_block", PASSES * len, fstop - fstart);
+
+    // one error every 4 KB or so, every third one a DBE
+    for(idx=random() % 4096; idx < len; idx+=1 + random() % 8192)
+    {
+        if(((sbes + dbes) % 3) == 2)
+        {
+            data[idx]^=(unsigned char)(1 << (random() % 8));
+            code[idx]^=(unsigned char)(1 << (random() % 5));
+            dbes++;
+        }
+        else if(random() & 1)
+        {
+            data[idx]^=(unsigned char)(1 << (random() % 8));
+            sbes++;
+        }
+        else
+        {
+            code[idx]^=(unsigned char)(1 << (random() % 5));
+            sbes++;
+        }
+    }
+
+    memset(&counts, 0, sizeof(counts));
+    fstart=now_sec();
+    bad=ecc_check_block(data, code, len, &counts, 1);
+    fstop=now_sec();
+    printf("scrub with errors %9.1lf MB/s: injected %u SBE %u DBE, found %llu SBE %llu PW %llu DBE %llu MBE\n",
+           len / (fstop - fstart) / (1024.0 * 1024.0), sbes, dbes, counts.sbe, counts.pw, counts.dbe, counts.mbe);
+
+    if(counts.sbe + counts.pw != sbes || counts.dbe != dbes || bad != dbes)
+        errors++;
+
+    // corrected bytes now check clean, the DBEs are still there
+    memset(&counts, 0, sizeof(counts));
+    if(ecc_check_block(data, code, len, &counts, 0) != dbes || counts.sbe + counts.pw != 0)
+        errors++;
+
+    // (72,64) word layout over the same buffer, one code byte per 8 data bytes
+    printf("\n(72,64) words, %.1lf%% overhead\n", 100.0 / 8);
+    words = (uint64_t *)data;
+    for(idx=0; idx < len; idx++) data[idx]=(unsigned char)random();
+
+    fstart=now_sec();
+    for(idx=0; idx < len / 8; idx+=ECC72_WORDS)
+        for(offset=0; offset < ECC72_WORDS; offset++)
+            write_word(&ECC72, base_addr72+offset, words[idx+offset]);
+    fstop=now_sec();
+    report("write_word", len, fstop - fstart);
+
+    fstart=now_sec();
+    for(idx=0; idx < len / 8; idx+=ECC72_WORDS)
+        for(offset=0; offset < ECC72_WORDS; offset++)
+            errors+=(read_word(&ECC72, base_addr72+offset, &wordRead) != NO_ERROR);
+    fstop=now_sec();
+    report("read_word", len, fstop - fstart);
+
+    fstart=now_sec();
+    for(pass=0; pass < PASSES; pass++)
+        ecc72_encode_block(words, code, len / 8);
+    fstop=now_sec();
+    report("ecc72_encode_block", PASSES * len, fstop - fstart);
+
+    fstart=now_sec();
+    for(pass=0; pass < PASSES; pass++)
+        errors+=ecc72_check_block(words, code, len / 8, NULL, 0);
+    fstop=now_sec();
+    report("ecc72_check_block", PASSES * len, fstop - fstart);
+
+    // one SBE every few hundred words, every third one a DBE
+    for(idx=random() % 512, sbes=dbes=0; idx < len / 8; idx+=1 + random() % 1024)
+    {
+        words[idx]^=1ULL << (random() % 64);
+        if(((sbes + dbes) % 3) == 2)
+        {
+            code[idx]^=(unsigned char)(1 << (random() % 8));
+            dbes++;
+        }
+        else
+            sbes++;
+    }
+
+    memset(&counts, 0, sizeof(counts));
+    bad=ecc72_check_block(words, code, len / 8, &counts, 1);
+    printf("scrub with errors: injected %u SBE %u DBE, found %llu SBE %llu DBE\n", sbes, dbes, counts.sbe, counts.dbe);
+    if(counts.sbe != sbes || counts.dbe != dbes || bad != dbes)
+        errors++;
+
+    printf("%s\n", errors ? "FAILED" : "PASSED");
+
+    free(data);
+    free(code);
+    return errors ? -1 : NO_ERROR;
+}
@@ -1,5 +1,16 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
 #include "ecclib.h"
 
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ECC_NEON
+#endif
+
 static int printTrace=0;
 
 void traceOn(void)
@@ -102,8 +113,11 @@ int read_byte(ecc_t *ecc, unsigned char *address, unsigned char *byteRead) {
 }
 
 
+static void init_tables(void);
+
 unsigned char *enable_ecc_memory(ecc_t *ecc){
     int idx;
+    init_tables();
     for(idx=0; idx < MEM_SIZE; idx++) ecc->code_memory[idx]=0;
     return ecc->data_memory;
 }
@@ -265,3 +279,246 @@ void print_code(unsigned char codeword)
 
     printf("\n");
 }
+
+
+// Bulk encode and check tables
+//
+// ecc_code[d] is get_codeword for data byte d. ecc_status[diff] is the read_byte return code for the 5 bit
+// difference diff = (ecc_code[d] ^ stored) & (SYNBITS | PW_BIT): read_byte's pW2 works out to the computed pW
+// XOR the parity of SYNDROME, so pW != pW2 is just the parity of diff. ecc_syn_data maps a SYNDROME, the bit
+// position in the encoded word pW p1 p2 d1 p3 d2 d3 d4 p4 d5 d6 d7 d8, to the data bit there (0 for parity bits).
+//
+// The tables are built from get_codeword itself, so the bulk path can't drift from the per-byte one.
+#define DIFF_BITS (SYNBITS | PW_BIT)
+#define LANES_01 (0x0101010101010101ULL)
+
+static unsigned char ecc_code[256];
+static unsigned char ecc_code_lo[16], ecc_code_hi[16];
+static int ecc_status[DIFF_BITS + 1];
+static const unsigned char ecc_syn_data[16] =
+    {0, 0, 0, DATA_BIT_1, 0, DATA_BIT_2, DATA_BIT_3, DATA_BIT_4,
+     0, DATA_BIT_5, DATA_BIT_6, DATA_BIT_7, DATA_BIT_8, 0, 0, 0};
+static pthread_once_t tables_once=PTHREAD_ONCE_INIT;
+
+static void build_tables(void)
+{
+    static ecc_t scratch;
+    int idx, syn, parity;
+
+    for(idx=0; idx < 256; idx++)
+    {
+        scratch.data_memory[idx]=(unsigned char)idx;
+        ecc_code[idx]=get_codeword(&scratch, idx);
+    }
+
+    // linear in the data bits, so the low and high nibble codes XOR together, ENCODED_BIT kept once
+    for(idx=0; idx < 16; idx++)
+    {
+        ecc_code_lo[idx]=ecc_code[idx];
+        ecc_code_hi[idx]=ecc_code[idx << 4] ^ ecc_code[0];
+    }
+
+    for(idx=0; idx <= DIFF_BITS; idx++)
+    {
+        syn = idx & SYNBITS;
+        parity = __builtin_parity(idx);
+
+        if((syn == 0) && !parity) ecc_status[idx]=NO_ERROR;
+        else if(syn == 0) ecc_status[idx]=PW_ERROR;
+        else if(!parity) ecc_status[idx]=DOUBLE_BIT_ERROR;
+        else ecc_status[idx]=syn;
+    }
+}
+
+
+// Built once on first use, safe to call from any number of threads
+static void init_tables(void)
+{
+    pthread_once(&tables_once, build_tables);
+}
+
+
+const char *ecc_block_path(void)
+{
+#if defined(__SSSE3__)
+    return "ssse3";
+#elif defined(ECC_NEON)
+    return "neon";
+#else
+    return "word64";
+#endif
+}
+
+
+int ecc_check_byte(unsigned char data, unsigned char code)
+{
+    init_tables();
+    return ecc_status[(ecc_code[data] ^ code) & DIFF_BITS];
+}
+
+
+// Code bytes of 8 data bytes at once. A right shift by k brings bit k of each byte down to bit 0 of the same
+// byte, so each parity is a few shifts and XORs kept to bit 0 of every lane.
+static inline uint64_t encode_word(uint64_t d)
+{
+    uint64_t p1, p2, p3, p4, pd;
+
+    p1 = (d ^ (d>>1) ^ (d>>3) ^ (d>>4) ^ (d>>6)) & LANES_01;
+    p2 = (d ^ (d>>2) ^ (d>>3) ^ (d>>5) ^ (d>>6)) & LANES_01;
+    p3 = ((d>>1) ^ (d>>2) ^ (d>>3) ^ (d>>7)) & LANES_01;
+    p4 = ((d>>4) ^ (d>>5) ^ (d>>6) ^ (d>>7)) & LANES_01;
+
+    pd = d ^ (d>>4); pd ^= pd>>2; pd ^= pd>>1;
+    pd = (pd ^ p1 ^ p2 ^ p3 ^ p4) & LANES_01;
+
+    return p1 | (p2<<1) | (p3<<2) | (p4<<3) | (pd<<4) | (LANES_01 * ENCODED_BIT);
+}
+
+
+void ecc_encode_block(const unsigned char *data, unsigned char *code, size_t len)
+{
+    size_t idx=0;
+    uint64_t d, c;
+
+    init_tables();
+
+#if defined(__SSSE3__)
+    {
+        __m128i lo=_mm_loadu_si128((const __m128i *)ecc_code_lo);
+        __m128i hi=_mm_loadu_si128((const __m128i *)ecc_code_hi);
+        __m128i mask=_mm_set1_epi8(0x0F), v;
+
+        for(; idx + 16 <= len; idx+=16)
+        {
+            v=_mm_loadu_si128((const __m128i *)(data+idx));
+            v=_mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(v, mask)),
+                            _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(v, 4), mask)));
+            _mm_storeu_si128((__m128i *)(code+idx), v);
+        }
+    }
+#elif defined(ECC_NEON)
+    {
+        uint8x16_t lo=vld1q_u8(ecc_code_lo), hi=vld1q_u8(ecc_code_hi), mask=vdupq_n_u8(0x0F), v;
+
+        for(; idx + 16 <= len; idx+=16)
+        {
+            v=vld1q_u8(data+idx);
+            vst1q_u8(code+idx, veorq_u8(vqtbl1q_u8(lo, vandq_u8(v, mask)), vqtbl1q_u8(hi, vshrq_n_u8(v, 4))));
+        }
+    }
+#endif
+
+    for(; idx + 8 <= len; idx+=8)
+    {
+        memcpy(&d, data+idx, 8);
+        c=encode_word(d);
+        memcpy(code+idx, &c, 8);
+    }
+
+    for(; idx < len; idx++)
+        code[idx]=ecc_code[data[idx]];
+}
+
+
+static inline size_t check_bytes(unsigned char *data, unsigned char *code, size_t len, ecc_counts_t *counts,
+                                 int correct)
+{
+    size_t idx, bad=0;
+    int rc;
+
+    for(idx=0; idx < len; idx++)
+    {
+        rc=ecc_status[(ecc_code[data[idx]] ^ code[idx]) & DIFF_BITS];
+
+        if(rc == NO_ERROR) continue;
+
+        if(rc == PW_ERROR)
+        {
+            if(counts) counts->pw++;
+        }
+        else if(rc == DOUBLE_BIT_ERROR)
+        {
+            if(counts) counts->dbe++;
+            bad++;
+            continue;
+        }
+        else if(rc > 12)
+        {
+            if(counts) counts->mbe++;
+            bad++;
+            continue;
+        }
+        else
+        {
+            if(counts) counts->sbe++;
+            if(correct) data[idx] ^= ecc_syn_data[rc];
+        }
+
+        if(correct) code[idx]=ecc_code[data[idx]];
+    }
+
+    return bad;
+}
+
+
+size_t ecc_check_block(unsigned char *data, unsigned char *code, size_t len, ecc_counts_t *counts, int correct)
+{
+    size_t idx=0, bad=0;
+    uint64_t d, c;
+
+    init_tables();
+
+    // clean words are the common case, only a mismatch goes to the byte tables
+#if defined(__SSSE3__)
+    {
+        __m128i lo=_mm_loadu_si128((const __m128i *)ecc_code_lo);
+        __m128i hi=_mm_loadu_si128((const __m128i *)ecc_code_hi);
+        __m128i mask=_mm_set1_epi8(0x0F), diff=_mm_set1_epi8(DIFF_BITS), v;
+
+        for(; idx + 16 <= len; idx+=16)
+        {
+            v=_mm_loadu_si128((const __m128i *)(data+idx));
+            v=_mm_xor_si128(_mm_shuffle_epi8(lo, _mm_and_si128(v, mask)),
+                            _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(v, 4), mask)));
+            v=_mm_and_si128(_mm_xor_si128(v, _mm_loadu_si128((const __m128i *)(code+idx))), diff);
+
+            if(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF)
+                bad+=check_bytes(data+idx, code+idx, 16, counts, correct);
+        }
+    }
+#elif defined(ECC_NEON)
+    {
+        uint8x16_t lo=vld1q_u8(ecc_code_lo), hi=vld1q_u8(ecc_code_hi), mask=vdupq_n_u8(0x0F);
+        uint8x16_t diff=vdupq_n_u8(DIFF_BITS), v;
+
+        for(; idx + 16 <= len; idx+=16)
+        {
+            v=vld1q_u8(data+idx);
+            v=veorq_u8(vqtbl1q_u8(lo, vandq_u8(v, mask)), vqtbl1q_u8(hi, vshrq_n_u8(v, 4)));
+            v=vandq_u8(veorq_u8(v, vld1q_u8(code+idx)), diff);
+
+            if(vmaxvq_u8(v) != 0)
+                bad+=check_bytes(data+idx, code+idx, 16, counts, correct);
+        }
+    }
+#endif
+
+    for(; idx + 8 <= len; idx+=8)
+    {
+        memcpy(&d, data+idx, 8);
+        memcpy(&c, code+idx, 8);
+
+        if(((encode_word(d) ^ c) & (LANES_01 * DIFF_BITS)) != 0)
+            bad+=check_bytes(data+idx, code+idx, 8, counts, correct);
+    }
+
+    bad+=check_bytes(data+idx, code+idx, len-idx, counts, correct);
+
+    return bad;
+}
+
+
+size_t ecc_scrub(ecc_t *ecc, ecc_counts_t *counts)
+{
+    return ecc_check_block(ecc->data_memory, ecc->code_memory, MEM_SIZE, counts, 1);
+}
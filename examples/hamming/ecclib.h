@@ -1,3 +1,6 @@
+#ifndef ECCLIB_H
+#define ECCLIB_H
+
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -50,3 +53,41 @@ unsigned char *enable_ecc_memory(ecc_t *ecc);
 
 void traceOn(void);
 void traceOff(void);
+
+
+// Bulk encode and check
+//
+// The codeword is linear in the data bits, so one 256 entry table gives the code byte for any data byte, and the
+// 5 bit difference between that and the stored code (SYNDROME plus pW) indexes a 32 entry table holding exactly
+// what read_byte would return. A block is worked 8 bytes at a time, computing the parity bits of all 8 lanes of a
+// 64-bit word at once, or 16 at a time with a nibble table shuffle (SSSE3 pshufb, NEON vtbl) when compiled for it.
+// Only words with a mismatch drop to the byte tables, so a clean scrub runs at memory speed.
+//
+// The block functions take any data and code buffers of len bytes, not just an ecc_t, so they can be used on
+// megabyte regions.
+//
+typedef struct ecc_counts
+{
+    unsigned long long sbe;  // single bit errors, data or parity bit
+    unsigned long long dbe;  // double bit errors, detected only
+    unsigned long long pw;   // pW bit errors
+    unsigned long long mbe;  // odd syndromes past bit 12, three or more bits flipped
+} ecc_counts_t;
+
+// Name of the bulk path compiled in, "word64", "ssse3" or "neon"
+const char *ecc_block_path(void);
+
+// Same return codes as read_byte for data and its stored code byte, without the trace or printf
+int ecc_check_byte(unsigned char data, unsigned char code);
+
+// code[i] = get_codeword of data[i] for len bytes
+void ecc_encode_block(const unsigned char *data, unsigned char *code, size_t len);
+
+// Check len bytes and add what is found to counts (may be NULL). With correct, SBEs are repaired in data or
+// code and pW errors in code, DBEs and MBEs are left as found. Returns the number of uncorrectable bytes.
+size_t ecc_check_block(unsigned char *data, unsigned char *code, size_t len, ecc_counts_t *counts, int correct);
+
+// Check and correct all MEM_SIZE bytes of ecc
+size_t ecc_scrub(ecc_t *ecc, ecc_counts_t *counts);
+
+#endif
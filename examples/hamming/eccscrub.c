@@ -0,0 +1,183 @@
+// Background scrubber demo: scrub rate against foreground read latency
+//
+// A region of ECC memory is read by the foreground in bursts of random single byte reads with a short idle gap
+// between bursts, the way an application leaves the CPU and memory bus idle part of the time. A fault injection
+// thread flips random bits at a steady rate. For each scrub rate the scrubber runs for a few seconds, then the
+// scrub bandwidth it got, the errors it and the foreground found, and the foreground read latency are reported.
+//
+// Usage: eccscrub [MB [seconds [flips_per_sec]]]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "scrublib.h"
+
+#define DEFAULT_MB (16)
+#define DEFAULT_SECONDS (2)
+#define DEFAULT_FLIPS (1000)
+
+#define BURST_READS (1000)
+#define BURST_GAP_NSEC (1000000)
+#define MAX_SAMPLES (8 * 1024 * 1024)
+
+// MB/s, -1 for scrubber paused, 0 for unthrottled
+static const double scrubRates[] = {-1.0, 10.0, 100.0, 1000.0, 0.0};
+#define NUM_RATES ((int)(sizeof(scrubRates) / sizeof(scrubRates[0])))
+
+typedef struct
+{
+    ecc_scrubber_t *scrubber;
+    size_t len;
+    int flipsPerSec;
+    int running;
+    unsigned long long injected;
+} injector_t;
+
+
+static double now_sec(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+
+static void *inject_thread(void *arg)
+{
+    injector_t *injector = (injector_t *)arg;
+    struct timespec next;
+    unsigned int seed = 2;
+    long period = 1000000000L / injector->flipsPerSec;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while(__atomic_load_n(&injector->running, __ATOMIC_ACQUIRE))
+    {
+        ecc_scrubber_inject(injector->scrubber, (size_t)rand_r(&seed) % injector->len, rand_r(&seed) % 13);
+        __atomic_fetch_add(&injector->injected, 1, __ATOMIC_RELAXED);
+
+        next.tv_nsec += period;
+        while(next.tv_nsec >= 1000000000L)
+        {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    return NULL;
+}
+
+
+static int compare_latency(const void *a, const void *b)
+{
+    unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+int main(int argc, char *argv[])
+{
+    ecc_scrubber_t scrubber;
+    ecc_scrub_stats_t before, after;
+    ecc_counts_t residual;
+    injector_t injector;
+    pthread_t injectorThread;
+    struct timespec gap = {0, BURST_GAP_NSEC}, t0, t1;
+    unsigned char *data, *code, byteRead;
+    unsigned int *latency, seed = 1;
+    size_t len, idx, samples;
+    double seconds, fstart, fstop, total;
+    int rate, read;
+
+    len = (size_t)(argc > 1 ? atoi(argv[1]) : DEFAULT_MB) * 1024 * 1024;
+    seconds = argc > 2 ? atof(argv[2]) : DEFAULT_SECONDS;
+    injector.flipsPerSec = argc > 3 ? atoi(argv[3]) : DEFAULT_FLIPS;
+
+    if(len == 0 || seconds <= 0.0 || injector.flipsPerSec <= 0 || (data = malloc(len)) == NULL ||
+       (code = malloc(len)) == NULL || (latency = malloc(MAX_SAMPLES * sizeof(unsigned int))) == NULL)
+    {
+        printf("Usage: eccscrub [MB [seconds [flips_per_sec]]]\n");
+        exit(-1);
+    }
+
+    for(idx=0; idx < len; idx++) data[idx] = (unsigned char)rand_r(&seed);
+    ecc_encode_block(data, code, len);
+
+    if(ecc_scrubber_start(&scrubber, data, code, len, scrubRates[0]) != NO_ERROR)
+    {
+        printf("could not start the scrubber\n");
+        exit(-1);
+    }
+
+    injector.scrubber = &scrubber;
+    injector.len = len;
+    injector.running = 1;
+    injector.injected = 0;
+    pthread_create(&injectorThread, NULL, inject_thread, &injector);
+
+    printf("%zu MB, %d bit flips/s, %d reads per burst then %d us idle, scrubber at SCHED_IDLE\n\n",
+           len / (1024 * 1024), injector.flipsPerSec, BURST_READS, BURST_GAP_NSEC / 1000);
+    printf("  rate MB/s  scrubbed MB/s  passes   SBE    PW   DBE  read SBE+PW  read avg ns  p99 ns  max ns\n");
+
+    for(rate=0; rate < NUM_RATES; rate++)
+    {
+        ecc_scrubber_rate(&scrubber, scrubRates[rate]);
+        ecc_scrubber_stats(&scrubber, &before);
+
+        fstart = now_sec();
+        samples = 0;
+        total = 0.0;
+        do
+        {
+            for(read=0; read < BURST_READS && samples < MAX_SAMPLES; read++, samples++)
+            {
+                idx = (size_t)rand_r(&seed) % len;
+                clock_gettime(CLOCK_MONOTONIC, &t0);
+                ecc_scrubber_read(&scrubber, idx, &byteRead);
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                latency[samples] = (unsigned int)((t1.tv_sec - t0.tv_sec) * 1000000000L + t1.tv_nsec - t0.tv_nsec);
+                total += latency[samples];
+            }
+            nanosleep(&gap, NULL);
+            fstop = now_sec();
+        } while(fstop - fstart < seconds);
+
+        ecc_scrubber_stats(&scrubber, &after);
+        qsort(latency, samples, sizeof(unsigned int), compare_latency);
+
+        if(scrubRates[rate] < 0.0) printf("     paused");
+        else if(scrubRates[rate] == 0.0) printf("  unlimited");
+        else printf("  %9.0lf", scrubRates[rate]);
+
+        printf("  %13.1lf  %6llu  %4llu  %4llu  %4llu  %11llu  %11.0lf  %6u  %6u\n",
+               (after.bytes - before.bytes) / (fstop - fstart) / (1024.0 * 1024.0), after.passes - before.passes,
+               after.scrubbed.sbe - before.scrubbed.sbe, after.scrubbed.pw - before.scrubbed.pw,
+               after.scrubbed.dbe - before.scrubbed.dbe,
+               (after.foreground.sbe + after.foreground.pw) - (before.foreground.sbe + before.foreground.pw),
+               total / samples, latency[samples * 99 / 100], latency[samples - 1]);
+    }
+
+    __atomic_store_n(&injector.running, 0, __ATOMIC_RELEASE);
+    pthread_join(injectorThread, NULL);
+    ecc_scrubber_stop(&scrubber);
+
+    // whatever is still in memory is what the scrubber had not reached yet, or DBEs it can only report
+    memset(&residual, 0, sizeof(residual));
+    ecc_check_block(data, code, len, &residual, 0);
+    ecc_scrubber_stats(&scrubber, &after);
+
+    printf("\ninjected %llu flips: scrubber fixed %llu, reads fixed %llu, %llu DBE seen, still in memory %llu SBE+PW "
+           "%llu DBE %llu MBE\n", injector.injected, after.scrubbed.sbe + after.scrubbed.pw,
+           after.foreground.sbe + after.foreground.pw, after.scrubbed.dbe + after.foreground.dbe,
+           residual.sbe + residual.pw, residual.dbe, residual.mbe);
+
+    free(latency);
+    free(code);
+    free(data);
+    return NO_ERROR;
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <string.h>
 #include "ecclib.h"
 
 void flip_bit(ecc_t *ecc, unsigned char *address, unsigned short bit_to_flip);
@@ -9,6 +10,8 @@ int main(void)
     int i, j;
     unsigned int offset=0; int rc; unsigned char byteToRead;
     unsigned short bitToFlip, bitToFlip2;
+    unsigned char codeCopy[MEM_SIZE];
+    ecc_counts_t counts;
     unsigned char *base_addr=enable_ecc_memory(&ECC);
 
     // NEGATIVE testing - flip a SINGLE bit, read to correct
@@ -23,6 +26,7 @@ int main(void)
         bitToFlip=i;
         flip_bit(&ECC, base_addr+0, bitToFlip);
         rc=read_byte(&ECC, base_addr+offset, &byteToRead);
+        assert(ecc_check_byte(ECC.data_memory[offset], ECC.code_memory[offset]) == rc);
         flip_bit(&ECC, base_addr+0, bitToFlip);
         assert((rc=read_byte(&ECC, base_addr+offset, &byteToRead)) == NO_ERROR);
     }
@@ -41,6 +45,7 @@ int main(void)
             bitToFlip2=j;
             flip_bit(&ECC, base_addr+0, bitToFlip2);
             rc=read_byte(&ECC, base_addr+offset, &byteToRead);
+            assert(ecc_check_byte(ECC.data_memory[offset], ECC.code_memory[offset]) == rc);
             flip_bit(&ECC, base_addr+0, bitToFlip2);
         }
     }
@@ -102,6 +107,30 @@ int main(void)
     printf("**** END TEST CASE 5 *****************************\n\n");
 
 
+    // TEST CASE 6: bulk encode matches write_byte, scrub corrects an SBE in every byte
+    printf("**** TEST CASE 6: Bulk encode and scrub (%s) ***\n", ecc_block_path());
+    memcpy(codeCopy, ECC.code_memory, MEM_SIZE);
+    ecc_encode_block(ECC.data_memory, ECC.code_memory, MEM_SIZE);
+    assert(memcmp(codeCopy, ECC.code_memory, MEM_SIZE) == 0);
+
+    for(offset=0; offset < MEM_SIZE; offset++)
+    {
+        bitToFlip = offset % 13;
+        if(bitToFlip == 3 || bitToFlip > 4) ECC.data_memory[offset] ^= 1 << (offset % 8);
+        else ECC.code_memory[offset] ^= 1 << bitToFlip;
+    }
+    memset(&counts, 0, sizeof(counts));
+    assert(ecc_scrub(&ECC, &counts) == 0);
+    assert(counts.sbe + counts.pw == MEM_SIZE && counts.dbe == 0 && counts.mbe == 0);
+
+    for(offset=0; offset < MEM_SIZE; offset++)
+    {
+        assert(ECC.data_memory[offset] == (unsigned char)offset);
+        assert((rc=read_byte(&ECC, base_addr+offset, &byteToRead)) == NO_ERROR);
+    }
+    printf("**** END TEST CASE 6 *****************************\n\n");
+
+
     return NO_ERROR;
 }
 
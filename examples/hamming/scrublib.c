@@ -0,0 +1,214 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+#include "scrublib.h"
+
+#define NSEC_PER_SEC (1000000000ULL)
+#define SCRUB_PAUSED (~0ULL)
+
+
+static void add_counts(ecc_counts_t *shared, const ecc_counts_t *found)
+{
+    if(found->sbe) __atomic_fetch_add(&shared->sbe, found->sbe, __ATOMIC_RELAXED);
+    if(found->dbe) __atomic_fetch_add(&shared->dbe, found->dbe, __ATOMIC_RELAXED);
+    if(found->pw) __atomic_fetch_add(&shared->pw, found->pw, __ATOMIC_RELAXED);
+    if(found->mbe) __atomic_fetch_add(&shared->mbe, found->mbe, __ATOMIC_RELAXED);
+}
+
+
+static void *scrub_thread(void *arg)
+{
+    ecc_scrubber_t *scrubber = (ecc_scrubber_t *)arg;
+    struct sched_param param;
+    struct timespec start, next, pause = {0, 1000000};
+    unsigned long long rate, lastRate=0, paced=0, nsec;
+    ecc_counts_t found;
+    size_t chunk=0, len;
+
+    // idle priority only ever lowers the thread, so no privilege is needed
+    memset(&param, 0, sizeof(param));
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while(__atomic_load_n(&scrubber->running, __ATOMIC_ACQUIRE))
+    {
+        // restart the pacing clock whenever the rate changes
+        rate = __atomic_load_n(&scrubber->bytesPerSec, __ATOMIC_RELAXED);
+        if(rate != lastRate)
+        {
+            lastRate = rate;
+            paced = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+        }
+
+        if(rate == SCRUB_PAUSED)
+        {
+            nanosleep(&pause, NULL);
+            continue;
+        }
+
+        len = scrubber->len - chunk * SCRUB_CHUNK;
+        if(len > SCRUB_CHUNK) len = SCRUB_CHUNK;
+
+        memset(&found, 0, sizeof(found));
+        pthread_mutex_lock(&scrubber->locks[chunk]);
+        ecc_check_block(scrubber->data + chunk * SCRUB_CHUNK, scrubber->code + chunk * SCRUB_CHUNK, len, &found, 1);
+        pthread_mutex_unlock(&scrubber->locks[chunk]);
+
+        add_counts(&scrubber->stats.scrubbed, &found);
+        __atomic_fetch_add(&scrubber->stats.bytes, len, __ATOMIC_RELAXED);
+
+        if(++chunk == scrubber->chunks)
+        {
+            chunk = 0;
+            __atomic_fetch_add(&scrubber->stats.passes, 1, __ATOMIC_RELAXED);
+        }
+
+        if(rate == 0)
+            continue;
+
+        // sleep until the bytes done so far are due at this rate, starting a new window every second's worth
+        paced += len;
+        nsec = paced * NSEC_PER_SEC / rate;
+        next.tv_sec = start.tv_sec + nsec / NSEC_PER_SEC;
+        next.tv_nsec = start.tv_nsec + nsec % NSEC_PER_SEC;
+        if(next.tv_nsec >= (long)NSEC_PER_SEC)
+        {
+            next.tv_sec++;
+            next.tv_nsec -= NSEC_PER_SEC;
+        }
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR);
+
+        if(paced >= rate)
+        {
+            start = next;
+            paced = 0;
+        }
+    }
+
+    return NULL;
+}
+
+
+int ecc_scrubber_start(ecc_scrubber_t *scrubber, unsigned char *data, unsigned char *code, size_t len,
+                       double mbPerSec)
+{
+    size_t chunk;
+
+    memset(scrubber, 0, sizeof(*scrubber));
+    scrubber->data = data;
+    scrubber->code = code;
+    scrubber->len = len;
+    scrubber->chunks = (len + SCRUB_CHUNK - 1) / SCRUB_CHUNK;
+    ecc_scrubber_rate(scrubber, mbPerSec);
+
+    if((scrubber->locks = malloc(scrubber->chunks * sizeof(pthread_mutex_t))) == NULL)
+        return UNKNOWN_ERROR;
+    for(chunk=0; chunk < scrubber->chunks; chunk++)
+        pthread_mutex_init(&scrubber->locks[chunk], NULL);
+
+    scrubber->running = 1;
+    if(pthread_create(&scrubber->thread, NULL, scrub_thread, scrubber) != 0)
+    {
+        free(scrubber->locks);
+        scrubber->locks = NULL;
+        return UNKNOWN_ERROR;
+    }
+
+    return NO_ERROR;
+}
+
+
+void ecc_scrubber_rate(ecc_scrubber_t *scrubber, double mbPerSec)
+{
+    unsigned long long rate = 0;
+
+    if(mbPerSec < 0.0) rate = SCRUB_PAUSED;
+    else if(mbPerSec > 0.0) rate = (unsigned long long)(mbPerSec * 1024.0 * 1024.0);
+
+    __atomic_store_n(&scrubber->bytesPerSec, rate, __ATOMIC_RELAXED);
+}
+
+
+void ecc_scrubber_stop(ecc_scrubber_t *scrubber)
+{
+    size_t chunk;
+
+    if(scrubber->locks == NULL)
+        return;
+
+    __atomic_store_n(&scrubber->running, 0, __ATOMIC_RELEASE);
+    pthread_join(scrubber->thread, NULL);
+
+    for(chunk=0; chunk < scrubber->chunks; chunk++)
+        pthread_mutex_destroy(&scrubber->locks[chunk]);
+    free(scrubber->locks);
+    scrubber->locks = NULL;
+}
+
+
+static void load_counts(ecc_counts_t *out, ecc_counts_t *shared)
+{
+    out->sbe = __atomic_load_n(&shared->sbe, __ATOMIC_RELAXED);
+    out->dbe = __atomic_load_n(&shared->dbe, __ATOMIC_RELAXED);
+    out->pw = __atomic_load_n(&shared->pw, __ATOMIC_RELAXED);
+    out->mbe = __atomic_load_n(&shared->mbe, __ATOMIC_RELAXED);
+}
+
+
+void ecc_scrubber_stats(ecc_scrubber_t *scrubber, ecc_scrub_stats_t *stats)
+{
+    load_counts(&stats->scrubbed, &scrubber->stats.scrubbed);
+    load_counts(&stats->foreground, &scrubber->stats.foreground);
+    stats->bytes = __atomic_load_n(&scrubber->stats.bytes, __ATOMIC_RELAXED);
+    stats->passes = __atomic_load_n(&scrubber->stats.passes, __ATOMIC_RELAXED);
+}
+
+
+int ecc_scrubber_read(ecc_scrubber_t *scrubber, size_t offset, unsigned char *byteRead)
+{
+    pthread_mutex_t *lock = &scrubber->locks[offset / SCRUB_CHUNK];
+    ecc_counts_t found;
+    int rc;
+
+    memset(&found, 0, sizeof(found));
+    pthread_mutex_lock(lock);
+    rc = ecc_check_byte(scrubber->data[offset], scrubber->code[offset]);
+    if(rc != NO_ERROR)
+        ecc_check_block(scrubber->data + offset, scrubber->code + offset, 1, &found, 1);
+    *byteRead = scrubber->data[offset];
+    pthread_mutex_unlock(lock);
+
+    if(rc != NO_ERROR)
+        add_counts(&scrubber->stats.foreground, &found);
+
+    return rc;
+}
+
+
+void ecc_scrubber_write(ecc_scrubber_t *scrubber, size_t offset, unsigned char byteToWrite)
+{
+    pthread_mutex_t *lock = &scrubber->locks[offset / SCRUB_CHUNK];
+
+    pthread_mutex_lock(lock);
+    scrubber->data[offset] = byteToWrite;
+    ecc_encode_block(scrubber->data + offset, scrubber->code + offset, 1);
+    pthread_mutex_unlock(lock);
+}
+
+
+void ecc_scrubber_inject(ecc_scrubber_t *scrubber, size_t offset, int bit)
+{
+    pthread_mutex_t *lock = &scrubber->locks[offset / SCRUB_CHUNK];
+
+    pthread_mutex_lock(lock);
+    if(bit < 8)
+        scrubber->data[offset] ^= (unsigned char)(1 << bit);
+    else
+        scrubber->code[offset] ^= (unsigned char)(1 << (bit - 8));
+    pthread_mutex_unlock(lock);
+}
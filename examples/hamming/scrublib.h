@@ -0,0 +1,61 @@
+#ifndef SCRUBLIB_H
+#define SCRUBLIB_H
+
+#include <pthread.h>
+
+#include "ecclib.h"
+
+// Background ECC scrubber
+//
+// A thread walks the data and code memory SCRUB_CHUNK bytes at a time with ecc_check_block, repairing SBEs and pW
+// errors before a second hit in the same byte turns them into an uncorrectable DBE. It runs at SCHED_IDLE, below
+// every normal thread, and paces itself to a rate in MB/s (0 for flat out, negative to pause), so it only uses
+// what the foreground leaves over.
+//
+// Each chunk has a lock, held by the scrubber while it checks that chunk and by the foreground read, write and
+// fault injection calls for the byte they touch, the way a memory controller holds off a row while it is
+// scrubbed. Telemetry is lock free: each chunk's findings are added to the shared counters with atomic adds,
+// so reading them never stalls the scrubber.
+//
+#define SCRUB_CHUNK (16 * 1024)
+
+typedef struct ecc_scrub_stats
+{
+    ecc_counts_t scrubbed;      // found by the scrubber
+    ecc_counts_t foreground;    // found by ecc_scrubber_read
+    unsigned long long bytes;   // bytes scrubbed
+    unsigned long long passes;  // complete passes over the region
+} ecc_scrub_stats_t;
+
+typedef struct ecc_scrubber
+{
+    unsigned char *data, *code;
+    size_t len, chunks;
+    pthread_mutex_t *locks;
+    pthread_t thread;
+    int running;
+    unsigned long long bytesPerSec;
+    ecc_scrub_stats_t stats;
+} ecc_scrubber_t;
+
+// Start scrubbing len bytes of data and code, e.g. ecc->data_memory, ecc->code_memory and MEM_SIZE. Returns
+// NO_ERROR, or UNKNOWN_ERROR if the locks or thread could not be created.
+int ecc_scrubber_start(ecc_scrubber_t *scrubber, unsigned char *data, unsigned char *code, size_t len,
+                       double mbPerSec);
+
+// Change the scrub rate while it runs, 0 for unthrottled, negative to pause
+void ecc_scrubber_rate(ecc_scrubber_t *scrubber, double mbPerSec);
+
+void ecc_scrubber_stop(ecc_scrubber_t *scrubber);
+
+// Snapshot of the counters
+void ecc_scrubber_stats(ecc_scrubber_t *scrubber, ecc_scrub_stats_t *stats);
+
+// Foreground access, same return codes as read_byte. SBEs and pW errors are corrected.
+int ecc_scrubber_read(ecc_scrubber_t *scrubber, size_t offset, unsigned char *byteRead);
+void ecc_scrubber_write(ecc_scrubber_t *scrubber, size_t offset, unsigned char byteToWrite);
+
+// Fault injection: flip bit 0..7 of the data byte, or 8..12 for code bits P01..P04 and PW
+void ecc_scrubber_inject(ecc_scrubber_t *scrubber, size_t offset, int bit);
+
+#endif
@@ -0,0 +1,174 @@
+// Compare the GCF and LCM kernels across operand sizes
+//
+// C subtraction (gcfc, lcmc from lcmc.c), the hand written assembly of the same (gcfa, lcma from lcmarm.s or
+// lcmintel.s) and the binary GCD (gcfb, gcfb64, lcmb from lcmbin.c). Random operand pairs are drawn with a given
+// number of bits. The average is timed over the whole batch and the worst case, the number that matters for
+// WCET, one call at a time, so it includes the clock overhead of a few tens of ns.
+//
+// The subtraction LCM divides a*b by the GCF by repeated subtraction as well, so it is only run on 8 bit
+// operands, where a*b still fits an int and the division takes at most 65025 steps.
+//
+// Usage: lcmbench [pairs [threads]]
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "lcmbin.h"
+
+extern unsigned int gcfc(int a, int b);
+extern unsigned int lcmc(int a, int b);
+extern unsigned int gcfa(int a, int b);
+extern unsigned int lcma(int a, int b);
+
+#define DEFAULT_PAIRS (10000)
+#define ARRAY_VALUES (4 * 1024 * 1024)
+#define ARRAY_MAX_VALUE (40)
+
+typedef unsigned long long (*kernel)(unsigned long long a, unsigned long long b);
+
+static unsigned long long gcf_c(unsigned long long a, unsigned long long b) { return gcfc((int)a, (int)b); }
+static unsigned long long gcf_asm(unsigned long long a, unsigned long long b) { return gcfa((int)a, (int)b); }
+static unsigned long long gcf_bin(unsigned long long a, unsigned long long b) { return gcfb(a, b); }
+static unsigned long long gcf_bin64(unsigned long long a, unsigned long long b) { return gcfb64(a, b); }
+static unsigned long long lcm_c(unsigned long long a, unsigned long long b) { return lcmc((int)a, (int)b); }
+static unsigned long long lcm_asm(unsigned long long a, unsigned long long b) { return lcma((int)a, (int)b); }
+static unsigned long long lcm_bin(unsigned long long a, unsigned long long b) { return lcmb(a, b); }
+
+
+static double now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1000000000.0 + (double)now.tv_nsec;
+}
+
+
+// Random value of exactly bits bits, never 0 since the subtraction GCF never ends on 0
+static unsigned long long random_bits(int bits)
+{
+    unsigned long long value = ((unsigned long long)random() << 42) ^ ((unsigned long long)random() << 21) ^
+                               (unsigned long long)random();
+
+    value &= (bits == 64) ? ~0ULL : (1ULL << bits) - 1;
+    return value | (1ULL << (bits - 1));
+}
+
+
+// Times fn over all pairs, checks it against reference and prints average and worst case ns
+static int run(const char *name, kernel fn, kernel reference, const unsigned long long *a,
+               const unsigned long long *b, int pairs)
+{
+    double start, stop, worst = 0.0;
+    unsigned long long sum = 0;
+    int idx, errors = 0;
+
+    start = now_ns();
+    for(idx=0; idx < pairs; idx++)
+        sum += fn(a[idx], b[idx]);
+    stop = now_ns();
+
+    for(idx=0; idx < pairs; idx++)
+    {
+        double t0 = now_ns(), t1;
+        unsigned long long result = fn(a[idx], b[idx]);
+
+        t1 = now_ns();
+        if(t1 - t0 > worst) worst = t1 - t0;
+        if(result != reference(a[idx], b[idx]))
+            errors++;
+    }
+
+    printf("  %-8s %12.1lf %12.0lf %s\n", name, (stop - start) / pairs, worst, errors ? "WRONG" : "");
+    return errors + (sum == 0);
+}
+
+
+int main(int argc, char *argv[])
+{
+    static const int bits32[] = {8, 16, 24, 31};
+    static const int bits64[] = {48, 64};
+    unsigned long long *a, *b, *values, serial, lcm;
+    int pairs, threads, size, idx, errors = 0;
+    double start, stop;
+
+    pairs = argc > 1 ? atoi(argv[1]) : DEFAULT_PAIRS;
+    threads = argc > 2 ? atoi(argv[2]) : 0;
+
+    if(pairs <= 0 || (a = malloc(pairs * sizeof(*a))) == NULL || (b = malloc(pairs * sizeof(*b))) == NULL)
+    {
+        printf("Usage: lcmbench [pairs [threads]]\n");
+        exit(-1);
+    }
+
+    srandom(1);
+    printf("%d random pairs per size, ns per call\n", pairs);
+
+    for(size=0; size < (int)(sizeof(bits32) / sizeof(bits32[0])); size++)
+    {
+        for(idx=0; idx < pairs; idx++)
+        {
+            a[idx] = random_bits(bits32[size]);
+            b[idx] = random_bits(bits32[size]);
+        }
+
+        printf("\n%d bit GCF      average        worst\n", bits32[size]);
+        errors += run("C", gcf_c, gcf_bin64, a, b, pairs);
+        errors += run("asm", gcf_asm, gcf_bin64, a, b, pairs);
+        errors += run("binary", gcf_bin, gcf_bin64, a, b, pairs);
+        errors += run("binary64", gcf_bin64, gcf_c, a, b, pairs);
+
+        if(bits32[size] == 8)
+        {
+            printf("\n%d bit LCM      average        worst\n", bits32[size]);
+            errors += run("C", lcm_c, lcm_bin, a, b, pairs);
+            errors += run("asm", lcm_asm, lcm_bin, a, b, pairs);
+            errors += run("binary", lcm_bin, lcm_c, a, b, pairs);
+        }
+    }
+
+    for(size=0; size < (int)(sizeof(bits64) / sizeof(bits64[0])); size++)
+    {
+        for(idx=0; idx < pairs; idx++)
+        {
+            a[idx] = random_bits(bits64[size]);
+            b[idx] = random_bits(bits64[size]);
+        }
+
+        printf("\n%d bit GCF      average        worst\n", bits64[size]);
+        errors += run("binary64", gcf_bin64, gcf_bin64, a, b, pairs);
+    }
+
+    // batched LCM of a large array, every value 1 ... ARRAY_MAX_VALUE appears so the answer is known
+    if((values = malloc(ARRAY_VALUES * sizeof(*values))) == NULL)
+        exit(-1);
+    for(idx=0; idx < ARRAY_VALUES; idx++)
+        values[idx] = (idx < ARRAY_MAX_VALUE) ? idx + 1 : 1 + random() % ARRAY_MAX_VALUE;
+
+    // same skip of values that already divide the running lcm as lcm_slice, so only threading differs
+    start = now_ns();
+    for(idx=0, serial=1; idx < ARRAY_VALUES && serial != 0; idx++)
+        if(values[idx] == 0 || serial % values[idx] != 0)
+            serial = lcmb64(serial, values[idx]);
+    stop = now_ns();
+    printf("\nlcm of %d values in 1..%d\n", ARRAY_VALUES, ARRAY_MAX_VALUE);
+    printf("  %-8s %12.2lf ms = %llu (lcmb64 loop, skipping divisors)\n", "serial", (stop - start) / 1000000.0, serial);
+
+    for(idx=1; idx <= (threads > 0 ? threads : 4); idx*=2)
+    {
+        start = now_ns();
+        lcm = lcm_array(values, ARRAY_VALUES, idx);
+        stop = now_ns();
+        printf("  %-2d %-5s %12.2lf ms = %llu %s\n", idx, idx == 1 ? "thread" : "threads", (stop - start) / 1000000.0,
+               lcm, lcm == serial ? "" : "WRONG");
+        errors += (lcm != serial);
+    }
+
+    printf("\n%s\n", errors ? "FAILED" : "PASSED");
+
+    free(values);
+    free(a);
+    free(b);
+    return errors ? -1 : 0;
+}
@@ -0,0 +1,153 @@
+#include <pthread.h>
+#include <unistd.h>
+
+#include "lcmbin.h"
+
+// Fewest values worth a thread of their own in lcm_array
+#define LCM_ARRAY_MIN_SLICE (4096)
+#define LCM_ARRAY_MAX_THREADS (64)
+
+
+// Stein's algorithm: gcd(2^i a, 2^j b) = 2^min(i,j) gcd(a, b), and for odd a and b, gcd(a, b) = gcd(a, b - a)
+// where b - a is even, so its factors of two can be shifted out at once.
+//
+unsigned long long gcfb64(unsigned long long a, unsigned long long b)
+{
+    unsigned long long t;
+    int shift;
+
+    if(a == 0) return b;
+    if(b == 0) return a;
+
+    shift = __builtin_ctzll(a | b);
+    a >>= __builtin_ctzll(a);
+
+    do
+    {
+        b >>= __builtin_ctzll(b);
+        if(a > b)
+        {
+            t = a; a = b; b = t;
+        }
+        b = b - a;
+    } while(b != 0);
+
+    return a << shift;
+}
+
+
+unsigned int gcfb(unsigned int a, unsigned int b)
+{
+    unsigned int t;
+    int shift;
+
+    if(a == 0) return b;
+    if(b == 0) return a;
+
+    shift = __builtin_ctz(a | b);
+    a >>= __builtin_ctz(a);
+
+    do
+    {
+        b >>= __builtin_ctz(b);
+        if(a > b)
+        {
+            t = a; a = b; b = t;
+        }
+        b = b - a;
+    } while(b != 0);
+
+    return a << shift;
+}
+
+
+// Divide before multiplying so only a result that really is too big overflows
+//
+unsigned long long lcmb(unsigned int a, unsigned int b)
+{
+    if(a == 0 || b == 0) return 0;
+
+    return (unsigned long long)(a / gcfb(a, b)) * b;
+}
+
+
+unsigned long long lcmb64(unsigned long long a, unsigned long long b)
+{
+    unsigned long long lcm;
+
+    if(a == 0 || b == 0) return 0;
+
+    if(__builtin_mul_overflow(a / gcfb64(a, b), b, &lcm))
+        return 0;
+
+    return lcm;
+}
+
+
+typedef struct
+{
+    const unsigned long long *values;
+    size_t n;
+    unsigned long long lcm;
+} lcmSlice;
+
+
+static void *lcm_slice(void *arg)
+{
+    lcmSlice *slice = (lcmSlice *)arg;
+    unsigned long long lcm = 1;
+    size_t idx;
+
+    // once it is 0 (a zero value or overflow) it stays 0
+    for(idx=0; idx < slice->n && lcm != 0; idx++)
+        if(slice->values[idx] == 0 || lcm % slice->values[idx] != 0)
+            lcm = lcmb64(lcm, slice->values[idx]);
+
+    slice->lcm = lcm;
+    return NULL;
+}
+
+
+unsigned long long lcm_array(const unsigned long long *values, size_t n, int threads)
+{
+    pthread_t thread[LCM_ARRAY_MAX_THREADS];
+    lcmSlice slice[LCM_ARRAY_MAX_THREADS];
+    unsigned long long lcm = 1;
+    size_t per, start = 0;
+    int idx, started;
+
+    if(threads <= 0)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads > LCM_ARRAY_MAX_THREADS)
+        threads = LCM_ARRAY_MAX_THREADS;
+    if((size_t)threads > n / LCM_ARRAY_MIN_SLICE)
+        threads = (int)(n / LCM_ARRAY_MIN_SLICE);
+    if(threads < 1)
+        threads = 1;
+
+    per = (n + threads - 1) / threads;
+
+    for(idx=0; idx < threads; idx++)
+    {
+        slice[idx].values = values + start;
+        slice[idx].n = (n - start < per) ? n - start : per;
+        start += slice[idx].n;
+    }
+
+    // the first slice runs on the calling thread, and any slice whose thread can't be created is run here too
+    for(started=1; started < threads; started++)
+        if(pthread_create(&thread[started], NULL, lcm_slice, &slice[started]) != 0)
+            break;
+
+    lcm_slice(&slice[0]);
+    for(idx=started; idx < threads; idx++)
+        lcm_slice(&slice[idx]);
+
+    for(idx=1; idx < started; idx++)
+        pthread_join(thread[idx], NULL);
+
+    for(idx=0; idx < threads && lcm != 0; idx++)
+        lcm = lcmb64(lcm, slice[idx].lcm);
+
+    return lcm;
+}
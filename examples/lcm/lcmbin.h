@@ -0,0 +1,20 @@
+#include <stddef.h>
+
+// Binary (Stein's) GCD and LCM
+//
+// Unlike lcmc.c this uses the compiler's count trailing zeros builtin, one instruction on both ARM (rbit + clz)
+// and Intel (tzcnt/bsf), to strip all the factors of two in one step, so the loop runs at most once per bit of
+// the operands rather than once per subtraction. gcfb(0, b) is b, and lcmb of anything with 0 is 0.
+
+extern unsigned int gcfb(unsigned int a, unsigned int b);
+extern unsigned long long gcfb64(unsigned long long a, unsigned long long b);
+
+// 32-bit operands give a 64-bit LCM, which can't overflow
+extern unsigned long long lcmb(unsigned int a, unsigned int b);
+
+// Returns 0 if the LCM does not fit in 64 bits
+extern unsigned long long lcmb64(unsigned long long a, unsigned long long b);
+
+// LCM of n values, split over threads workers (0 for one per online CPU) that each reduce a slice before the
+// slice results are combined. Returns 0 if any value is 0 or the LCM does not fit in 64 bits.
+extern unsigned long long lcm_array(const unsigned long long *values, size_t n, int threads);
@@ -0,0 +1,238 @@
+/****************************************************************************/
+/* Function: Copy vs. zero copy message passing benchmark                   */
+/****************************************************************************/
+
+// A sender thread passes messages of 64 B to 1 MB to a receiver thread three ways:
+//
+//   mq copy       the whole message through mq_send/mq_receive as posix_mq.c does, two copies per message
+//   chan mqueue   msgchan over an mqueue, only the buffer index and length are queued
+//   chan ring     msgchan over its lock free ring, no copies and no system calls
+//
+// Each message starts with a sequence number and the time it was sent, the receiver checks the sequence and
+// takes the one way latency. Only the header is written, so this is the cost of moving a message, not of filling
+// or reading it. Throughput is messages and MB per second over the whole run.
+//
+// The copy version needs mq_msgsize as big as the message. Past /proc/sys/fs/mqueue/msgsize_max (8 KB by default)
+// only a privileged process may do that, otherwise the message is sent as several fragments of the largest size the
+// queue will take, the way a copying design would have to.
+//
+// Usage: mqbench [max_size]
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "msgchan.h"
+
+#define BENCH_MQ "/mqbench_copy_mq"
+#define MIN_SIZE (64)
+#define MAX_SIZE (1024 * 1024)
+#define BYTES_PER_RUN (256LL * 1024 * 1024)
+#define MIN_MESSAGES (500)
+#define MAX_MESSAGES (100000)
+#define COPY_DEPTH (10)
+#define CHAN_BUFFERS (64)
+
+typedef enum { MODE_COPY, MODE_CHAN_MQUEUE, MODE_CHAN_RING, NUM_MODES } bench_mode_t;
+
+static const char *modeNames[NUM_MODES] = {"mq copy", "chan mqueue", "chan ring"};
+
+typedef struct {
+    unsigned long long seq;
+    struct timespec sent;
+} header_t;
+
+typedef struct {
+    bench_mode_t mode;
+    size_t size;
+    size_t fragment;  // mq copy bytes per mq_send, a power of two that divides size
+    int messages;
+    mqd_t mq;
+    msgchan_t chan;
+    unsigned int *latency;  // ns, one per message
+    int errors;
+} bench_t;
+
+static double elapsed_ns(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) * 1000000000.0 + (to->tv_nsec - from->tv_nsec);
+}
+
+void *sender(void *arg) {
+    bench_t *bench = (bench_t *)arg;
+    header_t *header;
+    char *message = NULL;
+    size_t offset;
+    int seq;
+
+    if (bench->mode == MODE_COPY && (message = calloc(1, bench->size)) == NULL) {
+        bench->errors++;
+        return NULL;
+    }
+
+    for (seq = 0; seq < bench->messages; seq++) {
+        if (bench->mode == MODE_COPY) {
+            header = (header_t *)message;
+            header->seq = seq;
+            clock_gettime(CLOCK_MONOTONIC, &header->sent);
+            for (offset = 0; offset < bench->size; offset += bench->fragment)
+                if (mq_send(bench->mq, message + offset, bench->fragment, 30) == ERROR) {
+                    perror("mq_send");
+                    bench->errors++;
+                    return NULL;
+                }
+        } else {
+            // the message is built in place in the buffer it is delivered in
+            header = msgchan_alloc(&bench->chan, 1);
+            header->seq = seq;
+            clock_gettime(CLOCK_MONOTONIC, &header->sent);
+            if (msgchan_send(&bench->chan, header, bench->size, 30) == ERROR) {
+                // the receiver is waiting for this message, closing lets it give up too
+                bench->errors++;
+                msgchan_close(&bench->chan);
+                break;
+            }
+        }
+    }
+
+    free(message);
+    return NULL;
+}
+
+void *receiver(void *arg) {
+    bench_t *bench = (bench_t *)arg;
+    struct timespec now;
+    header_t *header;
+    char *message = NULL;
+    size_t length, offset;
+    int seq;
+
+    if (bench->mode == MODE_COPY && (message = malloc(bench->size)) == NULL) {
+        bench->errors++;
+        return NULL;
+    }
+
+    for (seq = 0; seq < bench->messages; seq++) {
+        if (bench->mode == MODE_COPY) {
+            for (offset = 0; offset < bench->size; offset += bench->fragment)
+                if (mq_receive(bench->mq, message + offset, bench->fragment, NULL) != (ssize_t)bench->fragment) {
+                    perror("mq_receive");
+                    bench->errors++;
+                    return NULL;
+                }
+            header = (header_t *)message;
+        } else if ((header = msgchan_receive(&bench->chan, &length, 1)) == NULL || length != bench->size) {
+            bench->errors++;
+            break;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        bench->latency[seq] = (unsigned int)elapsed_ns(&header->sent, &now);
+        if (header->seq != (unsigned long long)seq) bench->errors++;
+
+        if (bench->mode != MODE_COPY) msgchan_release(&bench->chan, header);
+    }
+
+    free(message);
+    return NULL;
+}
+
+static int compare_latency(const void *a, const void *b) {
+    unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Returns 0, 1 if the transport could not be set up, or ERROR if messages were lost or out of order
+static int run(bench_t *bench) {
+    struct mq_attr mq_attr;
+    struct timespec start, stop;
+    pthread_t th_send, th_receive;
+    double seconds, total = 0.0;
+    int i;
+
+    if (bench->mode == MODE_COPY) {
+        memset(&mq_attr, 0, sizeof(mq_attr));
+        mq_attr.mq_maxmsg = COPY_DEPTH;
+        mq_unlink(BENCH_MQ);
+        for (bench->fragment = bench->size; bench->fragment >= MIN_SIZE; bench->fragment /= 2) {
+            mq_attr.mq_msgsize = bench->fragment;
+            if ((bench->mq = mq_open(BENCH_MQ, O_CREAT | O_RDWR, S_IRWXU, &mq_attr)) != (mqd_t)ERROR ||
+                errno != EINVAL)
+                break;
+        }
+        if (bench->mq == (mqd_t)ERROR) {
+            printf("  %-12s %8s  (mq_open: %s)\n", modeNames[bench->mode], "n/a", strerror(errno));
+            return 1;
+        }
+    } else if (msgchan_create(&bench->chan, bench->mode == MODE_CHAN_RING ? MSGCHAN_RING : MSGCHAN_MQUEUE,
+                              CHAN_BUFFERS, bench->size) == ERROR) {
+        printf("  %-12s %8s  (msgchan_create failed)\n", modeNames[bench->mode], "n/a");
+        return 1;
+    }
+
+    bench->errors = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_create(&th_receive, NULL, receiver, bench);
+    pthread_create(&th_send, NULL, sender, bench);
+    pthread_join(th_send, NULL);
+    // a copy sender that gave up leaves the receiver in mq_receive, which is a cancellation point
+    if (bench->mode == MODE_COPY && bench->errors) pthread_cancel(th_receive);
+    pthread_join(th_receive, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    if (bench->mode == MODE_COPY) {
+        mq_close(bench->mq);
+        mq_unlink(BENCH_MQ);
+    } else {
+        msgchan_destroy(&bench->chan);
+    }
+
+    seconds = elapsed_ns(&start, &stop) / 1000000000.0;
+    for (i = 0; i < bench->messages; i++) total += bench->latency[i];
+    qsort(bench->latency, bench->messages, sizeof(unsigned int), compare_latency);
+
+    printf("  %-12s %8.0lf %10.1lf %10.1lf %10.1lf", modeNames[bench->mode], bench->messages / seconds,
+           bench->messages * (double)bench->size / seconds / (1024.0 * 1024.0), total / bench->messages / 1000.0,
+           bench->latency[bench->messages * 99 / 100] / 1000.0);
+    if (bench->mode == MODE_COPY && bench->fragment < bench->size)
+        printf("  (%zu fragments)", bench->size / bench->fragment);
+    printf("%s\n", bench->errors ? "  LOST/OUT OF ORDER" : "");
+
+    return bench->errors ? ERROR : 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct rlimit limit = {RLIM_INFINITY, RLIM_INFINITY};
+    size_t maxSize = argc > 1 ? strtoul(argv[1], NULL, 0) : MAX_SIZE;
+    bench_t bench;
+    int errors = 0;
+
+    // the copy queue needs COPY_DEPTH messages of up to maxSize, over the 800 KB default limit for big ones
+    setrlimit(RLIMIT_MSGQUEUE, &limit);
+
+    memset(&bench, 0, sizeof(bench));
+    if ((bench.latency = malloc(MAX_MESSAGES * sizeof(unsigned int))) == NULL) exit(-1);
+
+    for (bench.size = MIN_SIZE; bench.size <= maxSize; bench.size *= 4) {
+        bench.messages = BYTES_PER_RUN / bench.size;
+        if (bench.messages < MIN_MESSAGES) bench.messages = MIN_MESSAGES;
+        if (bench.messages > MAX_MESSAGES) bench.messages = MAX_MESSAGES;
+
+        printf("\n%zu byte messages, %d of them\n", bench.size, bench.messages);
+        printf("  %-12s %8s %10s %10s %10s\n", "", "msgs/s", "MB/s", "avg us", "p99 us");
+
+        for (bench.mode = MODE_COPY; bench.mode < NUM_MODES; bench.mode++)
+            if (run(&bench) == ERROR) errors++;
+    }
+
+    free(bench.latency);
+    printf("\n%s\n", errors ? "FAILED" : "PASSED");
+    return errors ? -1 : 0;
+}
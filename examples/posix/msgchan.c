@@ -0,0 +1,237 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "msgchan.h"
+
+// owner of each buffer, see msgchan.h
+#define OWNER_FREE 0
+#define OWNER_SENDER 1
+#define OWNER_CHANNEL 2
+#define OWNER_RECEIVER 3
+
+#define FREE_EMPTY (0xFFFFFFFFU)
+
+static unsigned int msgchanSerial;
+
+static void free_push(msgchan_t *chan, unsigned int index) {
+    unsigned long long head, next;
+
+    head = __atomic_load_n(&chan->freeHead, __ATOMIC_RELAXED);
+    do {
+        __atomic_store_n(&chan->freeNext[index], (unsigned int)head, __ATOMIC_RELAXED);
+        next = (((head >> 32) + 1) << 32) | index;
+    } while (!__atomic_compare_exchange_n(&chan->freeHead, &head, next, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static unsigned int free_pop(msgchan_t *chan) {
+    unsigned long long head, next;
+    unsigned int index;
+
+    head = __atomic_load_n(&chan->freeHead, __ATOMIC_ACQUIRE);
+    do {
+        if ((index = (unsigned int)head) == FREE_EMPTY) return FREE_EMPTY;
+        // may be stale if another thread took index meanwhile, then the generation has moved and the CAS fails
+        next = (((head >> 32) + 1) << 32) | __atomic_load_n(&chan->freeNext[index], __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&chan->freeHead, &head, next, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    return index;
+}
+
+// Move a buffer from one owner to the next, ERROR if from is not its owner
+static int transfer(msgchan_t *chan, unsigned int index, unsigned char from, unsigned char to) {
+    return __atomic_compare_exchange_n(&chan->owner[index], &from, to, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+               ? 0
+               : ERROR;
+}
+
+// Slab index of a buffer pointer, ERROR if it isn't the start of one
+static int buffer_index(msgchan_t *chan, void *buffer) {
+    size_t offset;
+
+    if ((unsigned char *)buffer < chan->slab) return ERROR;
+    offset = (unsigned char *)buffer - chan->slab;
+    if (offset % chan->size != 0 || offset / chan->size >= chan->count) return ERROR;
+
+    return (int)(offset / chan->size);
+}
+
+static int open_mqueue(msgchan_t *chan) {
+    struct mq_attr mq_attr;
+
+    snprintf(chan->mqName, sizeof(chan->mqName), "/msgchan_%d_%u", (int)getpid(),
+             __atomic_fetch_add(&msgchanSerial, 1, __ATOMIC_RELAXED));
+
+    memset(&mq_attr, 0, sizeof(mq_attr));
+    mq_attr.mq_maxmsg = chan->count;
+    mq_attr.mq_msgsize = sizeof(msgchan_desc_t);
+
+    chan->mq = mq_open(chan->mqName, O_CREAT | O_EXCL | O_RDWR, S_IRWXU, &mq_attr);
+
+    // without privilege mq_maxmsg is capped at /proc/sys/fs/mqueue/msg_max, the sender then blocks on a full queue
+    if (chan->mq == (mqd_t)ERROR && errno == EINVAL) {
+        mq_attr.mq_maxmsg = 10;
+        chan->mq = mq_open(chan->mqName, O_CREAT | O_EXCL | O_RDWR, S_IRWXU, &mq_attr);
+    }
+
+    if (chan->mq == (mqd_t)ERROR) {
+        perror("msgchan mq_open");
+        return ERROR;
+    }
+
+    // the channel is used by threads of this process through the descriptor, so the name isn't needed
+    mq_unlink(chan->mqName);
+    return 0;
+}
+
+int msgchan_create(msgchan_t *chan, msgchan_transport_t transport, unsigned int count, size_t size) {
+    unsigned int index;
+
+    memset(chan, 0, sizeof(*chan));
+    chan->mq = (mqd_t)ERROR;
+
+    if (count == 0 || count > MSGCHAN_MAX_BUFFERS || size == 0) return ERROR;
+
+    chan->transport = transport;
+    chan->count = count;
+    chan->size = (size + MSGCHAN_CACHE_LINE - 1) & ~(size_t)(MSGCHAN_CACHE_LINE - 1);
+
+    if (posix_memalign((void **)&chan->slab, MSGCHAN_CACHE_LINE, chan->size * count) != 0) chan->slab = NULL;
+    chan->owner = calloc(count, sizeof(unsigned char));
+    chan->freeNext = malloc(count * sizeof(unsigned int));
+
+    if (chan->slab == NULL || chan->owner == NULL || chan->freeNext == NULL) {
+        msgchan_destroy(chan);
+        return ERROR;
+    }
+
+    // all buffers free, lowest index on top
+    chan->freeHead = FREE_EMPTY;
+    for (index = count; index > 0; index--) free_push(chan, index - 1);
+
+    if (transport == MSGCHAN_RING) {
+        // at most count buffers exist, so a power of two ring at least that big is never full
+        for (chan->ringMask = 1; chan->ringMask < count; chan->ringMask <<= 1);
+        chan->ring = malloc(chan->ringMask * sizeof(msgchan_desc_t));
+        chan->ringMask--;
+        if (chan->ring == NULL) {
+            msgchan_destroy(chan);
+            return ERROR;
+        }
+    } else if (open_mqueue(chan) == ERROR) {
+        msgchan_destroy(chan);
+        return ERROR;
+    }
+
+    return 0;
+}
+
+void msgchan_destroy(msgchan_t *chan) {
+    if (chan->mq != (mqd_t)ERROR) mq_close(chan->mq);
+    free(chan->ring);
+    free(chan->freeNext);
+    free(chan->owner);
+    free(chan->slab);
+    memset(chan, 0, sizeof(*chan));
+    chan->mq = (mqd_t)ERROR;
+}
+
+void *msgchan_alloc(msgchan_t *chan, int wait) {
+    unsigned int index;
+
+    while ((index = free_pop(chan)) == FREE_EMPTY) {
+        if (!wait) return NULL;
+        sched_yield();
+    }
+
+    transfer(chan, index, OWNER_FREE, OWNER_SENDER);
+    return chan->slab + (size_t)index * chan->size;
+}
+
+int msgchan_send(msgchan_t *chan, void *buffer, size_t length, unsigned int prio) {
+    msgchan_desc_t desc;
+    unsigned int tail;
+    int index;
+
+    if ((index = buffer_index(chan, buffer)) == ERROR || length > chan->size) return ERROR;
+    if (transfer(chan, index, OWNER_SENDER, OWNER_CHANNEL) == ERROR) return ERROR;
+
+    desc.index = index;
+    desc.length = (unsigned int)length;
+
+    if (chan->transport == MSGCHAN_MQUEUE) {
+        if (mq_send(chan->mq, (const char *)&desc, sizeof(desc), prio) == ERROR) {
+            transfer(chan, index, OWNER_CHANNEL, OWNER_SENDER);
+            return ERROR;
+        }
+        return 0;
+    }
+
+    // single producer: only this thread moves the tail, the release store publishes the descriptor with it
+    tail = __atomic_load_n(&chan->ringTail, __ATOMIC_RELAXED);
+    chan->ring[tail & chan->ringMask] = desc;
+    __atomic_store_n(&chan->ringTail, tail + 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+void *msgchan_receive(msgchan_t *chan, size_t *length, int wait) {
+    struct timespec deadline = {0, 0};
+    msgchan_desc_t desc;
+    unsigned int head;
+
+    if (chan->transport == MSGCHAN_MQUEUE) {
+        // a deadline in the past makes mq_timedreceive return at once on an empty queue, a waiting receiver wakes
+        // every MSGCHAN_CLOSE_POLL_NS to see whether the channel was closed
+        for (;;) {
+            if (wait) {
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_nsec += MSGCHAN_CLOSE_POLL_NS;
+                if (deadline.tv_nsec >= 1000000000L) {
+                    deadline.tv_sec++;
+                    deadline.tv_nsec -= 1000000000L;
+                }
+            }
+            if (mq_timedreceive(chan->mq, (char *)&desc, sizeof(desc), NULL, &deadline) == sizeof(desc)) break;
+            if (!wait || (errno != ETIMEDOUT && errno != EINTR) || __atomic_load_n(&chan->closed, __ATOMIC_ACQUIRE))
+                return NULL;
+        }
+    } else {
+        head = __atomic_load_n(&chan->ringHead, __ATOMIC_RELAXED);
+        while (__atomic_load_n(&chan->ringTail, __ATOMIC_ACQUIRE) == head) {
+            // the tail is read again after closed so a message sent just before the close is not lost
+            if (!wait || (__atomic_load_n(&chan->closed, __ATOMIC_ACQUIRE) &&
+                          __atomic_load_n(&chan->ringTail, __ATOMIC_ACQUIRE) == head))
+                return NULL;
+            sched_yield();
+        }
+        desc = chan->ring[head & chan->ringMask];
+        __atomic_store_n(&chan->ringHead, head + 1, __ATOMIC_RELEASE);
+    }
+
+    if (desc.index >= chan->count || transfer(chan, desc.index, OWNER_CHANNEL, OWNER_RECEIVER) == ERROR) return NULL;
+
+    if (length) *length = desc.length;
+    return chan->slab + (size_t)desc.index * chan->size;
+}
+
+int msgchan_release(msgchan_t *chan, void *buffer) {
+    int index;
+
+    if ((index = buffer_index(chan, buffer)) == ERROR) return ERROR;
+    if (transfer(chan, index, OWNER_RECEIVER, OWNER_FREE) == ERROR) return ERROR;
+
+    free_push(chan, index);
+    return 0;
+}
+
+void msgchan_close(msgchan_t *chan) {
+    __atomic_store_n(&chan->closed, 1, __ATOMIC_RELEASE);
+}
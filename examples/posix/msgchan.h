@@ -0,0 +1,91 @@
+#ifndef MSGCHAN_H
+#define MSGCHAN_H
+
+// Zero copy message channel
+//
+// The message data never moves. A channel owns a slab of count preallocated buffers of size bytes each, and only
+// the index and length of a buffer go through the channel, either through a POSIX message queue or a lock free
+// ring. The slab and the ring are ordinary heap memory and the mqueue is unlinked once open, so a channel connects
+// threads of one process. A buffer always has exactly one owner:
+//
+//   msgchan_alloc     free slab        -> sender     (the sender fills it in place)
+//   msgchan_send      sender           -> channel    (the sender must not touch it again)
+//   msgchan_receive   channel          -> receiver   (the receiver reads it in place)
+//   msgchan_release   receiver         -> free slab
+//
+// Each step checks the buffer's owner and returns ERROR instead of passing on a buffer the caller doesn't own, so a
+// double send or release, or sending a received buffer without releasing it, is caught rather than corrupting a
+// message in flight.
+//
+// The free slab is a lock free stack usable by any number of threads. MSGCHAN_MQUEUE carries descriptors through
+// an mqueue, so any number of senders and receivers may share it and the priority of each message is honoured.
+// MSGCHAN_RING is a single producer, single consumer ring with no system calls at all, the receiver yields the CPU
+// while it is empty and the sender while it is full.
+//
+// A sender that gives up closes the channel, and a receiver waiting on it then gets NULL once no message is left
+// instead of waiting forever.
+//
+#include <mqueue.h>
+#include <stddef.h>
+
+#define ERROR (-1)
+
+#define MSGCHAN_MAX_BUFFERS (65536)
+#define MSGCHAN_CACHE_LINE (64)
+
+// How often a receiver waiting on an empty MSGCHAN_MQUEUE checks whether the channel was closed
+#define MSGCHAN_CLOSE_POLL_NS (10000000L)
+
+typedef enum { MSGCHAN_MQUEUE, MSGCHAN_RING } msgchan_transport_t;
+
+// Index and length of a buffer, the only thing that goes through the transport
+typedef struct {
+    unsigned int index;
+    unsigned int length;
+} msgchan_desc_t;
+
+typedef struct {
+    msgchan_transport_t transport;
+    unsigned char *slab;
+    size_t size;
+    unsigned int count;
+    unsigned char *owner;  // per buffer owner state
+
+    // free buffer stack, head is a 32 bit generation above a 32 bit index so a pop can't be fooled by ABA
+    unsigned int *freeNext;
+    unsigned long long freeHead __attribute__((aligned(MSGCHAN_CACHE_LINE)));
+
+    // MSGCHAN_RING, count entries, head and tail on their own cache lines
+    msgchan_desc_t *ring;
+    unsigned int ringMask;
+    unsigned int ringHead __attribute__((aligned(MSGCHAN_CACHE_LINE)));
+    unsigned int ringTail __attribute__((aligned(MSGCHAN_CACHE_LINE)));
+
+    // MSGCHAN_MQUEUE
+    mqd_t mq;
+    char mqName[32];
+
+    int closed;
+} msgchan_t;
+
+// Create a channel of count (at most MSGCHAN_MAX_BUFFERS) buffers of size bytes, each aligned to a cache line.
+// The mqueue holds count descriptors if the system allows, or as many as mq_maxmsg may be. Returns 0 or ERROR.
+int msgchan_create(msgchan_t *chan, msgchan_transport_t transport, unsigned int count, size_t size);
+void msgchan_destroy(msgchan_t *chan);
+
+// Take a free buffer, NULL if wait is 0 and all of them are in use
+void *msgchan_alloc(msgchan_t *chan, int wait);
+
+// Pass ownership of buffer with length bytes of message to the receiver. prio is used by MSGCHAN_MQUEUE only.
+int msgchan_send(msgchan_t *chan, void *buffer, size_t length, unsigned int prio);
+
+// Take ownership of the next message, NULL if wait is 0 and there is none, or on error
+void *msgchan_receive(msgchan_t *chan, size_t *length, int wait);
+
+// Give a received buffer back to the slab
+int msgchan_release(msgchan_t *chan, void *buffer);
+
+// No more messages will be sent, a waiting msgchan_receive returns NULL once the channel is empty
+void msgchan_close(msgchan_t *chan);
+
+#endif
@@ -0,0 +1,196 @@
+// NxN kernel crossover benchmark
+//
+// For each odd kernel size from 3 to 15 times the direct, separable and FFT paths of kernlib on one planar channel,
+// for a non-separable kernel (sharpen: a center tap minus a box blur) and a separable one (Gaussian), and shows
+// which path wins. The max difference column compares each path against the direct one. Use the table to set
+// kern_fft_threshold for the target.
+//
+// With -k a kernel file is timed instead, see the kernels directory for the format.
+//
+// Usage: kern_bench [-w width -h height] [-i iterations] [-k kernel_file]
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+
+#include "kernlib.h"
+
+#define DEFAULT_WIDTH (2000)
+#define DEFAULT_HEIGHT (1500)
+#define DEFAULT_ITERATIONS (3)
+
+#define NUM_METHODS (3)
+
+kern_method_t methods[NUM_METHODS] = {KERN_DIRECT, KERN_SEPARABLE, KERN_FFT};
+
+
+static double now_sec(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+
+// Sharpen generalized to size x size: the center gains K, all taps lose K/size^2 of a box blur
+static void sharpen_kernel(kern_t *kern, int size)
+{
+    double taps[KERN_MAX_SIZE * KERN_MAX_SIZE], K = 4.0;
+    int idx;
+
+    for(idx=0; idx < size * size; idx++)
+        taps[idx] = -K / (size * size);
+    taps[(size * size) / 2] += K + 1.0;
+    kern_init(kern, size, taps);
+}
+
+
+static void gaussian_kernel(kern_t *kern, int size)
+{
+    double taps[KERN_MAX_SIZE * KERN_MAX_SIZE], g[KERN_MAX_SIZE], sum = 0.0, sigma = size / 4.0;
+    int i, j, r = size / 2;
+
+    for(i=0; i < size; i++)
+    {
+        g[i] = exp(-((i - r) * (i - r)) / (2.0 * sigma * sigma));
+        sum += g[i];
+    }
+    for(i=0; i < size; i++)
+        for(j=0; j < size; j++)
+            taps[i * size + j] = (g[i] / sum) * (g[j] / sum);
+    kern_init(kern, size, taps);
+}
+
+
+static void bench(const char *name, const kern_t *kern, const UINT8 *src, UINT8 *dst, UINT8 *ref,
+    int width, int height, int iterations)
+{
+    kern_plan_t *plan = kern_plan_create(kern, width, height);
+    double best = 0.0, mpix[NUM_METHODS];
+    const char *winner = "";
+    int m, iter, diff[NUM_METHODS];
+    size_t i, pixels = (size_t)width * height;
+
+    if(plan == NULL)
+    {
+        printf("Error creating kernel plan\n");
+        exit(-1);
+    }
+
+    for(m=0; m < NUM_METHODS; m++)
+    {
+        double start;
+
+        mpix[m] = 0.0;
+        diff[m] = -1;
+        if(methods[m] == KERN_SEPARABLE && !kern->separable)
+            continue;
+
+        memcpy(dst, src, pixels);
+        start = now_sec();
+        for(iter=0; iter < iterations; iter++)
+            kern_plan_run(plan, methods[m], src, dst);
+        mpix[m] = (double)width * height * iterations / (now_sec() - start) / 1000000.0;
+
+        if(methods[m] == KERN_DIRECT)
+            memcpy(ref, dst, pixels);
+        for(i=0, diff[m]=0; i < pixels; i++)
+        {
+            int d = abs((int)dst[i] - (int)ref[i]);
+            if(d > diff[m]) diff[m] = d;
+        }
+
+        if(mpix[m] > best)
+        {
+            best = mpix[m];
+            winner = kern_method_name(methods[m]);
+        }
+    }
+
+    printf("%-10s %5dx%-2d", name, kern->size, kern->size);
+    for(m=0; m < NUM_METHODS; m++)
+    {
+        if(diff[m] < 0)
+            printf(" %10s %4s", "-", "");
+        else
+            printf(" %10.1lf %4d", mpix[m], diff[m]);
+    }
+    printf("  %s\n", winner);
+
+    kern_plan_destroy(plan);
+}
+
+
+int main(int argc, char *argv[])
+{
+    int width = DEFAULT_WIDTH, height = DEFAULT_HEIGHT, iterations = DEFAULT_ITERATIONS;
+    const char *kernel_file = NULL;
+    int opt, size, m;
+    size_t i, pixels;
+    UINT8 *src, *dst, *ref;
+    kern_t kern;
+
+    while((opt = getopt(argc, argv, "w:h:i:k:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'w': width = atoi(optarg); break;
+            case 'h': height = atoi(optarg); break;
+            case 'i': iterations = atoi(optarg); break;
+            case 'k': kernel_file = optarg; break;
+            default:
+                printf("Usage: kern_bench [-w width -h height] [-i iterations] [-k kernel_file]\n");
+                exit(-1);
+        }
+    }
+    if(width < 1 || height < 1 || iterations < 1)
+    {
+        printf("bad arguments\n");
+        exit(-1);
+    }
+
+    pixels = (size_t)width * height;
+    src = malloc(pixels);
+    dst = malloc(pixels);
+    ref = malloc(pixels);
+
+    srand(1);
+    for(i=0; i < pixels; i++)
+        src[i] = (UINT8)((((i % width) / 64 + (i / width) / 64) & 1) ? 200 : 40) + (rand() % 32);
+
+    printf("%dx%d, %d iterations, MPix/s and max diff from direct, FFT threshold %d\n", width, height, iterations,
+           kern_fft_threshold);
+    printf("%-10s %8s", "kernel", "size");
+    for(m=0; m < NUM_METHODS; m++)
+        printf(" %10s %4s", kern_method_name(methods[m]), "diff");
+    printf("  fastest\n");
+
+    if(kernel_file)
+    {
+        if(kern_load(&kern, kernel_file) < 0)
+            exit(-1);
+        bench(kern.separable ? "file sep" : "file", &kern, src, dst, ref, width, height, iterations);
+    }
+    else
+    {
+        for(size=KERN_MIN_SIZE; size <= KERN_MAX_SIZE; size += 2)
+        {
+            sharpen_kernel(&kern, size);
+            bench("sharpen", &kern, src, dst, ref, width, height, iterations);
+        }
+        for(size=KERN_MIN_SIZE; size <= KERN_MAX_SIZE; size += 2)
+        {
+            gaussian_kernel(&kern, size);
+            bench("gaussian", &kern, src, dst, ref, width, height, iterations);
+        }
+    }
+
+    free(src);
+    free(dst);
+    free(ref);
+    return 0;
+}
@@ -0,0 +1,482 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "kernlib.h"
+
+// Relative error allowed when checking the rank 1 factors against the kernel
+#define SEPARABLE_EPSILON (1.0e-9)
+
+// The FFT path rounds to within a few ULP of the exact sum, which would otherwise truncate an exact integer
+// result such as 100.0 down to 99
+#define FFT_BIAS (1.0e-3f)
+
+int kern_fft_threshold = 9;
+
+struct kern_plan
+{
+    kern_t kern;
+    int width, height;
+
+    // Direct, one row of accumulators
+    float *acc;
+
+    // Separable, horizontal pass results for the size rows around the output row
+    float *ring;
+
+    // FFT, overlap-save over tile x tile blocks
+    int tile;
+    int *bitrev;
+    float *cos_t, *sin_t;
+    float *hre, *him;
+    float *re, *im;
+};
+
+
+int kern_init(kern_t *kern, int size, const double *taps)
+{
+    int i, j, pi = 0, pj = 0;
+    double max = 0.0;
+
+    if(size < KERN_MIN_SIZE || size > KERN_MAX_SIZE || (size & 1) == 0)
+        return -1;
+
+    kern->size = size;
+    kern->radius = size / 2;
+    memcpy(kern->taps, taps, size * size * sizeof(double));
+
+    // Rank 1 decomposition through the largest tap: col is its column, row is its row scaled by 1/pivot, and the
+    // kernel is separable when every tap is col[i] * row[j]
+    for(i=0; i < size * size; i++)
+    {
+        if(fabs(taps[i]) > max)
+        {
+            max = fabs(taps[i]);
+            pi = i / size;
+            pj = i % size;
+        }
+    }
+
+    kern->separable = (max > 0.0);
+    for(i=0; i < size && kern->separable; i++)
+    {
+        kern->col[i] = taps[i * size + pj];
+        kern->row[i] = taps[pi * size + i] / taps[pi * size + pj];
+    }
+    for(i=0; i < size && kern->separable; i++)
+    {
+        for(j=0; j < size; j++)
+        {
+            if(fabs(taps[i * size + j] - kern->col[i] * kern->row[j]) > SEPARABLE_EPSILON * max)
+            {
+                kern->separable = 0;
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+int kern_load(kern_t *kern, const char *path)
+{
+    double taps[KERN_MAX_SIZE * KERN_MAX_SIZE];
+    int size, idx, c;
+    FILE *fp;
+
+    if((fp = fopen(path, "r")) == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    // Values are read one at a time so comment lines can appear anywhere
+    for(idx=-1; idx < 0 || (idx < size * size); )
+    {
+        while((c = fgetc(fp)) == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ',');
+        if(c == '#')
+        {
+            while((c = fgetc(fp)) != '\n' && c != EOF);
+            continue;
+        }
+        if(c == EOF)
+            break;
+        ungetc(c, fp);
+
+        if(idx < 0)
+        {
+            if(fscanf(fp, "%d", &size) != 1 || size < KERN_MIN_SIZE || size > KERN_MAX_SIZE || (size & 1) == 0)
+            {
+                printf("%s: size must be odd, %d to %d\n", path, KERN_MIN_SIZE, KERN_MAX_SIZE);
+                fclose(fp);
+                return -1;
+            }
+        }
+        else if(fscanf(fp, "%lf", &taps[idx]) != 1)
+            break;
+        idx++;
+    }
+    fclose(fp);
+
+    if(idx < 0 || idx < size * size)
+    {
+        printf("%s: expected a size and size x size taps\n", path);
+        return -1;
+    }
+
+    return kern_init(kern, size, taps);
+}
+
+
+static inline UINT8 clamp_pixel(float temp)
+{
+    if(temp < 0.0f) temp = 0.0f;
+    if(temp > 255.0f) temp = 255.0f;
+    return (UINT8)temp;
+}
+
+
+static void conv_direct(kern_plan_t *plan, const UINT8 *src, UINT8 *dst)
+{
+    const kern_t *kern = &plan->kern;
+    int width = plan->width, r = kern->radius, n = kern->size;
+    int i, j, a, b;
+
+    for(i=r; i < plan->height - r; i++)
+    {
+        float *acc = plan->acc;
+
+        for(j=r; j < width - r; j++)
+            acc[j] = 0.0f;
+
+        // One tap across the whole row at a time, which the compiler vectorizes
+        for(a=0; a < n; a++)
+        {
+            const UINT8 *s = &src[(i + a - r) * width];
+
+            for(b=0; b < n; b++)
+            {
+                float t = (float)kern->taps[a * n + b];
+
+                if(t == 0.0f)
+                    continue;
+                for(j=r; j < width - r; j++)
+                    acc[j] += t * s[j + b - r];
+            }
+        }
+
+        for(j=r; j < width - r; j++)
+            dst[i * width + j] = clamp_pixel(acc[j]);
+    }
+}
+
+
+static void conv_separable(kern_plan_t *plan, const UINT8 *src, UINT8 *dst)
+{
+    const kern_t *kern = &plan->kern;
+    int width = plan->width, r = kern->radius, n = kern->size;
+    int i, j, a, b, next = 0;
+    float *acc = plan->acc;
+
+    for(i=r; i < plan->height - r; i++)
+    {
+        // Horizontal pass for each input row the first time the window reaches it
+        for(; next <= i + r; next++)
+        {
+            float *h = &plan->ring[(next % n) * width];
+            const UINT8 *s = &src[next * width];
+
+            for(j=r; j < width - r; j++)
+                h[j] = 0.0f;
+            for(b=0; b < n; b++)
+            {
+                float t = (float)kern->row[b];
+
+                for(j=r; j < width - r; j++)
+                    h[j] += t * s[j + b - r];
+            }
+        }
+
+        // Vertical pass over the size rows around row i
+        for(j=r; j < width - r; j++)
+            acc[j] = 0.0f;
+        for(a=0; a < n; a++)
+        {
+            const float *h = &plan->ring[((i + a - r) % n) * width];
+            float t = (float)kern->col[a];
+
+            for(j=r; j < width - r; j++)
+                acc[j] += t * h[j];
+        }
+
+        for(j=r; j < width - r; j++)
+            dst[i * width + j] = clamp_pixel(acc[j]);
+    }
+}
+
+
+// One radix 2 butterfly applied down whole rows, x += w*y and y = x - w*y, which the compiler vectorizes
+static void butterfly_rows(float *restrict xr, float *restrict xi, float *restrict yr, float *restrict yi,
+    float wr, float wi, int n)
+{
+    int c;
+
+    for(c=0; c < n; c++)
+    {
+        float tr = yr[c] * wr - yi[c] * wi;
+        float ti = yr[c] * wi + yi[c] * wr;
+
+        yr[c] = xr[c] - tr;
+        yi[c] = xi[c] - ti;
+        xr[c] += tr;
+        xi[c] += ti;
+    }
+}
+
+
+// In place radix 2 FFT down every column of a tile x tile block at once, working on whole rows so that the
+// inner loops are contiguous
+static void fft_cols(const kern_plan_t *plan, float *re, float *im, int inverse)
+{
+    int n = plan->tile, i, j, k, c, len, half, step;
+    float sign = inverse ? 1.0f : -1.0f;
+
+    for(i=0; i < n; i++)
+    {
+        j = plan->bitrev[i];
+        if(j > i)
+        {
+            for(c=0; c < n; c++)
+            {
+                float t;
+                t = re[i * n + c]; re[i * n + c] = re[j * n + c]; re[j * n + c] = t;
+                t = im[i * n + c]; im[i * n + c] = im[j * n + c]; im[j * n + c] = t;
+            }
+        }
+    }
+
+    for(len=2; len <= n; len <<= 1)
+    {
+        half = len / 2;
+        step = n / len;
+        for(i=0; i < n; i += len)
+        {
+            for(k=0; k < half; k++)
+                butterfly_rows(&re[(i + k) * n], &im[(i + k) * n], &re[(i + k + half) * n], &im[(i + k + half) * n],
+                               plan->cos_t[k * step], sign * plan->sin_t[k * step], n);
+        }
+    }
+}
+
+
+static void transpose(float *a, int n)
+{
+    int i, j;
+
+    for(i=0; i < n; i++)
+    {
+        for(j=i + 1; j < n; j++)
+        {
+            float t = a[i * n + j];
+            a[i * n + j] = a[j * n + i];
+            a[j * n + i] = t;
+        }
+    }
+}
+
+
+// 2-D FFT as column FFTs, a transpose and column FFTs again. The forward result is the transposed spectrum, which
+// is fine since it is only multiplied by the kernel spectrum in the same layout, and the inverse transposes back.
+static void fft2d(const kern_plan_t *plan, float *re, float *im, int inverse)
+{
+    fft_cols(plan, re, im, inverse);
+    transpose(re, plan->tile);
+    transpose(im, plan->tile);
+    fft_cols(plan, re, im, inverse);
+}
+
+
+// Overlap-save: each tile x tile block of input yields (tile - 2 radius)^2 valid outputs. The kernel is real, so
+// two blocks go through each complex FFT, one as the real part and one as the imaginary part, and come back out
+// convolved in the same parts.
+static void conv_fft(kern_plan_t *plan, const UINT8 *src, UINT8 *dst)
+{
+    int width = plan->width, height = plan->height, r = plan->kern.radius, n = plan->tile;
+    int valid = n - 2 * r;
+    int across = (width - 2 * r + valid - 1) / valid;
+    int down = (height - 2 * r + valid - 1) / valid;
+    int tiles = across * down, t, part, x, y;
+    float *re = plan->re, *im = plan->im;
+
+    for(t=0; t < tiles; t += 2)
+    {
+        for(part=0; part < 2; part++)
+        {
+            float *dstpart = part ? im : re;
+            int i0 = r + ((t + part) / across) * valid, j0 = r + ((t + part) % across) * valid;
+
+            for(y=0; y < n; y++)
+            {
+                int sy = i0 - r + y;
+
+                for(x=0; x < n; x++)
+                {
+                    int sx = j0 - r + x;
+                    dstpart[y * n + x] = (t + part < tiles && sy < height && sx < width) ? src[sy * width + sx] : 0.0f;
+                }
+            }
+        }
+
+        fft2d(plan, re, im, 0);
+        for(x=0; x < n * n; x++)
+        {
+            float pr = re[x] * plan->hre[x] - im[x] * plan->him[x];
+            float pi = re[x] * plan->him[x] + im[x] * plan->hre[x];
+            re[x] = pr;
+            im[x] = pi;
+        }
+        fft2d(plan, re, im, 1);
+
+        for(part=0; part < 2 && t + part < tiles; part++)
+        {
+            const float *srcpart = part ? im : re;
+            int i0 = r + ((t + part) / across) * valid, j0 = r + ((t + part) % across) * valid;
+
+            for(y=r; y < n - r && i0 + y - r < height - r; y++)
+            {
+                for(x=r; x < n - r && j0 + x - r < width - r; x++)
+                    dst[(i0 + y - r) * width + j0 + x - r] = clamp_pixel(srcpart[y * n + x] + FFT_BIAS);
+            }
+        }
+    }
+}
+
+
+kern_plan_t *kern_plan_create(const kern_t *kern, int width, int height)
+{
+    kern_plan_t *plan;
+    int n, bits, i, a, b, r = kern->radius;
+
+    if((plan = calloc(1, sizeof(kern_plan_t))) == NULL)
+        return NULL;
+
+    plan->kern = *kern;
+    plan->width = width;
+    plan->height = height;
+
+    // Power of 2 tile with the least FFT work per valid output, n^2 log2(n) / (n - 2r)^2
+    for(n=32, bits=5, i=64, a=6; i <= 256; i <<= 1, a++)
+    {
+        if((double)i * i * a / ((i - 2.0 * r) * (i - 2.0 * r)) < (double)n * n * bits / ((n - 2.0 * r) * (n - 2.0 * r)))
+        {
+            n = i;
+            bits = a;
+        }
+    }
+    plan->tile = n;
+
+    plan->acc = malloc(width * sizeof(float));
+    plan->ring = malloc(kern->size * width * sizeof(float));
+    plan->bitrev = malloc(n * sizeof(int));
+    plan->cos_t = malloc(n / 2 * sizeof(float));
+    plan->sin_t = malloc(n / 2 * sizeof(float));
+    plan->hre = calloc(n * n, sizeof(float));
+    plan->him = calloc(n * n, sizeof(float));
+    plan->re = malloc(n * n * sizeof(float));
+    plan->im = malloc(n * n * sizeof(float));
+
+    if(!plan->acc || !plan->ring || !plan->bitrev || !plan->cos_t || !plan->sin_t ||
+       !plan->hre || !plan->him || !plan->re || !plan->im)
+    {
+        kern_plan_destroy(plan);
+        return NULL;
+    }
+
+    for(i=0; i < n; i++)
+    {
+        int rev = 0, bit;
+
+        for(bit=0; bit < bits; bit++)
+            rev |= ((i >> bit) & 1) << (bits - 1 - bit);
+        plan->bitrev[i] = rev;
+    }
+    for(i=0; i < n / 2; i++)
+    {
+        plan->cos_t[i] = (float)cos(2.0 * M_PI * i / n);
+        plan->sin_t[i] = (float)sin(2.0 * M_PI * i / n);
+    }
+
+    // The output sums taps[a][b] * src[i+a][j+b], a circular convolution with the kernel mirrored about the origin.
+    // The 1/(n*n) scale of the inverse FFT is folded into the spectrum.
+    for(a=-r; a <= r; a++)
+    {
+        for(b=-r; b <= r; b++)
+            plan->hre[((-a) & (n - 1)) * n + ((-b) & (n - 1))] = (float)kern->taps[(a + r) * kern->size + b + r];
+    }
+    fft2d(plan, plan->hre, plan->him, 0);
+    for(i=0; i < n * n; i++)
+    {
+        plan->hre[i] /= (float)(n * n);
+        plan->him[i] /= (float)(n * n);
+    }
+
+    return plan;
+}
+
+
+void kern_plan_destroy(kern_plan_t *plan)
+{
+    free(plan->acc);
+    free(plan->ring);
+    free(plan->bitrev);
+    free(plan->cos_t);
+    free(plan->sin_t);
+    free(plan->hre);
+    free(plan->him);
+    free(plan->re);
+    free(plan->im);
+    free(plan);
+}
+
+
+kern_method_t kern_plan_run(kern_plan_t *plan, kern_method_t method, const UINT8 *src, UINT8 *dst)
+{
+    if(method == KERN_AUTO)
+    {
+        if(plan->kern.separable)
+            method = KERN_SEPARABLE;
+        else if(plan->kern.size >= kern_fft_threshold)
+            method = KERN_FFT;
+        else
+            method = KERN_DIRECT;
+    }
+    if(method == KERN_SEPARABLE && !plan->kern.separable)
+        method = KERN_DIRECT;
+
+    if(plan->width <= 2 * plan->kern.radius || plan->height <= 2 * plan->kern.radius)
+        return method;
+
+    switch(method)
+    {
+        case KERN_SEPARABLE: conv_separable(plan, src, dst); break;
+        case KERN_FFT: conv_fft(plan, src, dst); break;
+        default: conv_direct(plan, src, dst); break;
+    }
+
+    return method;
+}
+
+
+const char *kern_method_name(kern_method_t method)
+{
+    switch(method)
+    {
+        case KERN_AUTO: return "auto";
+        case KERN_DIRECT: return "direct";
+        case KERN_SEPARABLE: return "separable";
+        case KERN_FFT: return "fft";
+    }
+    return "unknown";
+}
@@ -0,0 +1,57 @@
+#ifndef KERNLIB_H
+#define KERNLIB_H
+
+typedef unsigned char UINT8;
+
+#define KERN_MIN_SIZE (3)
+#define KERN_MAX_SIZE (15)
+
+// An odd NxN convolution kernel in row major order, applied like the PSF in sharpen: each output pixel is the sum
+// of the taps times the input pixels under the kernel centered on it, clamped to [0, 255] and truncated.
+//
+// A kernel that is the outer product of a column and a row vector (rank 1) is separable and can be applied as a
+// horizontal pass of N taps followed by a vertical pass of N taps, 2N multiplies per pixel instead of N*N.
+//
+typedef struct
+{
+    int size;
+    int radius;
+    double taps[KERN_MAX_SIZE * KERN_MAX_SIZE];
+
+    int separable;
+    double col[KERN_MAX_SIZE];
+    double row[KERN_MAX_SIZE];
+} kern_t;
+
+typedef enum
+{
+    KERN_AUTO,
+    KERN_DIRECT,
+    KERN_SEPARABLE,
+    KERN_FFT
+} kern_method_t;
+
+// Non-separable kernels of this size and up use the FFT path with KERN_AUTO, set from kern_bench results
+extern int kern_fft_threshold;
+
+// Set up a kernel from size*size taps, returns 0 or -1 if the size is not odd and within the supported range
+int kern_init(kern_t *kern, int size, const double *taps);
+
+// Load a kernel from a text file holding the size followed by size*size taps, # starts a comment line.
+// Returns 0 or -1 with a message on stdout.
+int kern_load(kern_t *kern, const char *path);
+
+// Scratch buffers and FFT tables for applying one kernel to one planar channel size
+typedef struct kern_plan kern_plan_t;
+
+kern_plan_t *kern_plan_create(const kern_t *kern, int width, int height);
+
+void kern_plan_destroy(kern_plan_t *plan);
+
+// Convolve one planar channel. The border of radius pixels has no full neighborhood and is left untouched in dst.
+// KERN_SEPARABLE falls back to KERN_DIRECT for a kernel that is not separable. Returns the method used.
+kern_method_t kern_plan_run(kern_plan_t *plan, kern_method_t method, const UINT8 *src, UINT8 *dst);
+
+const char *kern_method_name(kern_method_t method);
+
+#endif
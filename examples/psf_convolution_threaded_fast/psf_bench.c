@@ -0,0 +1,178 @@
+// PSF convolution engine benchmark
+//
+// Runs every psflib engine over one planar channel and reports MPix/s and the largest difference from the
+// double precision reference. With no arguments a synthetic 4000x3000 channel is used, otherwise the red channel
+// of a binary PPM is loaded. The sharpen PSF is run with F=8, whose taps are exact in Q8.8, and with F=7, whose
+// taps need more fractional bits to stay within 1 LSB.
+//
+// Usage: psf_bench [-i iterations] [-w width -h height] [image.ppm]
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "psflib.h"
+
+#define DEFAULT_WIDTH (4000)
+#define DEFAULT_HEIGHT (3000)
+#define DEFAULT_ITERATIONS (10)
+
+#define K 4.0
+
+static const double divisors[] = {8.0, 7.0};
+
+
+static double now_sec(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+
+// Loads the red channel of a binary PPM, returns NULL on any error
+static UINT8 *load_ppm(const char *path, int *width, int *height)
+{
+    FILE *fp;
+    int maxval, i;
+    UINT8 *chan, rgb[3];
+
+    if((fp = fopen(path, "rb")) == NULL)
+    {
+        perror(path);
+        return NULL;
+    }
+
+    if(fgetc(fp) != 'P' || fgetc(fp) != '6' ||
+       ppm_number(fp, width) != 1 || ppm_number(fp, height) != 1 || ppm_number(fp, &maxval) != 1 || maxval != 255)
+    {
+        printf("%s: not an 8 bit binary PPM\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    fgetc(fp);
+
+    chan = malloc((size_t)(*width) * (*height));
+    for(i=0; chan && i < (*width) * (*height); i++)
+    {
+        if(fread(rgb, 3, 1, fp) != 1)
+        {
+            printf("%s: short read\n", path);
+            free(chan);
+            chan = NULL;
+        }
+        else
+            chan[i] = rgb[0];
+    }
+
+    fclose(fp);
+    return chan;
+}
+
+
+// Edges, gradients and noise so that results clamp at both ends of the range
+static UINT8 *synthetic(int width, int height)
+{
+    UINT8 *chan = malloc((size_t)width * height);
+    int i, j;
+
+    srand(1);
+    for(i=0; i < height; i++)
+    {
+        for(j=0; j < width; j++)
+        {
+            int v = ((j / 64 + i / 64) & 1) ? 200 : 40;
+            v += (j % 256) / 4 + (rand() % 32) - 16;
+            chan[i*width + j] = (UINT8)(v < 0 ? 0 : (v > 255 ? 255 : v));
+        }
+    }
+    return chan;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int width = DEFAULT_WIDTH, height = DEFAULT_HEIGHT, iterations = DEFAULT_ITERATIONS;
+    int opt, idx, iter, max_diff, fail = 0;
+    unsigned f;
+    size_t pixels, i;
+    UINT8 *src, *ref, *dst;
+    double start, elapsed, mpix;
+    psf3_t psf;
+
+    while((opt = getopt(argc, argv, "i:w:h:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'i': iterations = atoi(optarg); break;
+            case 'w': width = atoi(optarg); break;
+            case 'h': height = atoi(optarg); break;
+            default:
+                printf("Usage: psf_bench [-i iterations] [-w width -h height] [image.ppm]\n");
+                exit(-1);
+        }
+    }
+
+    if(optind < argc)
+        src = load_ppm(argv[optind], &width, &height);
+    else
+        src = synthetic(width, height);
+
+    if(src == NULL || width < 3 || height < 3 || iterations < 1)
+    {
+        printf("no image to convolve\n");
+        exit(-1);
+    }
+
+    pixels = (size_t)width * height;
+    ref = malloc(pixels);
+    dst = malloc(pixels);
+
+    for(f=0; f < sizeof(divisors) / sizeof(divisors[0]); f++)
+    {
+        double F = divisors[f];
+        double PSF[9] = {-K/F, -K/F, -K/F, -K/F, K+1.0, -K/F, -K/F, -K/F, -K/F};
+
+        psf3_init(&psf, PSF);
+        memcpy(ref, src, pixels);
+        psf3_conv_ref(&psf, src, ref, width, height, 0, height, 0, width);
+
+        printf("%s%dx%d, %d iterations, SIMD %s, PSF K=%.0lf F=%.0lf %s, fixed point ", f ? "\n" : "", width, height,
+               iterations, psf3_simd_name(), K, F, psf.symmetric ? "symmetric" : "asymmetric");
+        if(psf.q_float)
+            printf("falls back to float32\n");
+        else
+            printf("Q.%d, worst case %.3lf LSB\n", psf.q_bits, psf.q_error);
+        printf("%-10s %10s %10s %8s\n", "engine", "ms/frame", "MPix/s", "max diff");
+
+        for(idx=0; idx < psf3_num_engines; idx++)
+        {
+            const psf3_engine_t *engine = &psf3_engines[idx];
+
+            memcpy(dst, src, pixels);
+            start = now_sec();
+            for(iter=0; iter < iterations; iter++)
+                engine->convolve(&psf, src, dst, width, height, 0, height, 0, width);
+            elapsed = (now_sec() - start) / iterations;
+
+            for(i=0, max_diff=0; i < pixels; i++)
+            {
+                int diff = abs((int)dst[i] - (int)ref[i]);
+                if(diff > max_diff) max_diff = diff;
+            }
+
+            mpix = ((double)(width-2) * (height-2)) / elapsed / 1000000.0;
+            printf("%-10s %10.3lf %10.1lf %8d%s\n", engine->name, elapsed * 1000.0, mpix, max_diff,
+                   max_diff > 1 ? "  FAIL" : "");
+            fail |= max_diff > 1;
+        }
+    }
+
+    free(src);
+    free(ref);
+    free(dst);
+    return fail ? 1 : 0;
+}
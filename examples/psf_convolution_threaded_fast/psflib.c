@@ -0,0 +1,426 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "psflib.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PSF_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PSF_SSE2
+#endif
+
+
+#define Q_MIN_BITS (8)
+#define Q_MAX_BITS (14)
+
+
+// Worst case error in LSBs of rounding the taps to bits fractional bits, or -1 if a tap does not fit in 16 bits
+static double quantize(const double taps[9], int bits, short q[9])
+{
+    double scale = (double)(1 << bits), error = 0.0;
+    long value;
+    int idx;
+
+    for (idx = 0; idx < 9; idx++)
+    {
+        value = lround(taps[idx] * scale);
+        if (value < -32768 || value > 32767) return -1.0;
+        q[idx] = (short)value;
+        error += fabs(taps[idx] - (double)value / scale) * 255.0;
+    }
+    return error;
+}
+
+
+void psf3_init(psf3_t *psf, const double taps[9])
+{
+    int idx;
+
+    for (idx = 0; idx < 9; idx++)
+    {
+        psf->taps[idx] = taps[idx];
+        psf->f32[idx] = (float)taps[idx];
+    }
+
+    // The fewest fractional bits that keep every result within 1 LSB of the reference
+    psf->q_float = 1;
+    for (psf->q_bits = Q_MIN_BITS; psf->q_bits <= Q_MAX_BITS; psf->q_bits++)
+    {
+        psf->q_error = quantize(taps, psf->q_bits, psf->q88);
+        if (psf->q_error < 0.0) break;
+        if (psf->q_error <= 1.0)
+        {
+            psf->q_float = 0;
+            break;
+        }
+    }
+    if (psf->q_float)
+    {
+        psf->q_bits = Q_MIN_BITS;
+        psf->q_error = quantize(taps, Q_MIN_BITS, psf->q88);
+    }
+
+    psf->symmetric = (taps[0] == taps[2]) && (taps[0] == taps[6]) && (taps[0] == taps[8]) &&
+                     (taps[1] == taps[3]) && (taps[1] == taps[5]) && (taps[1] == taps[7]);
+
+    psf->q88_center = psf->q88[4];
+    psf->q88_edge = psf->q88[1];
+    psf->q88_corner = psf->q88[0];
+    psf->f32_center = psf->f32[4];
+    psf->f32_edge = psf->f32[1];
+    psf->f32_corner = psf->f32[0];
+}
+
+
+// Clip the requested rectangle to the interior of the image
+static void clip(int width, int height, int *row0, int *row1, int *col0, int *col1)
+{
+    if (*row0 < 1) *row0 = 1;
+    if (*row1 > height - 1) *row1 = height - 1;
+    if (*col0 < 1) *col0 = 1;
+    if (*col1 > width - 1) *col1 = width - 1;
+}
+
+
+// Fixed point accumulator to pixel, truncating like the reference
+static inline UINT8 q_pixel(int acc, int bits)
+{
+    if (acc < 0) return 0;
+    acc >>= bits;
+    return (acc > 255) ? 255 : (UINT8)acc;
+}
+
+
+static inline UINT8 f32_pixel(float temp)
+{
+    if (temp < 0.0f) temp = 0.0f;
+    if (temp > 255.0f) temp = 255.0f;
+    return (UINT8)temp;
+}
+
+
+void psf3_row_ref(const psf3_t *psf, const UINT8 *top, const UINT8 *mid, const UINT8 *bot, UINT8 *out,
+    int col0, int col1, int step)
+{
+    const double *PSF = psf->taps;
+    int j;
+    double temp;
+
+    for (j = col0; j < col1; j++)
+    {
+        temp = 0;
+        temp += (PSF[0] * (double)top[j - step]);
+        temp += (PSF[1] * (double)top[j]);
+        temp += (PSF[2] * (double)top[j + step]);
+        temp += (PSF[3] * (double)mid[j - step]);
+        temp += (PSF[4] * (double)mid[j]);
+        temp += (PSF[5] * (double)mid[j + step]);
+        temp += (PSF[6] * (double)bot[j - step]);
+        temp += (PSF[7] * (double)bot[j]);
+        temp += (PSF[8] * (double)bot[j + step]);
+        if (temp < 0.0) temp = 0.0;
+        if (temp > 255.0) temp = 255.0;
+        out[j] = (UINT8)temp;
+    }
+}
+
+
+static void f32_row(const psf3_t *psf, const UINT8 *top, const UINT8 *mid, const UINT8 *bot, UINT8 *out,
+    int col0, int col1, int step)
+{
+    const float *f = psf->f32;
+    int j;
+    float temp;
+
+    if (psf->symmetric)
+    {
+        for (j = col0; j < col1; j++)
+        {
+            int edges = top[j] + bot[j] + mid[j - step] + mid[j + step];
+            int corners = top[j - step] + top[j + step] + bot[j - step] + bot[j + step];
+            temp = psf->f32_center * mid[j] + psf->f32_edge * edges + psf->f32_corner * corners;
+            out[j] = f32_pixel(temp);
+        }
+    }
+    else
+    {
+        for (j = col0; j < col1; j++)
+        {
+            temp = f[0] * top[j - step] + f[1] * top[j] + f[2] * top[j + step] +
+                   f[3] * mid[j - step] + f[4] * mid[j] + f[5] * mid[j + step] +
+                   f[6] * bot[j - step] + f[7] * bot[j] + f[8] * bot[j + step];
+            out[j] = f32_pixel(temp);
+        }
+    }
+}
+
+
+// The scalar rows also finish the tail of each row for the SIMD engines
+void psf3_row_q88(const psf3_t *psf, const UINT8 *top, const UINT8 *mid, const UINT8 *bot, UINT8 *out,
+    int col0, int col1, int step)
+{
+    const short *q = psf->q88;
+    int j, acc;
+
+    if (psf->q_float)
+    {
+        f32_row(psf, top, mid, bot, out, col0, col1, step);
+        return;
+    }
+
+    if (psf->symmetric)
+    {
+        for (j = col0; j < col1; j++)
+        {
+            int edges = top[j] + bot[j] + mid[j - step] + mid[j + step];
+            int corners = top[j - step] + top[j + step] + bot[j - step] + bot[j + step];
+            acc = psf->q88_center * mid[j] + psf->q88_edge * edges + psf->q88_corner * corners;
+            out[j] = q_pixel(acc, psf->q_bits);
+        }
+    }
+    else
+    {
+        for (j = col0; j < col1; j++)
+        {
+            acc = q[0] * top[j - step] + q[1] * top[j] + q[2] * top[j + step] +
+                  q[3] * mid[j - step] + q[4] * mid[j] + q[5] * mid[j + step] +
+                  q[6] * bot[j - step] + q[7] * bot[j] + q[8] * bot[j + step];
+            out[j] = q_pixel(acc, psf->q_bits);
+        }
+    }
+}
+
+
+void psf3_row_q88_simd(const psf3_t *psf, const UINT8 *top, const UINT8 *mid, const UINT8 *bot, UINT8 *out,
+    int col0, int col1, int step)
+{
+    int j = col0;
+
+    if (psf->q_float)
+    {
+        psf3_row_f32_simd(psf, top, mid, bot, out, col0, col1, step);
+        return;
+    }
+
+    // The vector loads read j-step to j+7+step, all inside the row since col1 is at most the row length less step
+#if defined(PSF_NEON)
+    if (psf->symmetric)
+    {
+        const int32x4_t shift = vdupq_n_s32(-psf->q_bits);
+
+        for (; j + 8 <= col1; j += 8)
+        {
+            int16x8_t center = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(mid + j)));
+            int16x8_t edges = vreinterpretq_s16_u16(
+                vaddq_u16(vaddl_u8(vld1_u8(top + j), vld1_u8(bot + j)),
+                          vaddl_u8(vld1_u8(mid + j - step), vld1_u8(mid + j + step))));
+            int16x8_t corners = vreinterpretq_s16_u16(
+                vaddq_u16(vaddl_u8(vld1_u8(top + j - step), vld1_u8(top + j + step)),
+                          vaddl_u8(vld1_u8(bot + j - step), vld1_u8(bot + j + step))));
+
+            int32x4_t lo = vmull_n_s16(vget_low_s16(center), psf->q88_center);
+            lo = vmlal_n_s16(lo, vget_low_s16(edges), psf->q88_edge);
+            lo = vmlal_n_s16(lo, vget_low_s16(corners), psf->q88_corner);
+            int32x4_t hi = vmull_n_s16(vget_high_s16(center), psf->q88_center);
+            hi = vmlal_n_s16(hi, vget_high_s16(edges), psf->q88_edge);
+            hi = vmlal_n_s16(hi, vget_high_s16(corners), psf->q88_corner);
+
+            int16x8_t result = vcombine_s16(vqmovn_s32(vshlq_s32(lo, shift)), vqmovn_s32(vshlq_s32(hi, shift)));
+            vst1_u8(out + j, vqmovun_s16(result));
+        }
+    }
+#elif defined(PSF_SSE2)
+    if (psf->symmetric)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i w_center_edge =
+            _mm_set1_epi32((int)(((unsigned)(unsigned short)psf->q88_edge << 16) |
+                                 (unsigned short)psf->q88_center));
+        const __m128i w_corner = _mm_set1_epi32((unsigned short)psf->q88_corner);
+        const __m128i shift = _mm_cvtsi32_si128(psf->q_bits);
+
+#define LOAD8(p) _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(p)), zero)
+        for (; j + 8 <= col1; j += 8)
+        {
+            __m128i center = LOAD8(mid + j);
+            __m128i edges = _mm_add_epi16(_mm_add_epi16(LOAD8(top + j), LOAD8(bot + j)),
+                                          _mm_add_epi16(LOAD8(mid + j - step), LOAD8(mid + j + step)));
+            __m128i corners = _mm_add_epi16(_mm_add_epi16(LOAD8(top + j - step), LOAD8(top + j + step)),
+                                            _mm_add_epi16(LOAD8(bot + j - step), LOAD8(bot + j + step)));
+
+            // madd pairs (center, edges) with (center tap, edge tap) and (corners, 0) with (corner tap, 0)
+            __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(center, edges), w_center_edge),
+                                       _mm_madd_epi16(_mm_unpacklo_epi16(corners, zero), w_corner));
+            __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(center, edges), w_center_edge),
+                                       _mm_madd_epi16(_mm_unpackhi_epi16(corners, zero), w_corner));
+
+            __m128i result = _mm_packs_epi32(_mm_sra_epi32(lo, shift), _mm_sra_epi32(hi, shift));
+            _mm_storel_epi64((__m128i *)(out + j), _mm_packus_epi16(result, zero));
+        }
+#undef LOAD8
+    }
+#endif
+
+    psf3_row_q88(psf, top, mid, bot, out, j, col1, step);
+}
+
+
+void psf3_row_f32_simd(const psf3_t *psf, const UINT8 *top, const UINT8 *mid, const UINT8 *bot, UINT8 *out,
+    int col0, int col1, int step)
+{
+    int j = col0;
+
+    // The neighbor sums are exact in 16 bits, only the weighting is done in float32
+#if defined(PSF_NEON)
+    if (psf->symmetric)
+    {
+        for (; j + 8 <= col1; j += 8)
+        {
+            int16x8_t center = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(mid + j)));
+            int16x8_t edges = vreinterpretq_s16_u16(
+                vaddq_u16(vaddl_u8(vld1_u8(top + j), vld1_u8(bot + j)),
+                          vaddl_u8(vld1_u8(mid + j - step), vld1_u8(mid + j + step))));
+            int16x8_t corners = vreinterpretq_s16_u16(
+                vaddq_u16(vaddl_u8(vld1_u8(top + j - step), vld1_u8(top + j + step)),
+                          vaddl_u8(vld1_u8(bot + j - step), vld1_u8(bot + j + step))));
+
+            float32x4_t lo = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(center))), psf->f32_center);
+            lo = vmlaq_n_f32(lo, vcvtq_f32_s32(vmovl_s16(vget_low_s16(edges))), psf->f32_edge);
+            lo = vmlaq_n_f32(lo, vcvtq_f32_s32(vmovl_s16(vget_low_s16(corners))), psf->f32_corner);
+            float32x4_t hi = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(center))), psf->f32_center);
+            hi = vmlaq_n_f32(hi, vcvtq_f32_s32(vmovl_s16(vget_high_s16(edges))), psf->f32_edge);
+            hi = vmlaq_n_f32(hi, vcvtq_f32_s32(vmovl_s16(vget_high_s16(corners))), psf->f32_corner);
+
+            int16x8_t result = vcombine_s16(vqmovn_s32(vcvtq_s32_f32(lo)), vqmovn_s32(vcvtq_s32_f32(hi)));
+            vst1_u8(out + j, vqmovun_s16(result));
+        }
+    }
+#elif defined(PSF_SSE2)
+    if (psf->symmetric)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 w_center = _mm_set1_ps(psf->f32_center);
+        const __m128 w_edge = _mm_set1_ps(psf->f32_edge);
+        const __m128 w_corner = _mm_set1_ps(psf->f32_corner);
+
+#define LOAD8(p) _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(p)), zero)
+#define LO_PS(v) _mm_cvtepi32_ps(_mm_unpacklo_epi16((v), zero))
+#define HI_PS(v) _mm_cvtepi32_ps(_mm_unpackhi_epi16((v), zero))
+        for (; j + 8 <= col1; j += 8)
+        {
+            __m128i center = LOAD8(mid + j);
+            __m128i edges = _mm_add_epi16(_mm_add_epi16(LOAD8(top + j), LOAD8(bot + j)),
+                                          _mm_add_epi16(LOAD8(mid + j - step), LOAD8(mid + j + step)));
+            __m128i corners = _mm_add_epi16(_mm_add_epi16(LOAD8(top + j - step), LOAD8(top + j + step)),
+                                            _mm_add_epi16(LOAD8(bot + j - step), LOAD8(bot + j + step)));
+
+            __m128 lo = _mm_add_ps(_mm_add_ps(_mm_mul_ps(LO_PS(center), w_center), _mm_mul_ps(LO_PS(edges), w_edge)),
+                                   _mm_mul_ps(LO_PS(corners), w_corner));
+            __m128 hi = _mm_add_ps(_mm_add_ps(_mm_mul_ps(HI_PS(center), w_center), _mm_mul_ps(HI_PS(edges), w_edge)),
+                                   _mm_mul_ps(HI_PS(corners), w_corner));
+
+            __m128i result = _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi));
+            _mm_storel_epi64((__m128i *)(out + j), _mm_packus_epi16(result, zero));
+        }
+#undef LOAD8
+#undef LO_PS
+#undef HI_PS
+    }
+#endif
+
+    f32_row(psf, top, mid, bot, out, j, col1, step);
+}
+
+
+// Planar engines run the row engine over each row of the clipped rectangle with neighbors 1 byte apart
+static void convolve(psf3_row_fn row, const psf3_t *psf, const UINT8 *src, UINT8 *dst, int width, int height,
+    int row0, int row1, int col0, int col1)
+{
+    int i;
+
+    clip(width, height, &row0, &row1, &col0, &col1);
+
+    for (i = row0; i < row1; i++)
+        row(psf, &src[(i - 1) * width], &src[i * width], &src[(i + 1) * width], &dst[i * width], col0, col1, 1);
+}
+
+
+void psf3_conv_ref(const psf3_t *psf, const UINT8 *src, UINT8 *dst, int width, int height,
+    int row0, int row1, int col0, int col1)
+{
+    convolve(psf3_row_ref, psf, src, dst, width, height, row0, row1, col0, col1);
+}
+
+
+void psf3_conv_q88(const psf3_t *psf, const UINT8 *src, UINT8 *dst, int width, int height,
+    int row0, int row1, int col0, int col1)
+{
+    convolve(psf3_row_q88, psf, src, dst, width, height, row0, row1, col0, col1);
+}
+
+
+void psf3_conv_q88_simd(const psf3_t *psf, const UINT8 *src, UINT8 *dst, int width, int height,
+    int row0, int row1, int col0, int col1)
+{
+    convolve(psf3_row_q88_simd, psf, src, dst, width, height, row0, row1, col0, col1);
+}
+
+
+void psf3_conv_f32_simd(const psf3_t *psf, const UINT8 *src, UINT8 *dst, int width, int height,
+    int row0, int row1, int col0, int col1)
+{
+    convolve(psf3_row_f32_simd, psf, src, dst, width, height, row0, row1, col0, col1);
+}
+
+
+const psf3_engine_t psf3_engines[] = {
+    {"ref", psf3_conv_ref, psf3_row_ref},
+    {"q88", psf3_conv_q88, psf3_row_q88},
+    {"q88_simd", psf3_conv_q88_simd, psf3_row_q88_simd},
+    {"f32_simd", psf3_conv_f32_simd, psf3_row_f32_simd},
+};
+
+const int psf3_num_engines = sizeof(psf3_engines) / sizeof(psf3_engines[0]);
+
+
+const psf3_engine_t *psf3_find_engine(const char *name)
+{
+    int idx;
+
+    for (idx = 0; idx < psf3_num_engines; idx++)
+    {
+        if (strcmp(psf3_engines[idx].name, name) == 0)
+            return &psf3_engines[idx];
+    }
+    return NULL;
+}
+
+
+const char *psf3_simd_name(void)
+{
+#if defined(PSF_NEON)
+    return "neon";
+#elif defined(PSF_SSE2)
+    return "sse2";
+#else
+    return "none";
+#endif
+}
+
+
+int ppm_number(FILE *fp, int *value)
+{
+    int c;
+
+    while ((c = fgetc(fp)) == '#' || c == ' ' || c == '\t' || c == '\n' || c == '\r')
+    {
+        if (c == '#')
+            while ((c = fgetc(fp)) != '\n' && c != EOF);
+    }
+    if (c == EOF) return 0;
+    ungetc(c, fp);
+    return fscanf(fp, "%d", value);
+}
@@ -0,0 +1,98 @@
+#ifndef PSFLIB_H
+#define PSFLIB_H
+
+#include <stdio.h>
+
+typedef unsigned char UINT8;
+
+// A 3x3 PSF in row major order, prepared for each convolution engine.
+//
+// The sharpen PSF is symmetric: the four corner taps are equal and the four edge taps are equal. The fast engines
+// exploit that to compute each output from the center pixel, the sum of the edge neighbors and the sum of the
+// corner neighbors, 3 multiplies instead of 9. For an asymmetric PSF they fall back to all 9 taps.
+//
+typedef struct
+{
+    double taps[9];
+    int symmetric;
+
+    // Fixed point with q_bits fractional bits, Q8.8 unless rounding the taps to 1/256 could move a result by more
+    // than 1 LSB, q_error being that worst case, sum |tap - q/2^q_bits| * 255. Up to 14 bits are tried before the
+    // fixed point engines give up and run the float32 ones instead, q_float.
+    short q88[9];
+    short q88_center, q88_edge, q88_corner;
+    int q_bits;
+    double q_error;
+    int q_float;
+
+    // float32
+    float f32[9];
+    float f32_center, f32_edge, f32_corner;
+} psf3_t;
+
+// Every engine convolves the rectangle of rows [row0, row1) and columns [col0, col1) of a planar channel of
+// `width` x `height` pixels from src into dst. The rectangle is clipped to the interior since the border rows and
+// columns have no neighbors to convolve with, and the border of dst is left untouched. Results are clamped to
+// [0, 255] and truncated like the double reference.
+//
+typedef void (*psf3_engine_fn)(const psf3_t *psf, const UINT8 *src, UINT8 *dst, int width, int height,
+    int row0, int row1, int col0, int col1);
+
+// Every engine also has a row form for packed layouts such as interleaved RGB. It convolves the bytes
+// [col0, col1) of one row from the rows above, at and below it into out, with horizontal neighbors `step` bytes
+// apart, 3 for RGB. The caller keeps col0 >= step and col1 <= row length - step.
+//
+typedef void (*psf3_row_fn)(const psf3_t *psf, const UINT8 *top, const UINT8 *mid, const UINT8 *bot, UINT8 *out,
+    int col0, int col1, int step);
+
+typedef struct
+{
+    const char *name;
+    psf3_engine_fn convolve;
+    psf3_row_fn row;
+} psf3_engine_t;
+
+void psf3_init(psf3_t *psf, const double taps[9]);
+
+// Double precision, 9 taps per pixel, matches the original sharpen loops exactly
+void psf3_conv_ref(const psf3_t *psf, const UINT8 *src, UINT8 *dst, int width, int height,
+    int row0, int row1, int col0, int col1);
+
+// Q8.8 (or q_bits) fixed point, scalar
+void psf3_conv_q88(const psf3_t *psf, const UINT8 *src, UINT8 *dst, int width, int height,
+    int row0, int row1, int col0, int col1);
+
+// Q8.8 (or q_bits) fixed point, 8 pixels at a time with NEON or SSE2, scalar fixed point otherwise
+void psf3_conv_q88_simd(const psf3_t *psf, const UINT8 *src, UINT8 *dst, int width, int height,
+    int row0, int row1, int col0, int col1);
+
+// float32, 8 pixels at a time with NEON or SSE2, scalar float32 otherwise
+void psf3_conv_f32_simd(const psf3_t *psf, const UINT8 *src, UINT8 *dst, int width, int height,
+    int row0, int row1, int col0, int col1);
+
+void psf3_row_ref(const psf3_t *psf, const UINT8 *top, const UINT8 *mid, const UINT8 *bot, UINT8 *out,
+    int col0, int col1, int step);
+
+void psf3_row_q88(const psf3_t *psf, const UINT8 *top, const UINT8 *mid, const UINT8 *bot, UINT8 *out,
+    int col0, int col1, int step);
+
+void psf3_row_q88_simd(const psf3_t *psf, const UINT8 *top, const UINT8 *mid, const UINT8 *bot, UINT8 *out,
+    int col0, int col1, int step);
+
+void psf3_row_f32_simd(const psf3_t *psf, const UINT8 *top, const UINT8 *mid, const UINT8 *bot, UINT8 *out,
+    int col0, int col1, int step);
+
+// All engines, the reference first, for benchmarks and selection by name
+extern const psf3_engine_t psf3_engines[];
+extern const int psf3_num_engines;
+
+const psf3_engine_t *psf3_find_engine(const char *name);
+
+// Name of the SIMD instruction set compiled in: "neon", "sse2" or "none"
+const char *psf3_simd_name(void);
+
+// Reads the next number of a PPM header, skipping whitespace and comment lines. Returns 1, or 0 or EOF on error
+// like fscanf.
+int ppm_number(FILE *fp, int *value);
+
+#endif
@@ -11,6 +11,8 @@
 #include <fcntl.h>
 #include <time.h>
 
+#include "psflib.h"
+
 
 //#define IMG_HEIGHT (300)
 //#define IMG_WIDTH (400)
@@ -22,11 +24,15 @@
 
 #define FAST_IO
 
+// Convolve with a psflib engine, comment out for the original double precision loops
+#define PSF_ENGINE psf3_conv_q88_simd
+//#define PSF_ENGINE psf3_conv_f32_simd
+//#define PSF_ENGINE psf3_conv_ref
+
 typedef double FLOAT;
 
 typedef unsigned int UINT32;
 typedef unsigned long long int UINT64;
-typedef unsigned char UINT8;
 
 // PPM Edge Enhancement Code
 //
@@ -52,10 +58,18 @@ FLOAT PSF[9] = {-K/F, -K/F, -K/F, -K/F, K+1.0, -K/F, -K/F, -K/F, -K/F};
 
 int main(int argc, char *argv[])
 {
-    int fdin, fdout, bytesRead=0, bytesWritten=0, bytesLeft, i, j, iter, rc, pixel, readcnt=0, writecnt=0;
+    int fdin, fdout, bytesRead=0, bytesWritten=0, bytesLeft, i, iter, rc, pixel, readcnt=0, writecnt=0;
     UINT64 microsecs=0, millisecs=0;
-    FLOAT temp, fstart, fnow;
+    FLOAT fstart, fnow;
     struct timespec start, now;
+#ifdef PSF_ENGINE
+    psf3_t psf;
+
+    psf3_init(&psf, PSF);
+#else
+    int j;
+    FLOAT temp;
+#endif
 
     clock_gettime(CLOCK_MONOTONIC, &start);
     fstart = (FLOAT)start.tv_sec  + (FLOAT)start.tv_nsec / 1000000000.0;
@@ -149,6 +163,12 @@ int main(int argc, char *argv[])
         fnow = (FLOAT)now.tv_sec  + (FLOAT)now.tv_nsec / 1000000000.0;
         printf("\nstart frame %d at %lf\n", iter, fnow-fstart);
 
+#ifdef PSF_ENGINE
+        // The engines skip the first and last row and column, no neighbors to convolve with
+        PSF_ENGINE(&psf, R, convR, IMG_WIDTH, IMG_HEIGHT, 1, IMG_HEIGHT-1, 1, IMG_WIDTH-1);
+        PSF_ENGINE(&psf, G, convG, IMG_WIDTH, IMG_HEIGHT, 1, IMG_HEIGHT-1, 1, IMG_WIDTH-1);
+        PSF_ENGINE(&psf, B, convB, IMG_WIDTH, IMG_HEIGHT, 1, IMG_HEIGHT-1, 1, IMG_WIDTH-1);
+#else
         // Skip first and last row, no neighbors to convolve with
         for(i=1; i<((IMG_HEIGHT)-1); i++)
         {
@@ -199,6 +219,7 @@ int main(int argc, char *argv[])
 	        convB[(i*IMG_WIDTH)+j]=(UINT8)temp;
             }
         }
+#endif
 
         clock_gettime(CLOCK_MONOTONIC, &now);
         fnow = (FLOAT)now.tv_sec  + (FLOAT)now.tv_nsec / 1000000000.0;
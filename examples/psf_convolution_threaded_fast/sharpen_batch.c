@@ -0,0 +1,427 @@
+// Batch PSF sharpen with read, convolve and write overlapped
+//
+// Sharpens a sequence of PPM frames, such as the frames/ directory written by synchronome, in a 3 stage pipeline:
+// while frame N is convolved, frame N+1 is read and frame N-1 is written. Each stage is a thread, and the stages
+// hand frames to each other through queues over a fixed set of NUM_BUFFERS frame buffers, so a slow stage holds
+// back the others instead of letting frames pile up in memory.
+//
+// The frames are convolved as interleaved RGB with a psflib row engine, and each output keeps the header of its
+// input, including synchronome's timestamp comments.
+//
+// Usage: sharpen_batch input_dir output_dir
+//        sharpen_batch - output_dir          frames concatenated on stdin, written as frame000000.ppm and up
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "psflib.h"
+
+// Row engine from psflib, any of psf3_row_ref, psf3_row_q88, psf3_row_q88_simd or psf3_row_f32_simd
+#define PSF_ROW psf3_row_q88_simd
+
+// Frames in flight, one per stage and one spare so reading can run ahead of a slow write
+#define NUM_BUFFERS (4)
+
+#define MAX_HEADER (1024)
+#define MAX_NAME (256)
+
+typedef double FLOAT;
+
+#define K 4.0
+#define F 8.0
+//#define F 80.0
+
+FLOAT PSF[9] = {-K/F, -K/F, -K/F, -K/F, K+1.0, -K/F, -K/F, -K/F, -K/F};
+
+typedef struct
+{
+    char name[MAX_NAME];
+    UINT8 header[MAX_HEADER];
+    int header_len;
+    int width, height;
+    size_t size, capacity;
+    UINT8 *in;
+    UINT8 *out;
+} frame_t;
+
+// Blocking FIFO of frame pointers, never holds more than the NUM_BUFFERS frames and an end marker
+typedef struct
+{
+    frame_t *slot[NUM_BUFFERS + 1];
+    int head, count;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+} frameq_t;
+
+typedef struct
+{
+    const char *name;
+    FLOAT busy;
+    int frames;
+} stage_t;
+
+frame_t frames[NUM_BUFFERS];
+frameq_t freeq, readq, convq;
+stage_t reader_stage = {"read", 0.0, 0}, convolve_stage = {"convolve", 0.0, 0}, writer_stage = {"write", 0.0, 0};
+
+const char *input_path, *output_dir;
+psf3_t psf;
+double written_mpix = 0.0;
+
+
+static FLOAT now_sec(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (FLOAT)now.tv_sec + (FLOAT)now.tv_nsec / 1000000000.0;
+}
+
+
+static void frameq_init(frameq_t *q)
+{
+    q->head = 0;
+    q->count = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->ready, NULL);
+}
+
+
+static void frameq_put(frameq_t *q, frame_t *frame)
+{
+    pthread_mutex_lock(&q->lock);
+    q->slot[(q->head + q->count) % (NUM_BUFFERS + 1)] = frame;
+    q->count++;
+    pthread_cond_signal(&q->ready);
+    pthread_mutex_unlock(&q->lock);
+}
+
+
+static frame_t *frameq_get(frameq_t *q)
+{
+    frame_t *frame;
+
+    pthread_mutex_lock(&q->lock);
+    while(q->count == 0)
+        pthread_cond_wait(&q->ready, &q->lock);
+    frame = q->slot[q->head];
+    q->head = (q->head + 1) % (NUM_BUFFERS + 1);
+    q->count--;
+    pthread_mutex_unlock(&q->lock);
+
+    return frame;
+}
+
+
+// Reads one header character, keeping a copy so the output can reuse the header verbatim
+static int header_char(FILE *fp, frame_t *frame)
+{
+    int c = fgetc(fp);
+
+    if(c != EOF && frame->header_len < MAX_HEADER)
+        frame->header[frame->header_len++] = (UINT8)c;
+    return c;
+}
+
+
+static int header_number(FILE *fp, frame_t *frame, int *value)
+{
+    int c;
+
+    while((c = header_char(fp, frame)) == '#' || c == ' ' || c == '\t' || c == '\n' || c == '\r')
+    {
+        if(c == '#')
+            while((c = header_char(fp, frame)) != '\n' && c != EOF);
+    }
+
+    for(*value = 0; c >= '0' && c <= '9'; c = header_char(fp, frame))
+        *value = (*value * 10) + (c - '0');
+
+    // The single whitespace after the last number ends the header
+    return (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+}
+
+
+// Reads the next PPM from fp, returns 0 at a clean end of input and -1 on a malformed frame
+static int read_frame(FILE *fp, frame_t *frame)
+{
+    int c, maxval;
+
+    frame->header_len = 0;
+    if((c = header_char(fp, frame)) == EOF)
+        return 0;
+
+    if(c != 'P' || header_char(fp, frame) != '6' ||
+       !header_number(fp, frame, &frame->width) || !header_number(fp, frame, &frame->height) ||
+       !header_number(fp, frame, &maxval) || maxval != 255 || frame->width < 1 || frame->height < 1 ||
+       frame->header_len >= MAX_HEADER)
+        return -1;
+
+    frame->size = (size_t)frame->width * frame->height * 3;
+
+    // Buffers only grow, so a run of same size frames allocates once per buffer
+    if(frame->size > frame->capacity)
+    {
+        free(frame->in);
+        free(frame->out);
+        frame->in = malloc(frame->size);
+        frame->out = malloc(frame->size);
+        if(frame->in == NULL || frame->out == NULL)
+        {
+            printf("Error allocating %zu byte frame\n", frame->size);
+            exit(-1);
+        }
+        frame->capacity = frame->size;
+    }
+
+    if(fread(frame->in, frame->size, 1, fp) != 1)
+        return -1;
+
+    return 1;
+}
+
+
+static int is_ppm(const struct dirent *entry)
+{
+    size_t len = strlen(entry->d_name);
+
+    return (len > 4) && (strcmp(&entry->d_name[len - 4], ".ppm") == 0);
+}
+
+
+// Writes all of buf, looping over short writes
+static int write_all(int fd, const UINT8 *buf, size_t len)
+{
+    ssize_t bytesWritten;
+
+    while(len > 0)
+    {
+        if((bytesWritten = write(fd, buf, len)) <= 0)
+            return -1;
+        buf += bytesWritten;
+        len -= bytesWritten;
+    }
+    return 0;
+}
+
+
+void *reader_thread(void *threadp)
+{
+    struct dirent **names = NULL;
+    int count = 0, idx = 0, rc;
+    FILE *fp = NULL;
+    char path[2 * MAX_NAME];
+    frame_t *frame;
+    FLOAT start;
+
+    (void)threadp;
+
+    if(strcmp(input_path, "-") == 0)
+        fp = stdin;
+    else if((count = scandir(input_path, &names, is_ppm, alphasort)) < 0)
+    {
+        perror(input_path);
+        count = 0;
+    }
+
+    for(;;)
+    {
+        frame = frameq_get(&freeq);
+        start = now_sec();
+
+        if(fp == stdin)
+        {
+            snprintf(frame->name, MAX_NAME, "frame%06d.ppm", reader_stage.frames);
+            rc = read_frame(fp, frame);
+        }
+        else if(idx < count)
+        {
+            snprintf(frame->name, MAX_NAME, "%s", names[idx]->d_name);
+            snprintf(path, sizeof(path), "%s/%s", input_path, names[idx]->d_name);
+            free(names[idx++]);
+            if((fp = fopen(path, "rb")) == NULL)
+            {
+                perror(path);
+                rc = -1;
+            }
+            else
+            {
+                rc = read_frame(fp, frame);
+                fclose(fp);
+                fp = NULL;
+            }
+            if(rc == 0) rc = -1;
+        }
+        else
+            rc = 0;
+
+        reader_stage.busy += now_sec() - start;
+
+        if(rc < 0)
+        {
+            printf("%s: not an 8 bit binary PPM, skipped\n", frame->name);
+            frameq_put(&freeq, frame);
+            if(fp == stdin) break;
+            continue;
+        }
+        if(rc == 0)
+        {
+            frameq_put(&freeq, frame);
+            break;
+        }
+
+        reader_stage.frames++;
+        frameq_put(&readq, frame);
+    }
+
+    free(names);
+    frameq_put(&readq, NULL);
+    pthread_exit((void **)0);
+}
+
+
+void *convolve_thread(void *threadp)
+{
+    frame_t *frame;
+    FLOAT start;
+    size_t rowbytes;
+    int i;
+
+    (void)threadp;
+
+    while((frame = frameq_get(&readq)) != NULL)
+    {
+        start = now_sec();
+        rowbytes = (size_t)frame->width * 3;
+
+        // First and last row and column have no neighbors to convolve with and pass through
+        memcpy(frame->out, frame->in, rowbytes);
+        for(i=1; i < frame->height-1; i++)
+        {
+            const UINT8 *mid = &frame->in[i * rowbytes];
+            UINT8 *out = &frame->out[i * rowbytes];
+
+            if(frame->width < 3)
+            {
+                memcpy(out, mid, rowbytes);
+                continue;
+            }
+            memcpy(out, mid, 3);
+            memcpy(&out[rowbytes-3], &mid[rowbytes-3], 3);
+            PSF_ROW(&psf, mid - rowbytes, mid, mid + rowbytes, out, 3, rowbytes-3, 3);
+        }
+        if(frame->height > 1)
+            memcpy(&frame->out[(frame->height-1) * rowbytes], &frame->in[(frame->height-1) * rowbytes], rowbytes);
+
+        convolve_stage.busy += now_sec() - start;
+        convolve_stage.frames++;
+        frameq_put(&convq, frame);
+    }
+
+    frameq_put(&convq, NULL);
+    pthread_exit((void **)0);
+}
+
+
+void *writer_thread(void *threadp)
+{
+    frame_t *frame;
+    FLOAT start;
+    char path[2 * MAX_NAME];
+    int fdout;
+
+    (void)threadp;
+
+    while((frame = frameq_get(&convq)) != NULL)
+    {
+        start = now_sec();
+
+        snprintf(path, sizeof(path), "%s/%s", output_dir, frame->name);
+        if((fdout = open(path, (O_WRONLY | O_CREAT | O_TRUNC), 0666)) < 0)
+            perror(path);
+        else
+        {
+            if(write_all(fdout, frame->header, frame->header_len) < 0 ||
+               write_all(fdout, frame->out, frame->size) < 0)
+                perror(path);
+            close(fdout);
+        }
+
+        writer_stage.busy += now_sec() - start;
+        writer_stage.frames++;
+        written_mpix += (double)frame->width * frame->height / 1000000.0;
+        frameq_put(&freeq, frame);
+    }
+
+    pthread_exit((void **)0);
+}
+
+
+int main(int argc, char *argv[])
+{
+    pthread_t reader, convolver, writer;
+    stage_t *stages[3] = {&reader_stage, &convolve_stage, &writer_stage};
+    FLOAT fstart, elapsed;
+    int idx;
+
+    if(argc < 3)
+    {
+       printf("Usage: sharpen_batch input_dir|- output_dir\n");
+       exit(-1);
+    }
+    input_path = argv[1];
+    output_dir = argv[2];
+
+    if(mkdir(output_dir, 0777) < 0 && errno != EEXIST)
+    {
+        perror(output_dir);
+        exit(-1);
+    }
+
+    psf3_init(&psf, PSF);
+
+    frameq_init(&freeq);
+    frameq_init(&readq);
+    frameq_init(&convq);
+    for(idx=0; idx < NUM_BUFFERS; idx++)
+        frameq_put(&freeq, &frames[idx]);
+
+    fstart = now_sec();
+
+    pthread_create(&reader, (void *)0, reader_thread, (void *)0);
+    pthread_create(&convolver, (void *)0, convolve_thread, (void *)0);
+    pthread_create(&writer, (void *)0, writer_thread, (void *)0);
+
+    pthread_join(reader, (void **)0);
+    pthread_join(convolver, (void **)0);
+    pthread_join(writer, (void **)0);
+
+    elapsed = now_sec() - fstart;
+
+    for(idx=0; idx < NUM_BUFFERS; idx++)
+    {
+        free(frames[idx].in);
+        free(frames[idx].out);
+    }
+
+    printf("%d frames in %lf sec, %lf frames/sec and %lf MPix/sec sustained\n", writer_stage.frames, elapsed,
+           writer_stage.frames / elapsed, written_mpix / elapsed);
+    printf("%-10s %10s %12s %12s\n", "stage", "busy sec", "ms/frame", "utilization");
+    for(idx=0; idx < 3; idx++)
+    {
+        printf("%-10s %10.3lf %12.3lf %11.1lf%%\n", stages[idx]->name, stages[idx]->busy,
+               stages[idx]->frames ? 1000.0 * stages[idx]->busy / stages[idx]->frames : 0.0,
+               100.0 * stages[idx]->busy / elapsed);
+    }
+
+    return 0;
+}
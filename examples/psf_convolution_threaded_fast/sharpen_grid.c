@@ -7,6 +7,9 @@
 #include <sched.h>
 #include <time.h>
 
+#include "psflib.h"
+#include "tilepool.h"
+
 
 #define IMG_HEIGHT (3000)
 #define IMG_WIDTH (4000)
@@ -14,45 +17,31 @@
 //#define IMG_HEIGHT (300)
 //#define IMG_WIDTH (400)
 
-#define NUM_ROW_THREADS (3)
-#define NUM_COL_THREADS (4)
+// Worker threads, 0 for one per online CPU
+#define NUM_THREADS (0)
 
-//#define NUM_ROW_THREADS (6)
-//#define NUM_COL_THREADS (8)
+// Tile size, 0 rows to size tiles to half the L2 cache
+#define TILE_ROWS (0)
+#define TILE_COLS (512)
 
-//#define NUM_ROW_THREADS (12)
-//#define NUM_COL_THREADS (16)
+// Bytes of working set per pixel, 3 channels in and 3 out
+#define TILE_BYTES_PER_PIXEL (6)
 
-#define IMG_H_SLICE (IMG_HEIGHT/NUM_ROW_THREADS)
-#define IMG_W_SLICE (IMG_WIDTH/NUM_COL_THREADS)
+//#define PIN_THREADS
 
 #define ITERATIONS (3)
-#define CREATE_ITERATIONS (1)
 
 #define FAST_IO
 
-typedef double FLOAT;
-
-pthread_t threads[NUM_ROW_THREADS*NUM_COL_THREADS];
+// Convolve with a psflib engine, comment out for the original double precision loops
+#define PSF_ENGINE psf3_conv_q88_simd
+//#define PSF_ENGINE psf3_conv_f32_simd
+//#define PSF_ENGINE psf3_conv_ref
 
-typedef struct _threadArgs
-{
-    int thread_idx;
-    int i;
-    int j;
-    int h;
-    int w;
-    int iterations;
-} threadArgsType;
-
-threadArgsType threadarg[NUM_ROW_THREADS*NUM_COL_THREADS];
-pthread_attr_t fifo_sched_attr;
-pthread_attr_t orig_sched_attr;
-struct sched_param fifo_param;
+typedef double FLOAT;
 
 typedef unsigned int UINT32;
 typedef unsigned long long int UINT64;
-typedef unsigned char UINT8;
 
 // PPM Edge Enhancement Code in row x column format
 UINT8 header[22];
@@ -73,82 +62,93 @@ UINT8 RGB[IMG_HEIGHT*IMG_WIDTH*3];
 
 FLOAT PSF[9] = {-K/F, -K/F, -K/F, -K/F, K+1.0, -K/F, -K/F, -K/F, -K/F};
 
+#ifdef PSF_ENGINE
+psf3_t psf;
+#endif
+
+tile_grid_t grid;
+
 
-void *sharpen_thread(void *threadptr)
+// Sharpen one tile of all three channels, called by the pool workers
+void sharpen_tile(void *arg, int tile)
 {
-    threadArgsType thargs=*((threadArgsType *)threadptr);
-    int i=thargs.i;
-    int j=thargs.j;
-    int repeat=0;
-    FLOAT temp=0;
+    int row0, row1, col0, col1;
+
+    (void)arg;
+    tile_grid_rect(&grid, tile, &row0, &row1, &col0, &col1);
 
-    //printf("i=%d, j=%d, h=%d, w=%d, iter=%d\n", thargs.i, thargs.j, thargs.h, thargs.w, thargs.iterations);
+#ifdef PSF_ENGINE
+    PSF_ENGINE(&psf, &R[0][0], &convR[0][0], IMG_WIDTH, IMG_HEIGHT, row0, row1, col0, col1);
+    PSF_ENGINE(&psf, &G[0][0], &convG[0][0], IMG_WIDTH, IMG_HEIGHT, row0, row1, col0, col1);
+    PSF_ENGINE(&psf, &B[0][0], &convB[0][0], IMG_WIDTH, IMG_HEIGHT, row0, row1, col0, col1);
+#else
+    int i, j;
+    FLOAT temp=0;
 
-    for(repeat=0; repeat < thargs.iterations; repeat++)
+    for(i=row0; i<row1; i++)
     {
-        for(i=thargs.i; i<(thargs.i+thargs.h); i++)
+        for(j=col0; j<col1; j++)
         {
-            for(j=thargs.j; j<(thargs.j+thargs.w); j++)
-            {
-                temp=0;
-                temp += (PSF[0] * (FLOAT)R[(i-1)][j-1]);
-                temp += (PSF[1] * (FLOAT)R[(i-1)][j]);
-                temp += (PSF[2] * (FLOAT)R[(i-1)][j+1]);
-                temp += (PSF[3] * (FLOAT)R[(i)][j-1]);
-                temp += (PSF[4] * (FLOAT)R[(i)][j]);
-                temp += (PSF[5] * (FLOAT)R[(i)][j+1]);
-                temp += (PSF[6] * (FLOAT)R[(i+1)][j-1]);
-                temp += (PSF[7] * (FLOAT)R[(i+1)][j]);
-                temp += (PSF[8] * (FLOAT)R[(i+1)][j+1]);
-    	        if(temp<0.0) temp=0.0;
-    	        if(temp>255.0) temp=255.0;
-    	        convR[i][j]=(UINT8)temp;
-
-                temp=0;
-                temp += (PSF[0] * (FLOAT)G[(i-1)][j-1]);
-                temp += (PSF[1] * (FLOAT)G[(i-1)][j]);
-                temp += (PSF[2] * (FLOAT)G[(i-1)][j+1]);
-                temp += (PSF[3] * (FLOAT)G[(i)][j-1]);
-                temp += (PSF[4] * (FLOAT)G[(i)][j]);
-                temp += (PSF[5] * (FLOAT)G[(i)][j+1]);
-                temp += (PSF[6] * (FLOAT)G[(i+1)][j-1]);
-                temp += (PSF[7] * (FLOAT)G[(i+1)][j]);
-                temp += (PSF[8] * (FLOAT)G[(i+1)][j+1]);
-    	        if(temp<0.0) temp=0.0;
-    	        if(temp>255.0) temp=255.0;
-    	        convG[i][j]=(UINT8)temp;
-
-                temp=0;
-                temp += (PSF[0] * (FLOAT)B[(i-1)][j-1]);
-                temp += (PSF[1] * (FLOAT)B[(i-1)][j]);
-                temp += (PSF[2] * (FLOAT)B[(i-1)][j+1]);
-                temp += (PSF[3] * (FLOAT)B[(i)][j-1]);
-                temp += (PSF[4] * (FLOAT)B[(i)][j]);
-                temp += (PSF[5] * (FLOAT)B[(i)][j+1]);
-                temp += (PSF[6] * (FLOAT)B[(i+1)][j-1]);
-                temp += (PSF[7] * (FLOAT)B[(i+1)][j]);
-                temp += (PSF[8] * (FLOAT)B[(i+1)][j+1]);
-    	        if(temp<0.0) temp=0.0;
-    	        if(temp>255.0) temp=255.0;
-    	        convB[i][j]=(UINT8)temp;
-            }
+            temp=0;
+            temp += (PSF[0] * (FLOAT)R[(i-1)][j-1]);
+            temp += (PSF[1] * (FLOAT)R[(i-1)][j]);
+            temp += (PSF[2] * (FLOAT)R[(i-1)][j+1]);
+            temp += (PSF[3] * (FLOAT)R[(i)][j-1]);
+            temp += (PSF[4] * (FLOAT)R[(i)][j]);
+            temp += (PSF[5] * (FLOAT)R[(i)][j+1]);
+            temp += (PSF[6] * (FLOAT)R[(i+1)][j-1]);
+            temp += (PSF[7] * (FLOAT)R[(i+1)][j]);
+            temp += (PSF[8] * (FLOAT)R[(i+1)][j+1]);
+	        if(temp<0.0) temp=0.0;
+	        if(temp>255.0) temp=255.0;
+	        convR[i][j]=(UINT8)temp;
+
+            temp=0;
+            temp += (PSF[0] * (FLOAT)G[(i-1)][j-1]);
+            temp += (PSF[1] * (FLOAT)G[(i-1)][j]);
+            temp += (PSF[2] * (FLOAT)G[(i-1)][j+1]);
+            temp += (PSF[3] * (FLOAT)G[(i)][j-1]);
+            temp += (PSF[4] * (FLOAT)G[(i)][j]);
+            temp += (PSF[5] * (FLOAT)G[(i)][j+1]);
+            temp += (PSF[6] * (FLOAT)G[(i+1)][j-1]);
+            temp += (PSF[7] * (FLOAT)G[(i+1)][j]);
+            temp += (PSF[8] * (FLOAT)G[(i+1)][j+1]);
+	        if(temp<0.0) temp=0.0;
+	        if(temp>255.0) temp=255.0;
+	        convG[i][j]=(UINT8)temp;
+
+            temp=0;
+            temp += (PSF[0] * (FLOAT)B[(i-1)][j-1]);
+            temp += (PSF[1] * (FLOAT)B[(i-1)][j]);
+            temp += (PSF[2] * (FLOAT)B[(i-1)][j+1]);
+            temp += (PSF[3] * (FLOAT)B[(i)][j-1]);
+            temp += (PSF[4] * (FLOAT)B[(i)][j]);
+            temp += (PSF[5] * (FLOAT)B[(i)][j+1]);
+            temp += (PSF[6] * (FLOAT)B[(i+1)][j-1]);
+            temp += (PSF[7] * (FLOAT)B[(i+1)][j]);
+            temp += (PSF[8] * (FLOAT)B[(i+1)][j+1]);
+	        if(temp<0.0) temp=0.0;
+	        if(temp>255.0) temp=255.0;
+	        convB[i][j]=(UINT8)temp;
         }
-        //printf("thread-%d %d ", thargs.thread_idx, repeat);
     }
-
-    pthread_exit((void **)0);
+#endif
 }
 
 
 int main(int argc, char *argv[])
 {
-    int fdin, fdout, bytesRead=0, bytesWritten=0, bytesLeft, i, j, idx, jdx, pixel, readcnt, writecnt;
+    int fdin, fdout, bytesRead=0, bytesWritten=0, bytesLeft, i, j, pixel, readcnt, writecnt;
     UINT64 microsecs=0, millisecs=0;
-    unsigned int thread_idx;
     FLOAT temp, fnow, fstart;
     int runs=0, rc;
+    int threads=NUM_THREADS, tile_rows=TILE_ROWS, tile_cols=TILE_COLS, pinned=0;
     struct timespec now, start;
+    tilepool_t *pool;
 
+#ifdef PSF_ENGINE
+    psf3_init(&psf, PSF);
+#endif
     clock_gettime(CLOCK_MONOTONIC, &start);
     clock_gettime(CLOCK_MONOTONIC, &now);
     fstart = (FLOAT)start.tv_sec + (FLOAT)start.tv_nsec / 1000000000.0;
@@ -157,7 +157,7 @@ int main(int argc, char *argv[])
     
     if(argc < 3)
     {
-       printf("Usage: sharpen input_file.ppm output_file.ppm\n");
+       printf("Usage: sharpen_grid input_file.ppm output_file.ppm [threads [tile_rows tile_cols]]\n");
        exit(-1);
     }
     else
@@ -177,6 +177,25 @@ int main(int argc, char *argv[])
         //    printf("Output file=%s opened successfully\n", "sharpen.ppm");
     }
 
+    if(argc > 3) threads=atoi(argv[3]);
+    if(argc > 5) {tile_rows=atoi(argv[4]); tile_cols=atoi(argv[5]);}
+#ifdef PIN_THREADS
+    pinned=1;
+#endif
+    if(tile_rows <= 0)
+        tile_rows=tile_rows_for_cache(tilepool_l2_bytes()/2, tile_cols, TILE_BYTES_PER_PIXEL);
+
+    // Skip first and last row and column, no neighbors to convolve with
+    tile_grid_init(&grid, 1, IMG_HEIGHT-1, 1, IMG_WIDTH-1, tile_rows, tile_cols);
+
+    if((pool=tilepool_create(threads, pinned)) == NULL)
+    {
+        printf("Error creating thread pool\n");
+        exit(-1);
+    }
+    printf("%d threads%s, %d tiles of %d x %d\n", tilepool_threads(pool), pinned ? " pinned" : "",
+           tile_grid_count(&grid), tile_rows, tile_cols);
+
     bytesLeft=21;
 
     //printf("Reading header\n");
@@ -256,56 +275,14 @@ int main(int argc, char *argv[])
     fnow = (FLOAT)now.tv_sec + (FLOAT)now.tv_nsec / 1000000000.0;
     printf("\nstart PSF frame test at %lf\n", fnow - fstart);
 
-    for(runs=0; runs < CREATE_ITERATIONS; runs++)
-    {
-
-        for(thread_idx=0; thread_idx<(NUM_ROW_THREADS*NUM_COL_THREADS); thread_idx++)
-        {
-
-            // hard coded for 4 x 3 threads, could generalize to any 4:3 aspect ratio
-            if(thread_idx == 0) {idx=1; jdx=1;}
-            if(thread_idx == 1) {idx=1; jdx=(thread_idx*(IMG_W_SLICE-1));}
-            if(thread_idx == 2) {idx=1; jdx=(thread_idx*(IMG_W_SLICE-1));}
-            if(thread_idx == 3) {idx=1; jdx=(thread_idx*(IMG_W_SLICE-1));}
-
-            if(thread_idx == 4) {idx=IMG_H_SLICE; jdx=(thread_idx*(IMG_W_SLICE-1));}
-            if(thread_idx == 5) {idx=IMG_H_SLICE; jdx=(thread_idx*(IMG_W_SLICE-1));}
-            if(thread_idx == 6) {idx=IMG_H_SLICE; jdx=(thread_idx*(IMG_W_SLICE-1));}
-            if(thread_idx == 7) {idx=IMG_H_SLICE; jdx=(thread_idx*(IMG_W_SLICE-1));}
-
-            if(thread_idx == 8) {idx=(2*(IMG_H_SLICE-1)); jdx=(thread_idx*(IMG_W_SLICE-1));}
-            if(thread_idx == 9) {idx=(2*(IMG_H_SLICE-1)); jdx=(thread_idx*(IMG_W_SLICE-1));}
-            if(thread_idx == 10) {idx=(2*(IMG_H_SLICE-1)); jdx=(thread_idx*(IMG_W_SLICE-1));}
-            if(thread_idx == 11) {idx=(2*(IMG_H_SLICE-1)); jdx=(thread_idx*(IMG_W_SLICE-1));}
-
-            //printf("idx=%d, jdx=%d\n", idx, jdx);
-
-            threadarg[thread_idx].i=idx;      
-            threadarg[thread_idx].h=IMG_H_SLICE-1;        
-            threadarg[thread_idx].j=jdx;        
-            threadarg[thread_idx].w=IMG_W_SLICE-1;
-
-            threadarg[thread_idx].iterations=ITERATIONS;
-
-            //printf("create thread_idx=%d\n", thread_idx);    
-            pthread_create(&threads[thread_idx], (void *)0, sharpen_thread, (void *)&threadarg[thread_idx]);
-
-        }
-
-        for(thread_idx=0; thread_idx<(NUM_ROW_THREADS*NUM_COL_THREADS); thread_idx++)
-        {
-            printf("join thread_idx=%d\n", thread_idx);    
-            if((pthread_join(threads[thread_idx], (void **)0)) < 0)
-                perror("pthread_join");
-        }
-
-        printf("create run=%d ", runs);
-
-    }
+    // One persistent pool for all frames, each frame is one pass over the tiles of the interior
+    for(runs=0; runs < ITERATIONS; runs++)
+        tilepool_run(pool, sharpen_tile, (void *)0, tile_grid_count(&grid));
 
     clock_gettime(CLOCK_MONOTONIC, &now);
     fnow = (FLOAT)now.tv_sec + (FLOAT)now.tv_nsec / 1000000000.0;
-    printf("\n******* Completed frame processing at %lf for %d creat-to-join and %lf FPS\n\n", fnow - fstart, runs, (FLOAT)ITERATIONS/(fnow-fstart));
+    printf("\n******* Completed frame processing at %lf for %d frames and %lf FPS, %lu tile ranges stolen\n\n", fnow - fstart, runs, (FLOAT)ITERATIONS/(fnow-fstart), tilepool_steals(pool));
+    tilepool_destroy(pool);
 
     printf("Starting output file %s write\n", argv[2]);
     rc=write(fdout, (void *)header, 21);
@@ -369,7 +346,7 @@ int main(int argc, char *argv[])
 
     clock_gettime(CLOCK_MONOTONIC, &now);
     fnow = (FLOAT)now.tv_sec + (FLOAT)now.tv_nsec / 1000000000.0;
-    printf("\n******* DONE at %lf for %d creat-to-join and %lf FPS\n\n", fnow - fstart, runs, (FLOAT)ITERATIONS/(fnow-fstart));
+    printf("\n******* DONE at %lf for %d frames and %lf FPS\n\n", fnow - fstart, runs, (FLOAT)ITERATIONS/(fnow-fstart));
     printf("Output file %s written\n", argv[2]);
     close(fdout);
  
@@ -0,0 +1,173 @@
+// Tiled sharpen scaling report
+//
+// Sharpens a synthetic planar RGB frame with the tile pool for 1 to N threads, several tile shapes and with
+// threads pinned and unpinned. Each run is checked against one whole-frame pass of the same engine, so a tile
+// grid that misses or double counts pixels shows up as a mismatch.
+//
+// Usage: sharpen_scale [-t max_threads] [-w width -h height] [-i iterations] [-e engine]
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "psflib.h"
+#include "tilepool.h"
+
+#define DEFAULT_WIDTH (4000)
+#define DEFAULT_HEIGHT (3000)
+#define DEFAULT_ITERATIONS (10)
+
+#define TILE_BYTES_PER_PIXEL (6)
+
+#define K 4.0
+#define F 8.0
+
+double PSF[9] = {-K/F, -K/F, -K/F, -K/F, K+1.0, -K/F, -K/F, -K/F, -K/F};
+
+typedef struct
+{
+    const psf3_engine_t *engine;
+    psf3_t psf;
+    int width, height;
+    UINT8 *src[3];
+    UINT8 *dst[3];
+    tile_grid_t grid;
+} frame_t;
+
+
+static double now_sec(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000.0;
+}
+
+
+static void sharpen_tile(void *arg, int tile)
+{
+    frame_t *frame = (frame_t *)arg;
+    int row0, row1, col0, col1, chan;
+
+    tile_grid_rect(&frame->grid, tile, &row0, &row1, &col0, &col1);
+    for(chan=0; chan < 3; chan++)
+        frame->engine->convolve(&frame->psf, frame->src[chan], frame->dst[chan], frame->width, frame->height,
+                                row0, row1, col0, col1);
+}
+
+
+int main(int argc, char *argv[])
+{
+    int width = DEFAULT_WIDTH, height = DEFAULT_HEIGHT, iterations = DEFAULT_ITERATIONS;
+    int max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *engine_name = "q88_simd";
+    int opt, chan, threads, shape, pinned, iter, ok;
+    size_t pixels, i;
+    long l2 = tilepool_l2_bytes();
+    UINT8 *expect[3];
+    double start, elapsed, single = 0.0;
+    frame_t frame;
+
+    while((opt = getopt(argc, argv, "t:w:h:i:e:")) != -1)
+    {
+        switch(opt)
+        {
+            case 't': max_threads = atoi(optarg); break;
+            case 'w': width = atoi(optarg); break;
+            case 'h': height = atoi(optarg); break;
+            case 'i': iterations = atoi(optarg); break;
+            case 'e': engine_name = optarg; break;
+            default:
+                printf("Usage: sharpen_scale [-t max_threads] [-w width -h height] [-i iterations] [-e engine]\n");
+                exit(-1);
+        }
+    }
+
+    if((frame.engine = psf3_find_engine(engine_name)) == NULL || width < 3 || height < 3 || iterations < 1)
+    {
+        printf("bad arguments\n");
+        exit(-1);
+    }
+
+    // Tile shapes as rows x columns, 0 rows sizes the tile to half the L2 cache
+    int shapes[][2] = {{64, 64}, {128, 256}, {0, 512}, {0, width}};
+    int num_shapes = sizeof(shapes) / sizeof(shapes[0]);
+
+    psf3_init(&frame.psf, PSF);
+    frame.width = width;
+    frame.height = height;
+    pixels = (size_t)width * height;
+
+    srand(1);
+    for(chan=0; chan < 3; chan++)
+    {
+        frame.src[chan] = malloc(pixels);
+        frame.dst[chan] = malloc(pixels);
+        expect[chan] = malloc(pixels);
+        for(i=0; i < pixels; i++)
+            frame.src[chan][i] = (UINT8)(((i / 64) & 1) ? 200 : 40) + (rand() % 32);
+        memcpy(expect[chan], frame.src[chan], pixels);
+        frame.engine->convolve(&frame.psf, frame.src[chan], expect[chan], width, height, 0, height, 0, width);
+    }
+
+    printf("%dx%d, engine %s, L2 %ld KB, %d iterations\n", width, height, frame.engine->name, l2 / 1024, iterations);
+    printf("%7s %11s %7s %10s %10s %8s %7s %s\n", "threads", "tile", "pinned", "ms/frame", "MPix/s", "speedup",
+           "steals", "check");
+
+    for(shape=0; shape < num_shapes; shape++)
+    {
+        int tile_cols = shapes[shape][1];
+        int tile_rows = shapes[shape][0] ? shapes[shape][0] : tile_rows_for_cache(l2 / 2, tile_cols, TILE_BYTES_PER_PIXEL);
+
+        tile_grid_init(&frame.grid, 1, height-1, 1, width-1, tile_rows, tile_cols);
+
+        for(pinned=0; pinned <= 1; pinned++)
+        {
+            for(threads=1; threads <= max_threads; threads++)
+            {
+                tilepool_t *pool = tilepool_create(threads, pinned);
+                char tile[32];
+
+                if(pool == NULL)
+                {
+                    printf("Error creating thread pool\n");
+                    exit(-1);
+                }
+
+                for(chan=0; chan < 3; chan++)
+                    memcpy(frame.dst[chan], frame.src[chan], pixels);
+
+                // First frame warms the caches and the workers
+                tilepool_run(pool, sharpen_tile, &frame, tile_grid_count(&frame.grid));
+
+                start = now_sec();
+                for(iter=0; iter < iterations; iter++)
+                    tilepool_run(pool, sharpen_tile, &frame, tile_grid_count(&frame.grid));
+                elapsed = (now_sec() - start) / iterations;
+
+                for(chan=0, ok=1; chan < 3; chan++)
+                    ok = ok && (memcmp(frame.dst[chan], expect[chan], pixels) == 0);
+
+                if(threads == 1)
+                    single = elapsed;
+
+                snprintf(tile, sizeof(tile), "%dx%d", tile_rows, tile_cols);
+                printf("%7d %11s %7s %10.3lf %10.1lf %8.2lf %7lu %s\n", threads, tile, pinned ? "yes" : "no",
+                       elapsed * 1000.0, 3.0 * (width-2) * (height-2) / elapsed / 1000000.0, single / elapsed,
+                       tilepool_steals(pool), ok ? "ok" : "MISMATCH");
+
+                tilepool_destroy(pool);
+            }
+        }
+    }
+
+    for(chan=0; chan < 3; chan++)
+    {
+        free(frame.src[chan]);
+        free(frame.dst[chan]);
+        free(expect[chan]);
+    }
+    return 0;
+}
@@ -0,0 +1,228 @@
+// Streaming PSF sharpen on interleaved RGB
+//
+// The planar sharpen programs split the PPM into R, G and B planes, convolve into three more planes and then
+// merge them back into an RGB buffer before writing, 7 full frames of memory and two extra passes over them.
+// This version convolves the interleaved pixels directly, with horizontal neighbors 3 bytes apart, and streams:
+// each output row needs only the input rows above, at and below it, and is written as soon as a small batch of
+// rows is complete.
+//
+// A regular input file is mapped with mmap and read in place, with the pages behind the window dropped as it
+// moves down the image. Any other input, such as a pipe on stdin, is read a row at a time into a 3 row window.
+//
+// Usage: sharpen_stream input_file.ppm output_file.ppm, either may be - for stdin or stdout
+//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "psflib.h"
+
+// Row engine from psflib, any of psf3_row_ref, psf3_row_q88, psf3_row_q88_simd or psf3_row_f32_simd
+#define PSF_ROW psf3_row_q88_simd
+
+// Output rows buffered per write
+#define OUT_ROWS (8)
+
+// Rows between dropping the mapped input pages already consumed
+#define DROP_ROWS (256)
+
+typedef double FLOAT;
+
+#define K 4.0
+#define F 8.0
+//#define F 80.0
+
+FLOAT PSF[9] = {-K/F, -K/F, -K/F, -K/F, K+1.0, -K/F, -K/F, -K/F, -K/F};
+
+
+static int write_all(int fd, const UINT8 *buf, size_t len, int *writecnt)
+{
+    ssize_t bytesWritten;
+
+    while(len > 0)
+    {
+        if((bytesWritten = write(fd, buf, len)) <= 0)
+            return -1;
+        buf += bytesWritten;
+        len -= bytesWritten;
+        (*writecnt)++;
+    }
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    FILE *in;
+    int fdout, width, height, maxval, i, writecnt=0, out_rows=0;
+    size_t rowbytes, header_len=0, map_len=0, dropped=0;
+    UINT8 *map=NULL, *window=NULL, *outbuf, *rows[3], *out;
+    char header[64];
+    struct stat st;
+    struct rusage usage;
+    struct timespec start, now;
+    FLOAT fstart, fnow;
+    psf3_t psf;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    fstart = (FLOAT)start.tv_sec + (FLOAT)start.tv_nsec / 1000000000.0;
+
+    if(argc < 3)
+    {
+       printf("Usage: sharpen_stream input_file.ppm output_file.ppm\n");
+       exit(-1);
+    }
+
+    in = (strcmp(argv[1], "-") == 0) ? stdin : fopen(argv[1], "rb");
+    if(in == NULL)
+    {
+        printf("Error opening %s\n", argv[1]);
+        exit(-1);
+    }
+
+    fdout = (strcmp(argv[2], "-") == 0) ? STDOUT_FILENO : open(argv[2], (O_WRONLY | O_CREAT | O_TRUNC), 0666);
+    if(fdout < 0)
+    {
+        printf("Error opening %s\n", argv[2]);
+        exit(-1);
+    }
+
+    if(fgetc(in) != 'P' || fgetc(in) != '6' ||
+       ppm_number(in, &width) != 1 || ppm_number(in, &height) != 1 || ppm_number(in, &maxval) != 1 ||
+       maxval != 255 || width < 1 || height < 1)
+    {
+        printf("%s: not an 8 bit binary PPM\n", argv[1]);
+        exit(-1);
+    }
+    fgetc(in);
+
+    rowbytes = (size_t)width * 3;
+    psf3_init(&psf, PSF);
+
+    // Map a regular file in place, the header length is where the stdio reader stopped
+    if(fstat(fileno(in), &st) == 0 && S_ISREG(st.st_mode))
+    {
+        header_len = ftell(in);
+        map_len = header_len + rowbytes * height;
+        if((size_t)st.st_size < map_len)
+        {
+            printf("%s: short file\n", argv[1]);
+            exit(-1);
+        }
+        map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+        if(map == MAP_FAILED)
+            map = NULL;
+        else
+            madvise(map, map_len, MADV_SEQUENTIAL);
+    }
+
+    if(map == NULL)
+    {
+        window = malloc(3 * rowbytes);
+        if(window == NULL)
+        {
+            printf("Error allocating row window\n");
+            exit(-1);
+        }
+    }
+
+    outbuf = malloc(OUT_ROWS * rowbytes);
+    if(outbuf == NULL)
+    {
+        printf("Error allocating output rows\n");
+        exit(-1);
+    }
+
+    snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+    if(write_all(fdout, (UINT8 *)header, strlen(header), &writecnt) < 0)
+    {
+        perror("write");
+        exit(-1);
+    }
+
+    for(i=0; i < height; i++)
+    {
+        // Rows i-1, i and i+1, clamped at the top and bottom edges where they are not used
+        if(map)
+        {
+            rows[1] = &map[header_len + i * rowbytes];
+            rows[0] = (i > 0) ? rows[1] - rowbytes : rows[1];
+            rows[2] = (i < height-1) ? rows[1] + rowbytes : rows[1];
+
+            if(i - dropped >= DROP_ROWS + 2)
+            {
+                // Drop whole pages before row i-1, they will not be read again
+                size_t end = (header_len + (i - 1) * rowbytes) & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+                madvise(map, end, MADV_DONTNEED);
+                dropped = i;
+            }
+        }
+        else
+        {
+            if(i == 0 && fread(&window[0], rowbytes, 1, in) != 1)
+            {
+                printf("%s: short read\n", argv[1]);
+                exit(-1);
+            }
+            if(i < height-1 && fread(&window[((i + 1) % 3) * rowbytes], rowbytes, 1, in) != 1)
+            {
+                printf("%s: short read\n", argv[1]);
+                exit(-1);
+            }
+            rows[1] = &window[(i % 3) * rowbytes];
+            rows[0] = (i > 0) ? &window[((i + 2) % 3) * rowbytes] : rows[1];
+            rows[2] = (i < height-1) ? &window[((i + 1) % 3) * rowbytes] : rows[1];
+        }
+
+        out = &outbuf[out_rows * rowbytes];
+
+        // First and last row and column have no neighbors to convolve with and pass through
+        if(i == 0 || i == height-1 || width < 3)
+        {
+            memcpy(out, rows[1], rowbytes);
+        }
+        else
+        {
+            memcpy(out, rows[1], 3);
+            memcpy(&out[rowbytes-3], &rows[1][rowbytes-3], 3);
+            PSF_ROW(&psf, rows[0], rows[1], rows[2], out, 3, rowbytes-3, 3);
+        }
+
+        if(++out_rows == OUT_ROWS || i == height-1)
+        {
+            if(write_all(fdout, outbuf, out_rows * rowbytes, &writecnt) < 0)
+            {
+                perror("write");
+                exit(-1);
+            }
+            out_rows = 0;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    fnow = (FLOAT)now.tv_sec + (FLOAT)now.tv_nsec / 1000000000.0;
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(stderr, "%dx%d %s, %d writes, %lf sec, %lf MPix/s, max RSS %ld KB, row buffers %zu KB\n",
+            width, height, map ? "mapped" : "streamed", writecnt, fnow - fstart,
+            (FLOAT)width * height / (fnow - fstart) / 1000000.0, usage.ru_maxrss,
+            ((map ? 0 : 3) + OUT_ROWS) * rowbytes / 1024);
+
+    if(map)
+        munmap(map, map_len);
+    free(window);
+    free(outbuf);
+    if(in != stdin)
+        fclose(in);
+    if(fdout != STDOUT_FILENO)
+        close(fdout);
+
+    return 0;
+}
@@ -0,0 +1,294 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "tilepool.h"
+
+#define DEFAULT_L2_BYTES (512*1024)
+
+// The range of tiles a worker has left, [head, tail) packed in one word so the owner taking from the head and
+// thieves taking from the tail can not both get the last tile.
+#define RANGE(head, tail) (((uint64_t)(tail) << 32) | (uint32_t)(head))
+#define HEAD(range) ((int)(uint32_t)(range))
+#define TAIL(range) ((int)((range) >> 32))
+
+struct worker
+{
+    _Alignas(64) _Atomic uint64_t range;
+    unsigned long steals;
+    int idx;
+    pthread_t thread;
+    tilepool_t *pool;
+};
+
+struct tilepool
+{
+    int nthreads;
+    int pinned;
+    struct worker *workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned generation;
+    int busy;
+    int quit;
+
+    tile_fn fn;
+    void *arg;
+};
+
+
+// Take the next tile of our own range, -1 when it is empty
+static int take(struct worker *w)
+{
+    uint64_t range = atomic_load(&w->range);
+
+    while(HEAD(range) < TAIL(range))
+    {
+        if(atomic_compare_exchange_weak(&w->range, &range, RANGE(HEAD(range) + 1, TAIL(range))))
+            return HEAD(range);
+    }
+    return -1;
+}
+
+
+// Move the upper half of the first non-empty range of another worker into ours, 0 when all are empty
+static int steal(struct worker *w)
+{
+    tilepool_t *pool = w->pool;
+    int n;
+
+    for(n=1; n < pool->nthreads; n++)
+    {
+        struct worker *victim = &pool->workers[(w->idx + n) % pool->nthreads];
+        uint64_t range = atomic_load(&victim->range);
+
+        while(HEAD(range) < TAIL(range))
+        {
+            int count = (TAIL(range) - HEAD(range) + 1) / 2;
+            int split = TAIL(range) - count;
+
+            if(atomic_compare_exchange_weak(&victim->range, &range, RANGE(HEAD(range), split)))
+            {
+                // Our range is empty so no thief is updating it
+                atomic_store(&w->range, RANGE(split, split + count));
+                w->steals++;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+
+static void *worker_thread(void *threadptr)
+{
+    struct worker *w = (struct worker *)threadptr;
+    tilepool_t *pool = w->pool;
+    unsigned seen = 0;
+    int tile;
+
+    if(pool->pinned)
+    {
+        cpu_set_t cpuset;
+
+        CPU_ZERO(&cpuset);
+        CPU_SET(w->idx % sysconf(_SC_NPROCESSORS_ONLN), &cpuset);
+        if(pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0)
+            perror("pthread_setaffinity_np");
+    }
+
+    for(;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while(pool->generation == seen && !pool->quit)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if(pool->quit)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        do
+        {
+            while((tile = take(w)) >= 0)
+                pool->fn(pool->arg, tile);
+        } while(steal(w));
+
+        pthread_mutex_lock(&pool->lock);
+        if(--pool->busy == 0)
+            pthread_cond_signal(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return (void *)0;
+}
+
+
+tilepool_t *tilepool_create(int nthreads, int pinned)
+{
+    tilepool_t *pool;
+    int idx;
+
+    if(nthreads <= 0)
+        nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if((pool = calloc(1, sizeof(tilepool_t))) == NULL)
+        return NULL;
+    if((pool->workers = aligned_alloc(64, nthreads * sizeof(struct worker))) == NULL)
+    {
+        free(pool);
+        return NULL;
+    }
+
+    pool->nthreads = nthreads;
+    pool->pinned = pinned;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for(idx=0; idx < nthreads; idx++)
+    {
+        struct worker *w = &pool->workers[idx];
+
+        atomic_init(&w->range, RANGE(0, 0));
+        w->steals = 0;
+        w->idx = idx;
+        w->pool = pool;
+        if(pthread_create(&w->thread, NULL, worker_thread, w) != 0)
+        {
+            perror("pthread_create");
+            pool->nthreads = idx;
+            tilepool_destroy(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+
+void tilepool_run(tilepool_t *pool, tile_fn fn, void *arg, int ntiles)
+{
+    int idx;
+
+    pthread_mutex_lock(&pool->lock);
+
+    pool->fn = fn;
+    pool->arg = arg;
+    for(idx=0; idx < pool->nthreads; idx++)
+    {
+        int head = (int)(((long)ntiles * idx) / pool->nthreads);
+        int tail = (int)(((long)ntiles * (idx + 1)) / pool->nthreads);
+
+        atomic_store(&pool->workers[idx].range, RANGE(head, tail));
+    }
+
+    pool->busy = pool->nthreads;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+
+    while(pool->busy > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+
+void tilepool_destroy(tilepool_t *pool)
+{
+    int idx;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(idx=0; idx < pool->nthreads; idx++)
+    {
+        if(pthread_join(pool->workers[idx].thread, (void **)0) != 0)
+            perror("pthread_join");
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+
+int tilepool_threads(const tilepool_t *pool)
+{
+    return pool->nthreads;
+}
+
+
+unsigned long tilepool_steals(const tilepool_t *pool)
+{
+    unsigned long steals = 0;
+    int idx;
+
+    for(idx=0; idx < pool->nthreads; idx++)
+        steals += pool->workers[idx].steals;
+    return steals;
+}
+
+
+long tilepool_l2_bytes(void)
+{
+    long bytes = -1;
+
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    return (bytes > 0) ? bytes : DEFAULT_L2_BYTES;
+}
+
+
+void tile_grid_init(tile_grid_t *grid, int row0, int row1, int col0, int col1, int tile_rows, int tile_cols)
+{
+    grid->row0 = row0;
+    grid->row1 = row1;
+    grid->col0 = col0;
+    grid->col1 = col1;
+    grid->tile_rows = (tile_rows > 0) ? tile_rows : 1;
+    grid->tile_cols = (tile_cols > 0) ? tile_cols : 1;
+    grid->down = (row1 > row0) ? (row1 - row0 + grid->tile_rows - 1) / grid->tile_rows : 0;
+    grid->across = (col1 > col0) ? (col1 - col0 + grid->tile_cols - 1) / grid->tile_cols : 0;
+}
+
+
+int tile_grid_count(const tile_grid_t *grid)
+{
+    return grid->down * grid->across;
+}
+
+
+void tile_grid_rect(const tile_grid_t *grid, int tile, int *row0, int *row1, int *col0, int *col1)
+{
+    int down = tile / grid->across;
+    int across = tile % grid->across;
+
+    *row0 = grid->row0 + down * grid->tile_rows;
+    *row1 = (*row0 + grid->tile_rows < grid->row1) ? *row0 + grid->tile_rows : grid->row1;
+    *col0 = grid->col0 + across * grid->tile_cols;
+    *col1 = (*col0 + grid->tile_cols < grid->col1) ? *col0 + grid->tile_cols : grid->col1;
+}
+
+
+int tile_rows_for_cache(long cache_bytes, int tile_cols, int bytes_per_pixel)
+{
+    // Convolving a tile also reads the row above and below it
+    long rows = cache_bytes / ((long)tile_cols * bytes_per_pixel) - 2;
+
+    return (rows > 0) ? (int)rows : 1;
+}
@@ -0,0 +1,50 @@
+#ifndef TILEPOOL_H
+#define TILEPOOL_H
+
+// Persistent worker pool for tiled image processing.
+//
+// The workers are created once and then run any number of jobs, one job being ntiles calls of a tile function.
+// Each job starts with the tiles split into equal contiguous ranges, one per worker, so neighboring tiles stay on
+// the same core. A worker that finishes its range steals the upper half of the range of another worker, so a
+// slow core or an uneven tile does not leave the rest of the pool idle at the end of the frame.
+//
+typedef void (*tile_fn)(void *arg, int tile);
+
+typedef struct tilepool tilepool_t;
+
+// Create nthreads workers, 0 for one per online CPU. With pinned set, worker n runs only on CPU n modulo the
+// number of CPUs. Returns NULL if the workers could not be created.
+tilepool_t *tilepool_create(int nthreads, int pinned);
+
+// Run fn(arg, tile) for every tile in [0, ntiles) and return when all have completed
+void tilepool_run(tilepool_t *pool, tile_fn fn, void *arg, int ntiles);
+
+void tilepool_destroy(tilepool_t *pool);
+
+int tilepool_threads(const tilepool_t *pool);
+
+// Ranges stolen since the pool was created
+unsigned long tilepool_steals(const tilepool_t *pool);
+
+// A rectangle of rows [row0, row1) and columns [col0, col1) cut into tiles of at most tile_rows x tile_cols,
+// numbered row major. Edge tiles are smaller when the sizes do not divide evenly, so every pixel is covered.
+typedef struct
+{
+    int row0, row1, col0, col1;
+    int tile_rows, tile_cols;
+    int down, across;
+} tile_grid_t;
+
+void tile_grid_init(tile_grid_t *grid, int row0, int row1, int col0, int col1, int tile_rows, int tile_cols);
+
+int tile_grid_count(const tile_grid_t *grid);
+
+void tile_grid_rect(const tile_grid_t *grid, int tile, int *row0, int *row1, int *col0, int *col1);
+
+// Tile rows for tiles tile_cols wide whose working set of bytes_per_pixel fits in cache_bytes, at least 1
+int tile_rows_for_cache(long cache_bytes, int tile_cols, int bytes_per_pixel);
+
+// Size of the L2 cache, or a 512 KB default like the Cortex-A7 on the Pi when it can not be found
+long tilepool_l2_bytes(void);
+
+#endif
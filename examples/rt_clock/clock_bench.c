@@ -0,0 +1,278 @@
+// Clock source characterization
+//
+// posix_clock.c tests one MY_CLOCK with 100 nanosleeps. This sweeps every clock ID and for each one measures
+//
+//   res              clock_getres
+//   gettime_vdso     clock_gettime cost through the C library, which reads the clock in user space (vDSO) where
+//                    the kernel supports it for that clock
+//   gettime_syscall  the same read forced through the system call, for comparison
+//   step             smallest non zero difference between back to back reads, and how often time went backwards
+//   nanosleep        overshoot of a relative nanosleep past the requested delay, timed with CLOCK_MONOTONIC, the
+//                    clock nanosleep itself measures against, so these rows are the same test under every clock
+//   clock_nanosleep  overshoot of an absolute clock_nanosleep on this clock past its deadline, 0 samples when the
+//                    clock's resolution is coarser than the delay and the overshoot could not be told from its ticks
+//
+// over a range of requested delays, first under SCHED_OTHER and then under SCHED_FIFO at the highest priority.
+// Results go to stdout (or -o file) as CSV, one row per policy, clock, test and delay, with the distribution over
+// the samples in ns. Progress goes to stderr. Clocks a call does not support show up as rows with 0 samples.
+//
+// Usage: clock_bench [-o file.csv] [-n samples] [-p other|fifo|both]
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NSEC_PER_SEC (1000000000LL)
+#define NSEC_PER_MSEC (1000000LL)
+#define NSEC_PER_USEC (1000LL)
+#define ERROR (-1)
+#define OK (0)
+
+#define GETTIME_BATCHES (1000)
+#define GETTIME_PER_BATCH (1000)
+#define STEP_READS (1000000)
+#define DEFAULT_SAMPLES (100)
+
+typedef struct {
+    clockid_t id;
+    const char *name;
+} clock_desc_t;
+
+static const clock_desc_t clocks[] = {
+    {CLOCK_REALTIME, "REALTIME"},
+    {CLOCK_MONOTONIC, "MONOTONIC"},
+    {CLOCK_MONOTONIC_RAW, "MONOTONIC_RAW"},
+    {CLOCK_REALTIME_COARSE, "REALTIME_COARSE"},
+    {CLOCK_MONOTONIC_COARSE, "MONOTONIC_COARSE"},
+    {CLOCK_BOOTTIME, "BOOTTIME"},
+};
+#define NUM_CLOCKS ((int)(sizeof(clocks) / sizeof(clocks[0])))
+
+static const long long delays_ns[] = {
+    1 * NSEC_PER_USEC, 10 * NSEC_PER_USEC, 100 * NSEC_PER_USEC, 1 * NSEC_PER_MSEC, 10 * NSEC_PER_MSEC,
+};
+#define NUM_DELAYS ((int)(sizeof(delays_ns) / sizeof(delays_ns[0])))
+
+static FILE *csv;
+static int samples = DEFAULT_SAMPLES;
+static const char *policy_name;
+static long long *values;
+
+static long long ts_nsec(const struct timespec *ts) {
+    return (long long)ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static struct timespec nsec_ts(long long nsec) {
+    struct timespec ts;
+
+    ts.tv_sec = nsec / NSEC_PER_SEC;
+    ts.tv_nsec = nsec % NSEC_PER_SEC;
+    return ts;
+}
+
+static int compare_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Sort the n values and write one CSV row of their distribution, extra is the last column
+static void emit(const char *clock_name, const char *test, long long delay, int n, long long extra) {
+    double mean = 0.0;
+    int i;
+
+    if (n == 0) {
+        fprintf(csv, "%s,%s,%s,%lld,0,,,,,,,%lld\n", policy_name, clock_name, test, delay, extra);
+        return;
+    }
+
+    qsort(values, n, sizeof(long long), compare_ll);
+    for (i = 0; i < n; i++) mean += values[i];
+    mean /= n;
+
+    fprintf(csv, "%s,%s,%s,%lld,%d,%lld,%lld,%lld,%lld,%lld,%.1lf,%lld\n", policy_name, clock_name, test, delay, n,
+        values[0], values[n / 2], values[n * 9 / 10], values[n * 99 / 100], values[n - 1], mean, extra);
+}
+
+// Per call cost in ns, each value the average over one batch of back to back reads
+static int gettime_cost(clockid_t id, int use_syscall) {
+    struct timespec ts, start, stop;
+    int batch, i;
+
+    for (batch = 0; batch < GETTIME_BATCHES; batch++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (use_syscall) {
+            for (i = 0; i < GETTIME_PER_BATCH; i++)
+                if (syscall(SYS_clock_gettime, id, &ts) == ERROR) return 0;
+        } else {
+            for (i = 0; i < GETTIME_PER_BATCH; i++)
+                if (clock_gettime(id, &ts) == ERROR) return 0;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+        values[batch] = (ts_nsec(&stop) - ts_nsec(&start)) / GETTIME_PER_BATCH;
+    }
+
+    return GETTIME_BATCHES;
+}
+
+// Non zero steps between consecutive reads, the count of backward steps is returned in *backwards
+static int step_size(clockid_t id, long long *backwards) {
+    struct timespec ts;
+    long long last, now;
+    int i, n = 0;
+
+    *backwards = 0;
+    clock_gettime(id, &ts);
+    last = ts_nsec(&ts);
+
+    for (i = 0; i < STEP_READS && n < GETTIME_BATCHES; i++) {
+        clock_gettime(id, &ts);
+        now = ts_nsec(&ts);
+        if (now < last) (*backwards)++;
+        else if (now > last) values[n++] = now - last;
+        last = now;
+    }
+
+    return n;
+}
+
+// Overshoot past delay of a relative nanosleep, or of an absolute clock_nanosleep on id with resolution res
+static int sleep_overshoot(clockid_t id, long long res, long long delay, int absolute) {
+    struct timespec start, stop, request, deadline;
+    int i, rc;
+
+    // a relative sleep runs on CLOCK_MONOTONIC whatever clock is being swept, a coarse clock would time it in ticks
+    if (!absolute) id = CLOCK_MONOTONIC;
+    else if (res > delay) return 0;
+
+    for (i = 0; i < samples; i++) {
+        if (clock_gettime(id, &start) == ERROR) return 0;
+
+        if (absolute) {
+            deadline = nsec_ts(ts_nsec(&start) + delay);
+            while ((rc = clock_nanosleep(id, TIMER_ABSTIME, &deadline, NULL)) == EINTR);
+            if (rc != 0) return 0;  // EINVAL or ENOTSUP: not a clock clock_nanosleep can use
+        } else {
+            request = nsec_ts(delay);
+            while (nanosleep(&request, &request) == ERROR && errno == EINTR);
+        }
+
+        clock_gettime(id, &stop);
+        values[i] = ts_nsec(&stop) - ts_nsec(&start) - delay;
+    }
+
+    return samples;
+}
+
+static void *clock_sweep(void *arg) {
+    struct timespec res;
+    long long backwards;
+    int c, d, n;
+
+    (void)arg;
+    for (c = 0; c < NUM_CLOCKS; c++) {
+        fprintf(stderr, "%s %s\n", policy_name, clocks[c].name);
+
+        if (clock_getres(clocks[c].id, &res) == ERROR) {
+            emit(clocks[c].name, "res", 0, 0, 0);
+            continue;
+        }
+        values[0] = ts_nsec(&res);
+        emit(clocks[c].name, "res", 0, 1, 0);
+
+        n = gettime_cost(clocks[c].id, 0);
+        emit(clocks[c].name, "gettime_vdso", 0, n, 0);
+        n = gettime_cost(clocks[c].id, 1);
+        emit(clocks[c].name, "gettime_syscall", 0, n, 0);
+
+        n = step_size(clocks[c].id, &backwards);
+        emit(clocks[c].name, "step", 0, n, backwards);
+
+        for (d = 0; d < NUM_DELAYS; d++) {
+            n = sleep_overshoot(clocks[c].id, ts_nsec(&res), delays_ns[d], 0);
+            emit(clocks[c].name, "nanosleep", delays_ns[d], n, 0);
+            n = sleep_overshoot(clocks[c].id, ts_nsec(&res), delays_ns[d], 1);
+            emit(clocks[c].name, "clock_nanosleep", delays_ns[d], n, 0);
+        }
+
+        fflush(csv);
+    }
+
+    return NULL;
+}
+
+// Run the sweep in a thread with the given policy, at the highest priority for SCHED_FIFO
+static int run_policy(int policy, const char *name) {
+    pthread_attr_t attr;
+    struct sched_param param;
+    pthread_t thread;
+    int rc;
+
+    policy_name = name;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, policy);
+    param.sched_priority = (policy == SCHED_FIFO) ? sched_get_priority_max(SCHED_FIFO) : 0;
+    pthread_attr_setschedparam(&attr, &param);
+
+    if ((rc = pthread_create(&thread, &attr, clock_sweep, NULL)) != 0) {
+        fprintf(stderr, "%s: pthread_create: %s%s\n", name, strerror(rc),
+            rc == EPERM ? " (SCHED_FIFO needs root or CAP_SYS_NICE)" : "");
+        pthread_attr_destroy(&attr);
+        return ERROR;
+    }
+
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
+    return OK;
+}
+
+int main(int argc, char *argv[]) {
+    const char *policies = "both";
+    int opt, errors = 0;
+
+    csv = stdout;
+
+    while ((opt = getopt(argc, argv, "o:n:p:")) != -1) {
+        switch (opt) {
+        case 'o':
+            if ((csv = fopen(optarg, "w")) == NULL) {
+                perror(optarg);
+                exit(-1);
+            }
+            break;
+        case 'n':
+            samples = atoi(optarg);
+            break;
+        case 'p':
+            policies = optarg;
+            break;
+        default:
+            samples = 0;
+        }
+    }
+
+    if (samples <= 0 || (strcmp(policies, "other") && strcmp(policies, "fifo") && strcmp(policies, "both"))) {
+        fprintf(stderr, "Usage: %s [-o file.csv] [-n samples] [-p other|fifo|both]\n", argv[0]);
+        exit(-1);
+    }
+
+    if ((values = malloc((samples > GETTIME_BATCHES ? samples : GETTIME_BATCHES) * sizeof(long long))) == NULL)
+        exit(-1);
+
+    fprintf(csv, "policy,clock,test,delay_ns,samples,min_ns,p50_ns,p90_ns,p99_ns,max_ns,mean_ns,backwards\n");
+
+    if (strcmp(policies, "fifo") != 0) errors += run_policy(SCHED_OTHER, "SCHED_OTHER") != OK;
+    if (strcmp(policies, "other") != 0) errors += run_policy(SCHED_FIFO, "SCHED_FIFO") != OK;
+
+    if (csv != stdout) fclose(csv);
+    free(values);
+    return errors ? -1 : 0;
+}
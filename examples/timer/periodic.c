@@ -0,0 +1,212 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "periodic.h"
+
+static unsigned long long timespec_nsecs(const struct timespec *ts) {
+    return (unsigned long long)ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static struct timespec nsecs_timespec(unsigned long long nsecs) {
+    struct timespec ts;
+
+    ts.tv_sec = nsecs / NSEC_PER_SEC;
+    ts.tv_nsec = nsecs % NSEC_PER_SEC;
+    return ts;
+}
+
+int periodic_init(periodic_engine_t *engine) {
+    struct epoll_event event;
+
+    memset(engine, 0, sizeof(*engine));
+
+    if ((engine->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+
+    if ((engine->stopfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+        perror("eventfd");
+        close(engine->epfd);
+        return -1;
+    }
+
+    // the stop event is told apart from the tasks by a NULL pointer
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    epoll_ctl(engine->epfd, EPOLL_CTL_ADD, engine->stopfd, &event);
+
+    return 0;
+}
+
+void periodic_destroy(periodic_engine_t *engine) {
+    int i;
+
+    for (i = 0; i < engine->ntasks; i++) close(engine->tasks[i].fd);
+    close(engine->stopfd);
+    close(engine->epfd);
+    engine->ntasks = 0;
+}
+
+int periodic_add(periodic_engine_t *engine, const char *name, unsigned long long period_nsecs, periodic_fn fn,
+                 void *arg) {
+    periodic_task_t *task;
+    struct epoll_event event;
+
+    if (engine->ntasks >= PERIODIC_MAX_TASKS || period_nsecs == 0) return -1;
+
+    task = &engine->tasks[engine->ntasks];
+    memset(task, 0, sizeof(*task));
+    task->name = name;
+    task->fn = fn;
+    task->arg = arg;
+    task->period_nsecs = period_nsecs;
+
+    if ((task->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)) < 0) {
+        perror("timerfd_create");
+        return -1;
+    }
+
+    event.events = EPOLLIN;
+    event.data.ptr = task;
+    if (epoll_ctl(engine->epfd, EPOLL_CTL_ADD, task->fd, &event) < 0) {
+        perror("epoll_ctl");
+        close(task->fd);
+        return -1;
+    }
+
+    return engine->ntasks++;
+}
+
+// Read the expiration count and run the task for its latest release
+static void release(periodic_engine_t *engine, periodic_task_t *task) {
+    unsigned long long count, ideal, now_nsecs;
+    struct timespec now;
+
+    if (read(task->fd, &count, sizeof(count)) != sizeof(count) || count == 0) return;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    task->expirations += count;
+
+    // release n is due at start + n periods, jitter is measured from the latest one that expired
+    ideal = timespec_nsecs(&engine->start) + task->expirations * task->period_nsecs;
+    now_nsecs = timespec_nsecs(&now);
+    periodic_record(&task->stats, now_nsecs > ideal ? now_nsecs - ideal : 0, count - 1);
+
+    task->fn(task->arg, count - 1);
+}
+
+int periodic_run(periodic_engine_t *engine, unsigned long long duration_nsecs) {
+    struct epoll_event events[PERIODIC_MAX_TASKS + 1];
+    struct itimerspec itime;
+    struct timespec cpu_start, cpu_stop, now;
+    unsigned long long start_nsecs, stop_nsecs = 0, drain;
+    int i, n, timeout;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+    clock_gettime(CLOCK_MONOTONIC, &engine->start);
+    start_nsecs = timespec_nsecs(&engine->start);
+    if (duration_nsecs) stop_nsecs = start_nsecs + duration_nsecs;
+
+    // absolute first releases on the common start, so phases between tasks don't drift
+    for (i = 0; i < engine->ntasks; i++) {
+        engine->tasks[i].expirations = 0;
+        itime.it_interval = nsecs_timespec(engine->tasks[i].period_nsecs);
+        itime.it_value = nsecs_timespec(start_nsecs + engine->tasks[i].period_nsecs);
+        if (timerfd_settime(engine->tasks[i].fd, TFD_TIMER_ABSTIME, &itime, NULL) < 0) {
+            perror("timerfd_settime");
+            return -1;
+        }
+    }
+
+    __atomic_store_n(&engine->running, 1, __ATOMIC_RELEASE);
+
+    while (__atomic_load_n(&engine->running, __ATOMIC_ACQUIRE)) {
+        timeout = -1;
+        if (stop_nsecs) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (timespec_nsecs(&now) >= stop_nsecs) break;
+            timeout = (int)((stop_nsecs - timespec_nsecs(&now) + 999999) / 1000000);
+        }
+
+        if ((n = epoll_wait(engine->epfd, events, PERIODIC_MAX_TASKS + 1, timeout)) < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (i = 0; i < n; i++) {
+            if (events[i].data.ptr == NULL) {
+                if (read(engine->stopfd, &drain, sizeof(drain)) < 0) drain = 0;
+                __atomic_store_n(&engine->running, 0, __ATOMIC_RELEASE);
+            } else {
+                release(engine, (periodic_task_t *)events[i].data.ptr);
+            }
+        }
+    }
+
+    // disarm
+    memset(&itime, 0, sizeof(itime));
+    for (i = 0; i < engine->ntasks; i++) timerfd_settime(engine->tasks[i].fd, 0, &itime, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_stop);
+    engine->wall_nsecs = timespec_nsecs(&now) - start_nsecs;
+    engine->cpu_nsecs = timespec_nsecs(&cpu_stop) - timespec_nsecs(&cpu_start);
+    __atomic_store_n(&engine->running, 0, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+void periodic_stop(periodic_engine_t *engine) {
+    uint64_t one = 1;
+
+    // write is async-signal-safe
+    if (write(engine->stopfd, &one, sizeof(one)) < 0) __atomic_store_n(&engine->running, 0, __ATOMIC_RELEASE);
+}
+
+void periodic_record(periodic_stats_t *stats, unsigned long long jitter_nsecs, unsigned long long missed) {
+    int bin = jitter_nsecs ? 64 - __builtin_clzll(jitter_nsecs) : 0;
+
+    if (bin >= PERIODIC_HIST_BINS) bin = PERIODIC_HIST_BINS - 1;
+
+    stats->releases++;
+    stats->overruns += missed;
+    stats->jitter_sum += jitter_nsecs;
+    if (jitter_nsecs > stats->jitter_max) stats->jitter_max = jitter_nsecs;
+    stats->hist[bin]++;
+}
+
+unsigned long long periodic_percentile(const periodic_stats_t *stats, double fraction) {
+    unsigned long long want = (unsigned long long)(stats->releases * fraction), seen = 0;
+    int bin;
+
+    for (bin = 0; bin < PERIODIC_HIST_BINS; bin++) {
+        seen += stats->hist[bin];
+        if (seen >= want && seen > 0) return bin ? (1ULL << bin) : 0;
+    }
+
+    return stats->jitter_max;
+}
+
+void periodic_print(FILE *out, const char *name, const periodic_stats_t *stats, int hist) {
+    int bin;
+
+    fprintf(out, "%-16s releases=%llu overruns=%llu jitter avg=%.1lf us p99<%.1lf us max=%.1lf us\n", name,
+            stats->releases, stats->overruns,
+            stats->releases ? (double)stats->jitter_sum / stats->releases / NSEC_PER_USEC : 0.0,
+            (double)periodic_percentile(stats, 0.99) / NSEC_PER_USEC, (double)stats->jitter_max / NSEC_PER_USEC);
+
+    if (!hist) return;
+
+    for (bin = 0; bin < PERIODIC_HIST_BINS; bin++)
+        if (stats->hist[bin])
+            fprintf(out, "    %10llu .. %10llu ns: %llu\n", bin ? (1ULL << (bin - 1)) : 0, bin ? (1ULL << bin) - 1 : 0,
+                    stats->hist[bin]);
+}
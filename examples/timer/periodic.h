@@ -0,0 +1,82 @@
+#ifndef PERIODIC_H
+#define PERIODIC_H
+
+// Periodic release engine on timerfd + epoll
+//
+// Each task gets its own timerfd on CLOCK_MONOTONIC, armed with an absolute first release so all of them share
+// one time base, and one thread waits on all of them with epoll_wait. No signals are involved, so there are no
+// handler restrictions, the task functions run in a normal thread context, and any number of periods share the
+// thread.
+//
+// Reading a timerfd gives the number of expirations since the last read. More than one means releases were
+// missed (an overrun), the task function is told how many and the engine counts them instead of losing them the
+// way a queued signal that is still pending would. Release jitter, the time from the ideal release to the task
+// function starting, goes into a per task histogram with power of two bins.
+//
+#include <stdio.h>
+#include <time.h>
+
+#define NSEC_PER_USEC (1000ULL)
+#define NSEC_PER_SEC (1000000000ULL)
+
+#define PERIODIC_MAX_TASKS (64)
+#define PERIODIC_HIST_BINS (64)
+
+typedef struct periodic_stats {
+    unsigned long long releases;   // task function calls
+    unsigned long long overruns;   // releases missed because the previous one ran late
+    unsigned long long jitter_sum;
+    unsigned long long jitter_max;
+    unsigned long long hist[PERIODIC_HIST_BINS];  // bin 0 is 0 ns, bin k is [2^(k-1), 2^k) ns
+} periodic_stats_t;
+
+// missed is the number of releases skipped before this one, normally 0
+typedef void (*periodic_fn)(void *arg, unsigned long long missed);
+
+typedef struct periodic_task {
+    const char *name;
+    periodic_fn fn;
+    void *arg;
+    unsigned long long period_nsecs;
+    int fd;
+    unsigned long long expirations;  // since the engine started, including missed ones
+    periodic_stats_t stats;
+} periodic_task_t;
+
+typedef struct periodic_engine {
+    int epfd;
+    int stopfd;
+    int ntasks;
+    int running;
+    struct timespec start;
+    unsigned long long cpu_nsecs;   // thread CPU time spent in periodic_run
+    unsigned long long wall_nsecs;  // and the wall clock time it ran
+    periodic_task_t tasks[PERIODIC_MAX_TASKS];
+} periodic_engine_t;
+
+// Returns 0 or -1
+int periodic_init(periodic_engine_t *engine);
+void periodic_destroy(periodic_engine_t *engine);
+
+// Add a task before periodic_run. Returns the task number or -1.
+int periodic_add(periodic_engine_t *engine, const char *name, unsigned long long period_nsecs, periodic_fn fn,
+                 void *arg);
+
+// Arm every task with its first release one period from now and dispatch releases until duration_nsecs have
+// passed (0 for until periodic_stop). Returns 0 or -1.
+int periodic_run(periodic_engine_t *engine, unsigned long long duration_nsecs);
+
+// Make periodic_run return, safe from any thread or signal handler
+void periodic_stop(periodic_engine_t *engine);
+
+// Add one release with jitter_nsecs of latency after missed skipped releases to stats. Only arithmetic, so it can
+// be used from a signal handler too.
+void periodic_record(periodic_stats_t *stats, unsigned long long jitter_nsecs, unsigned long long missed);
+
+// Upper bound of the bin holding the given fraction (e.g. 0.99) of releases
+unsigned long long periodic_percentile(const periodic_stats_t *stats, double fraction);
+
+// One line summary, then with hist the non empty histogram bins
+void periodic_print(FILE *out, const char *name, const periodic_stats_t *stats, int hist);
+
+#endif
@@ -0,0 +1,179 @@
+// Release jitter and CPU cost, signal driven timer vs. timerfd + epoll engine
+//
+// For each rate from 1 kHz to 10 kHz the same do nothing periodic task is released for a few seconds two ways:
+//
+//   signal   posix_rt_timer.c style, timer_create with SIGEV_SIGNAL and the work in the handler, with overruns
+//            from timer_getoverrun
+//   epoll    periodic.c, a timerfd per task and one thread in epoll_wait
+//
+// then all four rates run at once in one epoll engine thread to show the multiplexing. Jitter is the time from
+// the ideal release, start + n periods on CLOCK_MONOTONIC, to the task running. CPU is the process CPU time over
+// the wall clock time, so it is the cost of the release mechanism itself.
+//
+// Usage: periodic_bench [seconds-per-test]
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "periodic.h"
+
+#define NUM_RATES (4)
+
+static const unsigned long long rates_hz[NUM_RATES] = {1000, 2000, 5000, 10000};
+
+// signal version state, only touched by the handler once the timer is armed
+static timer_t tt_timer;
+static struct timespec sig_start;
+static unsigned long long sig_period_nsecs, sig_expirations;
+static periodic_stats_t sig_stats;
+
+static volatile unsigned long long work_count;
+
+static unsigned long long timespec_nsecs(const struct timespec *ts) {
+    return (unsigned long long)ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static unsigned long long process_cpu_nsecs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return timespec_nsecs(&ts);
+}
+
+// Same job as monitor_interval_expired, less the printf, which isn't async-signal-safe
+void release_handler(int signo, siginfo_t *info, void *ignored) {
+    unsigned long long ideal, now_nsecs;
+    struct timespec now;
+    int overrun;
+
+    (void)signo;
+    (void)info;
+    (void)ignored;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    overrun = timer_getoverrun(tt_timer);
+    if (overrun < 0) overrun = 0;
+
+    sig_expirations += 1 + overrun;
+    ideal = timespec_nsecs(&sig_start) + sig_expirations * sig_period_nsecs;
+    now_nsecs = timespec_nsecs(&now);
+    periodic_record(&sig_stats, now_nsecs > ideal ? now_nsecs - ideal : 0, overrun);
+
+    work_count++;
+}
+
+void epoll_task(void *arg, unsigned long long missed) {
+    (void)arg;
+    (void)missed;
+    work_count++;
+}
+
+static void print_cpu(unsigned long long cpu_nsecs, unsigned long long wall_nsecs) {
+    printf("%-16s CPU %.2lf%% of %.2lf s\n", "", 100.0 * cpu_nsecs / wall_nsecs, (double)wall_nsecs / NSEC_PER_SEC);
+}
+
+static int run_signal(unsigned long long period_nsecs, unsigned long long duration_nsecs) {
+    struct sigevent release_event;
+    struct sigaction release_action;
+    struct itimerspec itime;
+    struct timespec now;
+    unsigned long long cpu_start, start_nsecs;
+
+    memset(&sig_stats, 0, sizeof(sig_stats));
+    sig_period_nsecs = period_nsecs;
+    sig_expirations = 0;
+
+    memset(&release_action, 0, sizeof(release_action));
+    release_action.sa_sigaction = release_handler;
+    release_action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigaction(SIGRTMIN + 1, &release_action, NULL);
+
+    memset(&release_event, 0, sizeof(release_event));
+    release_event.sigev_notify = SIGEV_SIGNAL;
+    release_event.sigev_signo = SIGRTMIN + 1;
+    if (timer_create(CLOCK_MONOTONIC, &release_event, &tt_timer) < 0) {
+        perror("timer_create");
+        return -1;
+    }
+
+    cpu_start = process_cpu_nsecs();
+    clock_gettime(CLOCK_MONOTONIC, &sig_start);
+    start_nsecs = timespec_nsecs(&sig_start);
+
+    itime.it_interval.tv_sec = period_nsecs / NSEC_PER_SEC;
+    itime.it_interval.tv_nsec = period_nsecs % NSEC_PER_SEC;
+    itime.it_value.tv_sec = (start_nsecs + period_nsecs) / NSEC_PER_SEC;
+    itime.it_value.tv_nsec = (start_nsecs + period_nsecs) % NSEC_PER_SEC;
+    if (timer_settime(tt_timer, TIMER_ABSTIME, &itime, NULL) < 0) {
+        perror("timer_settime");
+        timer_delete(tt_timer);
+        return -1;
+    }
+
+    do {
+        pause();
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while (timespec_nsecs(&now) - start_nsecs < duration_nsecs);
+
+    timer_delete(tt_timer);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    periodic_print(stdout, "signal", &sig_stats, 0);
+    print_cpu(process_cpu_nsecs() - cpu_start, timespec_nsecs(&now) - start_nsecs);
+    return 0;
+}
+
+static int run_epoll(const unsigned long long *hz, int ntasks, unsigned long long duration_nsecs, int hist) {
+    periodic_engine_t engine;
+    unsigned long long cpu_start;
+    static char names[NUM_RATES][32];
+    int i;
+
+    if (periodic_init(&engine) < 0) return -1;
+
+    for (i = 0; i < ntasks; i++) {
+        snprintf(names[i], sizeof(names[i]), ntasks == 1 ? "epoll" : "epoll %llu Hz", hz[i]);
+        if (periodic_add(&engine, names[i], NSEC_PER_SEC / hz[i], epoll_task, NULL) < 0) {
+            periodic_destroy(&engine);
+            return -1;
+        }
+    }
+
+    cpu_start = process_cpu_nsecs();
+    periodic_run(&engine, duration_nsecs);
+
+    for (i = 0; i < ntasks; i++) periodic_print(stdout, engine.tasks[i].name, &engine.tasks[i].stats, hist);
+    print_cpu(process_cpu_nsecs() - cpu_start, engine.wall_nsecs);
+
+    periodic_destroy(&engine);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    unsigned long long duration_nsecs = (unsigned long long)(seconds * NSEC_PER_SEC);
+    struct timespec resolution;
+    int i;
+
+    if (duration_nsecs == 0) {
+        fprintf(stderr, "Usage: %s [seconds-per-test]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    clock_getres(CLOCK_MONOTONIC, &resolution);
+    printf("CLOCK_MONOTONIC resolution %ld ns, %.1lf s per test\n", resolution.tv_nsec, seconds);
+
+    for (i = 0; i < NUM_RATES; i++) {
+        printf("\n%llu Hz (%llu us period)\n", rates_hz[i], NSEC_PER_SEC / rates_hz[i] / NSEC_PER_USEC);
+        run_signal(NSEC_PER_SEC / rates_hz[i], duration_nsecs);
+        run_epoll(&rates_hz[i], 1, duration_nsecs, 0);
+    }
+
+    printf("\nAll rates in one epoll thread\n");
+    run_epoll(rates_hz, NUM_RATES, duration_nsecs, 1);
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+#include "watchdog.h"
+
+#define NSEC_PER_SEC (1000000000ULL)
+
+static unsigned long long now_nsecs(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
+
+int wd_init(watchdog_t *wd, FILE *log) {
+    memset(wd, 0, sizeof(*wd));
+    wd->log = log ? log : stderr;
+    return pthread_mutex_init(&wd->register_lock, NULL) == 0 ? 0 : -1;
+}
+
+wd_slot_t *wd_register(watchdog_t *wd, const wd_config_t *config) {
+    wd_service_t *service;
+    int id;
+
+    if (config->deadline_nsecs == 0) return NULL;
+
+    pthread_mutex_lock(&wd->register_lock);
+    if ((id = wd->nservices) >= WD_MAX_SERVICES) {
+        pthread_mutex_unlock(&wd->register_lock);
+        return NULL;
+    }
+
+    service = &wd->services[id];
+    memset(service, 0, sizeof(*service));
+    service->config = *config;
+    if (service->config.restart_after <= 0) service->config.restart_after = 1;
+    if (service->config.max_restarts <= 0) service->config.max_restarts = WD_TARDY_TERMINATOR;
+    service->slot = &wd->slots[id];
+    service->id = id;
+    service->slot->beats = 0;
+    service->last_progress_nsecs = now_nsecs();
+
+    // the monitor sees the new service only once it is filled in
+    __atomic_store_n(&wd->nservices, id + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&wd->register_lock);
+
+    return service->slot;
+}
+
+static void escalate(watchdog_t *wd, wd_service_t *service, wd_event_t event) {
+    static const char *event_names[] = {"missed deadline", "recovered", "restarted", "gave up"};
+
+    if (service->config.actions & WD_LOG)
+        fprintf(wd->log, "watchdog: %s (%d) %s, %d in a row, %d restarts\n",
+            service->config.name ? service->config.name : "service", service->id, event_names[event],
+            service->misses, service->restarts);
+
+    if ((service->config.actions & WD_CALLBACK) && service->config.callback)
+        service->config.callback(service, event, service->config.arg);
+}
+
+// Check one service at monitor time now
+static void check(watchdog_t *wd, wd_service_t *service, unsigned long long now) {
+    unsigned long long beats = __atomic_load_n(&service->slot->beats, __ATOMIC_ACQUIRE);
+
+    if (beats != service->last_beats) {
+        service->last_beats = beats;
+        service->last_progress_nsecs = now;
+        if (service->misses) {
+            service->misses = 0;
+            escalate(wd, service, WD_RECOVERED);
+        }
+        return;
+    }
+
+    // one more miss for each whole deadline without progress
+    if (service->gave_up ||
+        now - service->last_progress_nsecs < (service->misses + 1) * service->config.deadline_nsecs)
+        return;
+
+    service->misses++;
+    service->total_misses++;
+    service->detected_nsecs = now;
+    escalate(wd, service, WD_MISSED);
+
+    if (!(service->config.actions & WD_RESTART) || service->misses < service->config.restart_after) return;
+
+    if (service->restarts >= service->config.max_restarts) {
+        service->gave_up = 1;
+        escalate(wd, service, WD_GAVE_UP);
+        return;
+    }
+
+    service->restarts++;
+    if (service->config.restart) service->config.restart(service, service->config.arg);
+
+    // a restarted service gets a whole deadline from now
+    service->misses = 0;
+    service->last_progress_nsecs = now_nsecs();
+    service->last_beats = __atomic_load_n(&service->slot->beats, __ATOMIC_ACQUIRE);
+    escalate(wd, service, WD_RESTARTED);
+}
+
+static void *monitor(void *arg) {
+    watchdog_t *wd = (watchdog_t *)arg;
+    unsigned long long next, now, done;
+    struct timespec deadline;
+    int i, n;
+
+    next = now_nsecs();
+
+    while (__atomic_load_n(&wd->running, __ATOMIC_ACQUIRE)) {
+        next += wd->scan_nsecs;
+        deadline.tv_sec = next / NSEC_PER_SEC;
+        deadline.tv_nsec = next % NSEC_PER_SEC;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR);
+
+        now = now_nsecs();
+        n = __atomic_load_n(&wd->nservices, __ATOMIC_ACQUIRE);
+        for (i = 0; i < n; i++) check(wd, &wd->services[i], now);
+        done = now_nsecs();
+
+        wd->scans++;
+        wd->scan_cost_nsecs += done - now;
+
+        // after a long stall skip the missed scans rather than running them back to back
+        if (done > next + wd->scan_nsecs) next = done;
+    }
+
+    fflush(wd->log);
+    return NULL;
+}
+
+int wd_start(watchdog_t *wd, unsigned long long scan_nsecs, int rt_prio) {
+    pthread_attr_t attr;
+    struct sched_param param;
+    int rc;
+
+    if (scan_nsecs == 0) return -1;
+    wd->scan_nsecs = scan_nsecs;
+    wd->running = 1;
+
+    pthread_attr_init(&attr);
+    if (rt_prio > 0) {
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        param.sched_priority = rt_prio;
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    rc = pthread_create(&wd->monitor, &attr, monitor, wd);
+
+    // without the privilege for SCHED_FIFO run the monitor at normal priority
+    if (rc == EPERM) {
+        fprintf(wd->log, "watchdog: no permission for SCHED_FIFO, monitor runs at normal priority\n");
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        rc = pthread_create(&wd->monitor, &attr, monitor, wd);
+    }
+
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        wd->running = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+void wd_stop(watchdog_t *wd) {
+    if (!wd->running) return;
+
+    __atomic_store_n(&wd->running, 0, __ATOMIC_RELEASE);
+    pthread_join(wd->monitor, NULL);
+}
@@ -0,0 +1,100 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+// Software watchdog service
+//
+// posix_sw_wd.c gives one task one POSIX timer that it re-arms ("hits the snooze button") each time through its
+// loop, a system call per heartbeat and a timer per task. Here every service registers a heartbeat slot instead:
+// a counter alone on its cache line that only that service writes, so a heartbeat is one load and one store with
+// no system call, no lock and no cache line shared with any other service. One monitor thread wakes every scan
+// period, reads all of the counters, and notes when each last moved. A service whose counter has not moved for
+// its deadline has missed it, and the miss is escalated by the actions it registered with:
+//
+//   WD_LOG       a line to the watchdog log for every miss
+//   WD_CALLBACK  the service's callback for every miss, restart and give up
+//   WD_RESTART   the service's restart function after restart_after misses in a row, up to max_restarts times,
+//                after which the watchdog gives up on it, as TARDY_TERMINATOR does
+//
+// The monitor only sees that a counter moved at its next scan, so progress is stamped with the time of that scan,
+// up to one scan period after the heartbeat itself, and the miss is then seen at the first scan at least a deadline
+// later. A hang is detected between deadline and deadline plus two scan periods after the last heartbeat; stamping
+// with the earlier scan instead would tighten this to one period but could report a miss before a deadline passed.
+//
+#include <pthread.h>
+#include <stdio.h>
+
+#define WD_MAX_SERVICES (1024)
+#define WD_CACHE_LINE (64)
+#define WD_TARDY_TERMINATOR (3)
+
+#define WD_LOG (0x1)
+#define WD_CALLBACK (0x2)
+#define WD_RESTART (0x4)
+
+typedef enum { WD_MISSED, WD_RECOVERED, WD_RESTARTED, WD_GAVE_UP } wd_event_t;
+
+// The heartbeat slot, the only thing the service's real time path touches
+typedef struct wd_slot {
+    unsigned long long beats;
+} __attribute__((aligned(WD_CACHE_LINE))) wd_slot_t;
+
+struct wd_service;
+typedef void (*wd_event_fn)(struct wd_service *service, wd_event_t event, void *arg);
+typedef void (*wd_restart_fn)(struct wd_service *service, void *arg);
+
+typedef struct wd_config {
+    const char *name;
+    unsigned long long deadline_nsecs;  // longest allowed time between heartbeats
+    unsigned int actions;               // WD_LOG | WD_CALLBACK | WD_RESTART
+    int restart_after;                  // misses in a row before a restart, 0 for 1
+    int max_restarts;                   // restarts before giving up, 0 for WD_TARDY_TERMINATOR
+    wd_event_fn callback;
+    wd_restart_fn restart;
+    void *arg;
+} wd_config_t;
+
+// Monitor side state of a service, only the monitor thread writes it after registration
+typedef struct wd_service {
+    wd_config_t config;
+    wd_slot_t *slot;
+    int id;
+    unsigned long long last_beats;
+    unsigned long long last_progress_nsecs;  // time of the scan that saw the counter move
+    unsigned long long detected_nsecs;       // monitor time of the latest miss
+    int misses;                              // in a row, 0 while healthy
+    int restarts;
+    int gave_up;
+    unsigned long long total_misses;
+} wd_service_t;
+
+typedef struct watchdog {
+    wd_slot_t slots[WD_MAX_SERVICES];
+    wd_service_t services[WD_MAX_SERVICES];
+    int nservices;
+    pthread_mutex_t register_lock;
+    pthread_t monitor;
+    int running;
+    unsigned long long scan_nsecs;
+    unsigned long long scans;
+    unsigned long long scan_cost_nsecs;  // total monitor time spent scanning
+    FILE *log;
+} watchdog_t;
+
+// log may be NULL for stderr. Returns 0 or -1.
+int wd_init(watchdog_t *wd, FILE *log);
+
+// Register a service, before or after wd_start. Returns its slot for wd_heartbeat, or NULL if full.
+wd_slot_t *wd_register(watchdog_t *wd, const wd_config_t *config);
+
+// Start the monitor scanning every scan_nsecs, at SCHED_FIFO priority rt_prio if it is above 0 and permitted.
+// Returns 0 or -1.
+int wd_start(watchdog_t *wd, unsigned long long scan_nsecs, int rt_prio);
+void wd_stop(watchdog_t *wd);
+
+// O(1) heartbeat. Only the owning service writes its slot, so a plain increment published with a release store is
+// enough, there is no read-modify-write to contend on.
+static inline void wd_heartbeat(wd_slot_t *slot) {
+    __atomic_store_n(&slot->beats, slot->beats + 1, __ATOMIC_RELEASE);
+}
+
+#endif
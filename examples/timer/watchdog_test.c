@@ -0,0 +1,246 @@
+// Detection latency of the software watchdog with many monitored services
+//
+// Each service is a thread with a period from 5 to 12 ms that heartbeats once per period and has a deadline of four
+// periods. Every eighth service hangs once, at a staggered time, by no longer heartbeating. Its restart function
+// ends the hang, the way posix_sw_wd.c would respawn the task. Service 0 stays hung through every restart, so the
+// watchdog gives up on it after WD_TARDY_TERMINATOR restarts.
+//
+// Detection latency is the time from a hung service's last heartbeat to the monitor reporting the miss. It cannot
+// be below the deadline, and should be no more than the deadline plus two scan periods plus scheduling delay, one
+// for the monitor to see the last heartbeat and one to see the deadline pass, so it is also printed less the
+// deadline. Any miss reported for a service that was not hung is a false alarm.
+//
+// The services must all get the CPU within their deadlines. With more of them than the online CPUs can run every
+// period, heartbeats are really late: the watchdog then reports misses on healthy services, counted as false alarms,
+// restarts them and gives up on some, and a hang on a service it has given up on goes undetected. On one CPU that
+// starts at a few hundred services, 1024 gives hundreds of false alarms. It is the load, not the watchdog, and a run
+// with false alarms prints a note saying so.
+//
+// Usage: watchdog_test [services] [seconds] [scan-usecs]
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "watchdog.h"
+
+#define NSEC_PER_USEC (1000ULL)
+#define NSEC_PER_MSEC (1000000ULL)
+#define NSEC_PER_SEC (1000000000ULL)
+
+#define HANG_EVERY (8)
+#define DEADLINE_PERIODS (4)
+#define HEARTBEAT_LOOPS (10000000)
+
+typedef struct service {
+    int id;
+    wd_slot_t *slot;
+    pthread_t thread;
+    unsigned long long period_nsecs;
+    unsigned long long hang_at_nsecs;  // 0 for a healthy service
+    int hung;
+    int stuck;                         // restarts do not end the hang
+    unsigned long long last_beat_nsecs;
+    unsigned long long latency_nsecs;  // of the first miss reported for the hang, 0 until then
+} service_t;
+
+static watchdog_t wd;
+static service_t *services;
+static int running = 1;
+static unsigned long long false_alarms, restarts, gave_up;
+
+static unsigned long long now_nsecs(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
+
+static void sleep_until(unsigned long long when) {
+    struct timespec deadline;
+
+    deadline.tv_sec = when / NSEC_PER_SEC;
+    deadline.tv_nsec = when % NSEC_PER_SEC;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR);
+}
+
+static void *service_thread(void *arg) {
+    service_t *service = (service_t *)arg;
+    unsigned long long next = now_nsecs();
+
+    while (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        next += service->period_nsecs;
+        sleep_until(next);
+
+        if (service->hang_at_nsecs && next >= service->hang_at_nsecs) {
+            service->hang_at_nsecs = 0;
+            __atomic_store_n(&service->hung, 1, __ATOMIC_RELEASE);
+        }
+        if (__atomic_load_n(&service->hung, __ATOMIC_ACQUIRE)) continue;
+
+        // the real time path: do the work, then one heartbeat, stamped before it so a scan that sees the heartbeat
+        // never measures from a later time
+        __atomic_store_n(&service->last_beat_nsecs, now_nsecs(), __ATOMIC_RELAXED);
+        wd_heartbeat(service->slot);
+    }
+
+    return NULL;
+}
+
+// Called on the monitor thread
+static void on_event(wd_service_t *wds, wd_event_t event, void *arg) {
+    service_t *service = (service_t *)arg;
+
+    if (event == WD_GAVE_UP) gave_up++;
+    if (event != WD_MISSED) return;
+
+    if (!__atomic_load_n(&service->hung, __ATOMIC_ACQUIRE)) {
+        false_alarms++;
+        return;
+    }
+    if (service->latency_nsecs == 0)
+        service->latency_nsecs = wds->detected_nsecs - __atomic_load_n(&service->last_beat_nsecs, __ATOMIC_RELAXED);
+}
+
+static void on_restart(wd_service_t *wds, void *arg) {
+    service_t *service = (service_t *)arg;
+
+    (void)wds;
+    restarts++;
+    if (!service->stuck) __atomic_store_n(&service->hung, 0, __ATOMIC_RELEASE);
+}
+
+static int compare_ull(const void *a, const void *b) {
+    unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static unsigned long long heartbeat_cost_psecs(void) {
+    static wd_slot_t slot;
+    unsigned long long start, end;
+    int i;
+
+    start = now_nsecs();
+    for (i = 0; i < HEARTBEAT_LOOPS; i++) {
+        wd_heartbeat(&slot);
+        __asm__ __volatile__("" ::: "memory");
+    }
+    end = now_nsecs();
+
+    return (end - start) * 1000 / HEARTBEAT_LOOPS;
+}
+
+int main(int argc, char *argv[]) {
+    int nservices = 128, seconds = 3, scan_usecs = 1000;
+    unsigned long long *latency, *over, start, psecs;
+    int i, nhung = 0, detected = 0;
+    wd_config_t config;
+    char names[WD_MAX_SERVICES][16];
+
+    if (argc > 1) nservices = atoi(argv[1]);
+    if (argc > 2) seconds = atoi(argv[2]);
+    if (argc > 3) scan_usecs = atoi(argv[3]);
+    if (nservices < 1 || nservices > WD_MAX_SERVICES || seconds < 1 || scan_usecs < 1) {
+        printf("Usage: watchdog_test [services 1..%d] [seconds] [scan-usecs]\n"
+               "More services than the CPUs can run every period miss their deadlines for real.\n",
+            WD_MAX_SERVICES);
+        exit(-1);
+    }
+
+    psecs = heartbeat_cost_psecs();
+    printf("heartbeat: %llu.%03llu ns\n", psecs / 1000, psecs % 1000);
+
+    services = calloc(nservices, sizeof(service_t));
+    latency = calloc(nservices, sizeof(unsigned long long));
+    over = calloc(nservices, sizeof(unsigned long long));
+    if (!services || !latency || !over || wd_init(&wd, stdout) < 0) {
+        perror("watchdog_test");
+        exit(-1);
+    }
+
+    start = now_nsecs();
+    for (i = 0; i < nservices; i++) {
+        service_t *service = &services[i];
+
+        service->id = i;
+        service->period_nsecs = (5 + i % 8) * NSEC_PER_MSEC;
+        service->last_beat_nsecs = start;
+        if (i % HANG_EVERY == 0) {
+            service->hang_at_nsecs = start + NSEC_PER_SEC / 2 + (i / HANG_EVERY) * 10 * NSEC_PER_MSEC;
+            service->stuck = (i == 0);
+            nhung++;
+        }
+
+        snprintf(names[i], sizeof(names[i]), "service%d", i);
+        memset(&config, 0, sizeof(config));
+        config.name = names[i];
+        config.deadline_nsecs = DEADLINE_PERIODS * service->period_nsecs;
+        config.actions = WD_CALLBACK | WD_RESTART | (service->stuck ? WD_LOG : 0);
+        config.callback = on_event;
+        config.restart = on_restart;
+        config.arg = service;
+        if ((service->slot = wd_register(&wd, &config)) == NULL) {
+            printf("watchdog_test: cannot register service %d\n", i);
+            exit(-1);
+        }
+    }
+
+    if (wd_start(&wd, scan_usecs * NSEC_PER_USEC, 50) < 0) {
+        perror("wd_start");
+        exit(-1);
+    }
+
+    for (i = 0; i < nservices; i++)
+        if (pthread_create(&services[i].thread, NULL, service_thread, &services[i]) != 0) {
+            perror("pthread_create");
+            exit(-1);
+        }
+
+    // stop the monitor first, so services that have exited are not reported
+    sleep_until(start + seconds * NSEC_PER_SEC);
+    wd_stop(&wd);
+    __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+    for (i = 0; i < nservices; i++) pthread_join(services[i].thread, NULL);
+
+    for (i = 0; i < nservices; i++) {
+        if (services[i].latency_nsecs == 0) continue;
+        latency[detected] = services[i].latency_nsecs;
+        over[detected] = services[i].latency_nsecs > wd.services[i].config.deadline_nsecs
+                             ? services[i].latency_nsecs - wd.services[i].config.deadline_nsecs
+                             : 0;
+        detected++;
+    }
+
+    printf("\n%d services, %d hung, scan every %d us, %llu scans at %.1lf us each\n", nservices, nhung, scan_usecs,
+        wd.scans, wd.scans ? (double)wd.scan_cost_nsecs / wd.scans / NSEC_PER_USEC : 0.0);
+    printf("detected %d of %d hangs, %llu restarts, %llu given up, %llu false alarms\n", detected, nhung, restarts,
+        gave_up, false_alarms);
+    if (false_alarms)
+        printf("healthy services missed real deadlines, %d services are more than %ld CPUs run on time\n", nservices,
+            sysconf(_SC_NPROCESSORS_ONLN));
+
+    if (detected) {
+        qsort(latency, detected, sizeof(unsigned long long), compare_ull);
+        qsort(over, detected, sizeof(unsigned long long), compare_ull);
+        printf("%-22s %10s %10s %10s %10s (us)\n", "", "min", "avg", "p99", "max");
+        printf("%-22s", "detection latency");
+        printf(" %10.1lf", (double)latency[0] / NSEC_PER_USEC);
+        for (i = 0, start = 0; i < detected; i++) start += latency[i];
+        printf(" %10.1lf %10.1lf %10.1lf\n", (double)start / detected / NSEC_PER_USEC,
+            (double)latency[(detected - 1) * 99 / 100] / NSEC_PER_USEC, (double)latency[detected - 1] / NSEC_PER_USEC);
+        printf("%-22s", "latency past deadline");
+        printf(" %10.1lf", (double)over[0] / NSEC_PER_USEC);
+        for (i = 0, start = 0; i < detected; i++) start += over[i];
+        printf(" %10.1lf %10.1lf %10.1lf\n", (double)start / detected / NSEC_PER_USEC,
+            (double)over[(detected - 1) * 99 / 100] / NSEC_PER_USEC, (double)over[detected - 1] / NSEC_PER_USEC);
+    }
+
+    free(services);
+    free(latency);
+    free(over);
+    return (detected == nhung && false_alarms == 0) ? 0 : 1;
+}
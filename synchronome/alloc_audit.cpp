@@ -0,0 +1,129 @@
+#ifdef ALLOC_AUDIT
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <execinfo.h>
+#include <unistd.h>
+
+#include "alloc_audit.hpp"
+
+extern "C"
+{
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AUDIT STATE
+///////////////////////////////////////////////////////////////////////////////
+
+static constexpr int sMaxFrames = 32;
+
+static thread_local bool tArmed = false;
+static thread_local bool tReporting = false;
+static std::atomic<uint64_t> sCount{0};
+
+///////////////////////////////////////////////////////////////////////////////
+// TOP LEVEL FUNCTIONS
+///////////////////////////////////////////////////////////////////////////////
+
+/// Records an allocation if the calling thread is armed. Nothing here may allocate, and `tReporting` stops any
+/// allocation made while reporting from being reported again.
+static void audit(const char *function, size_t size)
+{
+    if (!tArmed || tReporting)
+    {
+        return;
+    }
+    tReporting = true;
+    sCount.fetch_add(1, std::memory_order_relaxed);
+
+    char message[96];
+    int length = snprintf(message, sizeof(message), "AllocAudit: %s(%zu) on an armed thread\n", function, size);
+    write(STDERR_FILENO, message, length);
+    void *frames[sMaxFrames];
+    backtrace_symbols_fd(frames, backtrace(frames, sMaxFrames), STDERR_FILENO);
+
+#ifdef ALLOC_AUDIT_ABORT
+    abort();
+#endif
+    tReporting = false;
+}
+
+
+void allocAuditArm(void)
+{
+    // backtrace loads libgcc on first use, which allocates, so do that before the thread is armed.
+    void *frames[1];
+    backtrace(frames, 1);
+    tArmed = true;
+}
+
+
+void allocAuditDisarm(void) { tArmed = false; }
+
+
+uint64_t allocAuditCount(void) { return sCount.load(std::memory_order_relaxed); }
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ALLOCATOR REPLACEMENTS
+///////////////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+
+void *malloc(size_t size)
+{
+    audit("malloc", size);
+    return __libc_malloc(size);
+}
+
+
+void *calloc(size_t count, size_t size)
+{
+    audit("calloc", count * size);
+    return __libc_calloc(count, size);
+}
+
+
+void *realloc(void *ptr, size_t size)
+{
+    audit("realloc", size);
+    return __libc_realloc(ptr, size);
+}
+
+
+void *memalign(size_t alignment, size_t size)
+{
+    audit("memalign", size);
+    return __libc_memalign(alignment, size);
+}
+
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    audit("aligned_alloc", size);
+    return __libc_memalign(alignment, size);
+}
+
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    audit("posix_memalign", size);
+    void *p = __libc_memalign(alignment, size);
+    if (!p)
+    {
+        return ENOMEM;
+    }
+    *ptr = p;
+    return 0;
+}
+
+}
+
+#endif
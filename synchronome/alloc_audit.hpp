@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+/// Allocation audit for the real-time services, enabled by building with `make AUDIT=report` or `make AUDIT=abort`.
+/// The build replaces malloc and its relatives, which also covers operator new. Once a service thread has called
+/// `allocAuditArm`, after its warm-up frames, every allocation it makes is counted and reported on stderr with a
+/// backtrace, and with AUDIT=abort the process is aborted. In a normal build these functions do nothing.
+
+#ifdef ALLOC_AUDIT
+
+/// Starts auditing allocations made by the calling thread.
+void allocAuditArm(void);
+
+/// Stops auditing allocations made by the calling thread.
+void allocAuditDisarm(void);
+
+/// The number of allocations made by armed threads.
+uint64_t allocAuditCount(void);
+
+#else
+
+inline void allocAuditArm(void) {}
+
+inline void allocAuditDisarm(void) {}
+
+inline uint64_t allocAuditCount(void) { return 0; }
+
+#endif
@@ -14,19 +14,19 @@ void Camera::openDevice(std::string deviceName)
 
     if (-1 == stat(mDeviceName.c_str(), &st))
     {
-        errnoExit(std::string{"Cannot identify: "} + mDeviceName);
+        errnoExit("Cannot identify: ", mDeviceName.c_str());
     }
 
     if (!S_ISCHR(st.st_mode))
     {
-        errnoExit(std::string{"No device: "} + mDeviceName);
+        errnoExit("No device: ", mDeviceName.c_str());
     }
 
     mFd = open(mDeviceName.c_str(), O_RDWR | O_NONBLOCK, 0);
 
     if (-1 == mFd)
     {
-        errnoExit(std::string{"Cannot open: "} + mDeviceName);
+        errnoExit("Cannot open: ", mDeviceName.c_str());
     }
 }
 
@@ -43,7 +43,7 @@ void Camera::initMmap(void)
     {
         if (EINVAL == errno)
         {
-            errnoExit(std::string{"Device does not support memory mapping: "} + mDeviceName);
+            errnoExit("Device does not support memory mapping: ", mDeviceName.c_str());
         }
         else
         {
@@ -53,7 +53,7 @@ void Camera::initMmap(void)
 
     if (req.count < 2)
     {
-        errnoExit(std::string{"Insufficient buffer memory: "} + mDeviceName);
+        errnoExit("Insufficient buffer memory: ", mDeviceName.c_str());
     }
 
     mNumBuffers = req.count;
@@ -95,7 +95,7 @@ void Camera::initDevice(void)
     {
         if (EINVAL == errno)
         {
-            errnoExit(std::string{"No V4L2 device: "} + mDeviceName);
+            errnoExit("No V4L2 device: ", mDeviceName.c_str());
         }
         else
         {
@@ -105,12 +105,12 @@ void Camera::initDevice(void)
 
     if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE))
     {
-        errnoExit(std::string{"No video capture device: "} + mDeviceName);
+        errnoExit("No video capture device: ", mDeviceName.c_str());
     }
 
     if (!(cap.capabilities & V4L2_CAP_STREAMING))
     {
-        errnoExit(std::string{"No streaming support: "} + mDeviceName);
+        errnoExit("No streaming support: ", mDeviceName.c_str());
     }
 
     // Select video input, video standard and tune here.
@@ -230,33 +230,33 @@ void Camera::stopCapturing(void)
 }
 
 
-std::unique_ptr<BufferHandler> Camera::readFrame(void)
+bool Camera::readFrame(BufferHandler &handler)
 {
-    std::unique_ptr<BufferHandler> handler = std::make_unique<BufferHandler>(mFmt, mFd);
-    clear(handler->mBuf);
+    handler = BufferHandler{mFmt, mFd};
+    clear(handler.mBuf);
 
-    handler->mBuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    handler->mBuf.memory = V4L2_MEMORY_MMAP;
+    handler.mBuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    handler.mBuf.memory = V4L2_MEMORY_MMAP;
 
-    if (-1 == xioctl(mFd, VIDIOC_DQBUF, &(handler->mBuf)))
+    if (-1 == xioctl(mFd, VIDIOC_DQBUF, &handler.mBuf))
     {
         switch (errno)
         {
         case EAGAIN:
-            return nullptr;
+            return false;
         case EIO:
             // Could ignore EIO, but drivers should only set for serious errors, although some
             // set for non-fatal errors too.
-            return nullptr;
+            return false;
         default:
             errnoExit("Read frame failure");
         }
     }
 
-    assert(handler->mBuf.index < mNumBuffers);
-    handler->mStart = mBuffers[handler->mBuf.index].start;
-    handler->mSize = handler->mBuf.bytesused;
-    return handler;
+    assert(handler.mBuf.index < mNumBuffers);
+    handler.mStart = mBuffers[handler.mBuf.index].start;
+    handler.mSize = handler.mBuf.bytesused;
+    return true;
 }
 
 
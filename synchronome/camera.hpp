@@ -1,7 +1,6 @@
 #pragma once
 
 #include <linux/videodev2.h>
-#include <memory>
 #include <sys/select.h>
 
 #include "buffer_handler.hpp"
@@ -63,9 +62,9 @@ public:
     /// Tell the video driver to turn the stream off.
     void stopCapturing(void);
 
-    /// Reads a frame from the video driver. When the unique ptr is destroyed, the destructor fo the buffer handler
-    /// object places the buffer back on the queue.
-    std::unique_ptr<BufferHandler> readFrame(void);
+    /// Reads a frame from the video driver into `handler`, returns false if no frame was ready. Call
+    /// `BufferHandler::returnBuffer` to place the buffer back on the queue. Nothing is allocated per frame.
+    bool readFrame(BufferHandler &handler);
 
     /// Wait til the file descriptor is ready for a read/write without blocking.
     bool waitTilReady(void);
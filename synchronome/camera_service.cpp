@@ -10,7 +10,7 @@ void CameraService::start(const Config &cfg)
 }
 
 
-void CameraService::startCamera(std::string deviceName)
+void CameraService::startCamera(const std::string &deviceName)
 {
     mCamera.openDevice(deviceName);
     mCamera.initDevice();
@@ -43,10 +43,10 @@ void CameraService::service(void)
             continue;
         }
 
-        auto bufferPtr = mCamera.readFrame();
-        if (bufferPtr)
+        BufferHandler buffer;
+        if (mCamera.readFrame(buffer))
         {
-            int rc = mq_send(mymq, reinterpret_cast<char *>(bufferPtr.get()), sizeof(BufferHandler), 30U);
+            int rc = mq_send(mymq, reinterpret_cast<char *>(&buffer), sizeof(BufferHandler), 30U);
             struct timespec timeError;
             if (nanosleep(&readDelay, &timeError) != 0)
             {
@@ -59,6 +59,7 @@ void CameraService::service(void)
                 syslog(LOG_CRIT, "Frame read at %lf, @ %lf FPS\n", delta, rate);
             }
             ++count;
+            countFrame();
         }
     }
     syslog(LOG_CRIT, "CameraService: exiting");
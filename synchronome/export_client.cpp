@@ -0,0 +1,146 @@
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+#include "popl.hpp"
+
+#include "frame_export.hpp"
+#include "util.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// TOP LEVEL FUNCTIONS
+///////////////////////////////////////////////////////////////////////////////
+
+/// Receives the hello message and the ring's memfd from the export service.
+static int receiveHello(int sock, ExportHello &hello)
+{
+    struct iovec iov;
+    iov.iov_base = &hello;
+    iov.iov_len = sizeof(hello);
+
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    clear(msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t size = recvmsg(sock, &msg, 0);
+    if (size == -1)
+    {
+        errnoExit("recvmsg");
+    }
+    if (size != sizeof(hello) || hello.mMagic != sExportMagic)
+    {
+        printf("Bad hello from export service\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+    {
+        printf("No ring descriptor from export service\n");
+        exit(EXIT_FAILURE);
+    }
+    int fd;
+    std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+
+/// Connects to a running synchronome export socket, copies out every frame it is notified of and prints the
+/// delivered frame rate, latency from the tick detector and the number of frames it lost each second. Use `-s` to
+/// sleep after each frame to emulate a slow viewer.
+int main(int argc, char **argv)
+{
+    using namespace popl;
+    OptionParser op("Allowed options");
+    auto socketOpt = op.add<Value<std::string>>("x", "export", "Export socket path", "/tmp/synchronome.sock");
+    auto sleepOpt = op.add<Value<int>>("s", "sleep", "Milliseconds to sleep after each frame", 0);
+    auto helpOpt = op.add<Switch>("h", "help", "Show help message");
+    op.parse(argc, argv);
+    if (helpOpt->is_set())
+    {
+        std::cout << op << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (sock == -1)
+    {
+        errnoExit("socket");
+    }
+    struct sockaddr_un addr;
+    clear(addr);
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketOpt->value().c_str(), sizeof(addr.sun_path) - 1);
+    if (-1 == connect(sock, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)))
+    {
+        errnoExit("connect");
+    }
+
+    ExportHello hello;
+    int ringFd = receiveHello(sock, hello);
+    void *base = mmap(nullptr, hello.mRingSize, PROT_READ, MAP_SHARED, ringFd, 0);
+    if (base == MAP_FAILED)
+    {
+        errnoExit("mmap");
+    }
+    ExportRing ring{base, hello.mNumSlots, hello.mSlotSize};
+    std::vector<uint8_t> frame(hello.mSlotSize);
+
+    struct timespec sleepTime;
+    sleepTime.tv_sec = sleepOpt->value() / 1000;
+    sleepTime.tv_nsec = (sleepOpt->value() % 1000) * 1000000L;
+
+    uint64_t expected = 0;
+    bool first = true;
+    unsigned int delivered = 0, missed = 0, torn = 0;
+    double latencySum = 0.0, latencyMax = 0.0;
+    double reportTime = floatTime();
+
+    ExportNotice notice;
+    while (recv(sock, &notice, sizeof(notice), 0) == sizeof(notice))
+    {
+        if (!first && notice.mFrameNumber > expected)
+        {
+            missed += notice.mFrameNumber - expected;
+        }
+        first = false;
+        expected = notice.mFrameNumber + 1;
+
+        if (ring.read(notice.mSlot, notice.mSlotSeq, frame.data(), notice.mSize))
+        {
+            double latency = floatTime() - notice.mFrameTime;
+            latencySum += latency;
+            latencyMax = latency > latencyMax ? latency : latencyMax;
+            ++delivered;
+        }
+        else
+        {
+            ++torn;
+        }
+
+        if (sleepTime.tv_sec || sleepTime.tv_nsec)
+        {
+            nanosleep(&sleepTime, nullptr);
+        }
+
+        double now = floatTime();
+        if (now - reportTime >= 1.0)
+        {
+            double mean = delivered ? latencySum / delivered : 0.0;
+            printf("%.2f FPS, latency mean %.3f ms max %.3f ms, missed %u, overwritten %u\n",
+                delivered / (now - reportTime), 1000.0 * mean, 1000.0 * latencyMax, missed, torn);
+            delivered = missed = torn = 0;
+            latencySum = latencyMax = 0.0;
+            reportTime = now;
+        }
+    }
+
+    printf("Export service closed the connection\n");
+    return EXIT_SUCCESS;
+}
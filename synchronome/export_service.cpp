@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include "export_service.hpp"
+#include "util.hpp"
+
+
+void ExportService::start(const Config &cfg)
+{
+    mConfig = cfg;
+    mSubscribers.reserve(sMaxSubscribers);
+
+    mRingSize = ExportRing::ringSize(sNumRingSlots, mConfig.frameSize);
+    mRingFd = memfd_create("synchronome_export", MFD_CLOEXEC);
+    if (mRingFd == -1)
+    {
+        errnoExit("ExportService: memfd_create");
+    }
+    if (-1 == ftruncate(mRingFd, mRingSize))
+    {
+        errnoExit("ExportService: ftruncate");
+    }
+    void *base = mmap(nullptr, mRingSize, PROT_READ | PROT_WRITE, MAP_SHARED, mRingFd, 0);
+    if (base == MAP_FAILED)
+    {
+        errnoExit("ExportService: mmap");
+    }
+    mRing = ExportRing{base, sNumRingSlots, mConfig.frameSize};
+
+    mListenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (mListenFd == -1)
+    {
+        errnoExit("ExportService: socket");
+    }
+    struct sockaddr_un addr;
+    clear(addr);
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, mConfig.socketPath, sizeof(addr.sun_path) - 1);
+    unlink(mConfig.socketPath);
+    if (-1 == bind(mListenFd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)))
+    {
+        errnoExit("ExportService: bind");
+    }
+    if (-1 == listen(mListenFd, sMaxSubscribers))
+    {
+        errnoExit("ExportService: listen");
+    }
+
+    Service::start(Service::staticService<ExportService>, cfg.priority, this);
+}
+
+
+void ExportService::service(void)
+{
+    syslog(LOG_CRIT, "ExportService: publishing on %s\n", mConfig.socketPath);
+    mqd_t mymq = mq_open(mConfig.queue, O_CREAT | O_RDWR, S_IRWXU, &mConfig.mqAttr);
+
+    while (!doExit())
+    {
+        acceptSubscribers();
+
+        FrameIndex index;
+        unsigned int prio;
+        struct timespec receiveTimeout;
+        clock_gettime(CLOCK_REALTIME, &receiveTimeout);
+        receiveTimeout.tv_sec += 1;
+        int rc = mq_timedreceive(mymq, reinterpret_cast<char *>(&index), sizeof(FrameIndex), &prio, &receiveTimeout);
+        if (rc == -1)
+        {
+            if (errno == ETIMEDOUT)
+            {
+                continue;
+            }
+            perror("ExportService: receive");
+            break;
+        }
+
+        FrameHandle frame = mConfig.pool->adopt(index);
+        publish(frame, index.mSendTime);
+        countFrame();
+    }
+
+    for (int fd : mSubscribers)
+    {
+        close(fd);
+    }
+    close(mListenFd);
+    unlink(mConfig.socketPath);
+    syslog(LOG_CRIT, "ExportService: exiting, published %llu frames, dropped %llu notices",
+        static_cast<unsigned long long>(mFrameNumber), static_cast<unsigned long long>(mDropped));
+}
+
+
+void ExportService::acceptSubscribers(void)
+{
+    while (mSubscribers.size() < sMaxSubscribers)
+    {
+        int fd = accept4(mListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1)
+        {
+            return;
+        }
+
+        ExportHello hello;
+        hello.mMagic = sExportMagic;
+        hello.mNumSlots = sNumRingSlots;
+        hello.mSlotSize = mConfig.frameSize;
+        hello.mRingSize = mRingSize;
+
+        struct iovec iov;
+        iov.iov_base = &hello;
+        iov.iov_len = sizeof(hello);
+
+        alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        struct msghdr msg;
+        clear(msg);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &mRingFd, sizeof(int));
+
+        if (-1 == sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL))
+        {
+            close(fd);
+            continue;
+        }
+        mSubscribers.push_back(fd);
+        syslog(LOG_CRIT, "ExportService: subscriber connected, %zu total\n", mSubscribers.size());
+    }
+}
+
+
+void ExportService::publish(const FrameHandle &frame, double frameTime)
+{
+    ExportNotice notice;
+    notice.mFrameNumber = mFrameNumber;
+    notice.mSlot = mFrameNumber % sNumRingSlots;
+    notice.mSize = frame.size();
+    notice.mIsTick = frame.isTick();
+    notice.mFrameTime = frameTime;
+    notice.mSlotSeq = mRing.write(mFrameNumber, frame.data(), frame.size());
+    ++mFrameNumber;
+
+    auto failed = [this, &notice](int fd)
+    {
+        if (-1 != send(fd, &notice, sizeof(notice), MSG_DONTWAIT | MSG_NOSIGNAL))
+        {
+            return false;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            ++mDropped;
+            return false;
+        }
+        close(fd);
+        return true;
+    };
+    mSubscribers.erase(std::remove_if(mSubscribers.begin(), mSubscribers.end(), failed), mSubscribers.end());
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <mqueue.h>
+#include <vector>
+
+#include "frame_export.hpp"
+#include "frame_pool.hpp"
+#include "service.hpp"
+
+
+/// Publishes frames to local viewers. Frames arrive as shared FrameHandle references on a message queue, are copied
+/// into a ring in a memfd that subscribers map, and a notice is sent to each subscriber without blocking. A subscriber
+/// that falls behind misses notices or finds its slot overwritten, it never slows down the pipeline.
+class ExportService final : public Service
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    // PUBLIC CONSTANTS
+    ///////////////////////////////////////////////////////////////////////////
+
+    static constexpr size_t sNumRingSlots = 4;
+    static constexpr size_t sMaxSubscribers = 8;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PUBLIC TYPES
+    ///////////////////////////////////////////////////////////////////////////
+
+    struct Config
+    {
+        struct mq_attr mqAttr;
+        unsigned int priority;
+        size_t frameSize;
+        const char *queue;
+        const char *socketPath;
+        FramePool *pool;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS
+    ///////////////////////////////////////////////////////////////////////////
+
+    /// Creates the ring and the listening socket, then starts the service.
+    void start(const Config &cfg);
+
+    /// The service routine that is executed when the thread is started.
+    void service(void);
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // PRIVATE FUNCTIONS
+    ///////////////////////////////////////////////////////////////////////////
+
+    /// Accepts any pending connections and sends each new subscriber the ring's memfd.
+    void acceptSubscribers(void);
+
+    /// Copies the frame into the ring and notifies every subscriber.
+    void publish(const FrameHandle &frame, double frameTime);
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PRIVATE FIELDS
+    ///////////////////////////////////////////////////////////////////////////
+
+    Config mConfig;
+    int mListenFd{-1};
+    int mRingFd{-1};
+    size_t mRingSize{0};
+    ExportRing mRing;
+    std::vector<int> mSubscribers;
+    uint64_t mFrameNumber{0};
+    uint64_t mDropped{0};
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/// Wire format shared by the ExportService and its subscribers. A subscriber connects to the service's Unix-domain
+/// SOCK_SEQPACKET socket and receives an ExportHello carrying the ring's memfd through SCM_RIGHTS. After that it
+/// receives one ExportNotice per published frame.
+
+static constexpr uint32_t sExportMagic = 0x53594e43U;
+
+struct ExportHello
+{
+    uint32_t mMagic;
+    uint32_t mNumSlots;
+    uint64_t mSlotSize;
+    uint64_t mRingSize;
+};
+
+
+struct ExportNotice
+{
+    uint64_t mFrameNumber;
+    uint64_t mSlotSeq;
+    uint32_t mSlot;
+    uint32_t mSize;
+    bool mIsTick;
+    double mFrameTime;
+};
+
+
+/// A view over the shared ring of exported frames. Each slot is guarded by a sequence lock: the writer makes the
+/// sequence odd while it copies a frame in and even when it is done. A reader copies the frame out and then checks that
+/// the sequence still matches the one in the notice, so a slow reader drops an overwritten frame and never holds up
+/// the writer.
+class ExportRing
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    // PUBLIC TYPES
+    ///////////////////////////////////////////////////////////////////////////
+
+    struct alignas(64) SlotHeader
+    {
+        std::atomic<uint64_t> mSeq;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS
+    ///////////////////////////////////////////////////////////////////////////
+
+    static size_t ringSize(size_t numSlots, size_t slotSize) { return numSlots * (sizeof(SlotHeader) + slotSize); }
+
+    ExportRing() = default;
+
+    ExportRing(void *base, size_t numSlots, size_t slotSize)
+        : mHeaders(reinterpret_cast<SlotHeader *>(base)),
+          mData(reinterpret_cast<uint8_t *>(base) + numSlots * sizeof(SlotHeader)), mNumSlots(numSlots),
+          mSlotSize(slotSize)
+    {
+    }
+
+    /// Copies a frame into the slot for `frameNumber` and returns the sequence value readers should expect.
+    uint64_t write(uint64_t frameNumber, const uint8_t *src, size_t size)
+    {
+        size_t slot = frameNumber % mNumSlots;
+        uint64_t seq = 2 * (frameNumber + 1);
+        mHeaders[slot].mSeq.store(seq - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(slotData(slot), src, size < mSlotSize ? size : mSlotSize);
+        mHeaders[slot].mSeq.store(seq, std::memory_order_release);
+        return seq;
+    }
+
+    /// Copies a frame out of `slot`. Returns false if the writer has reused the slot since `seq` was published.
+    bool read(size_t slot, uint64_t seq, uint8_t *dest, size_t size) const
+    {
+        if (mHeaders[slot].mSeq.load(std::memory_order_acquire) != seq)
+        {
+            return false;
+        }
+        std::memcpy(dest, slotData(slot), size < mSlotSize ? size : mSlotSize);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return mHeaders[slot].mSeq.load(std::memory_order_relaxed) == seq;
+    }
+
+    size_t numSlots(void) const { return mNumSlots; }
+
+    size_t slotSize(void) const { return mSlotSize; }
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // PRIVATE FUNCTIONS
+    ///////////////////////////////////////////////////////////////////////////
+
+    uint8_t *slotData(size_t slot) const { return mData + slot * mSlotSize; }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PRIVATE FIELDS
+    ///////////////////////////////////////////////////////////////////////////
+
+    SlotHeader *mHeaders{nullptr};
+    uint8_t *mData{nullptr};
+    size_t mNumSlots{0};
+    size_t mSlotSize{0};
+};
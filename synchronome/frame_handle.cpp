@@ -0,0 +1,82 @@
+#include "frame_handle.hpp"
+#include "frame_pool.hpp"
+#include "util.hpp"
+
+
+FrameHandle &FrameHandle::operator=(FrameHandle &&other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        mPool = other.mPool;
+        mIndex = other.mIndex;
+        other.mPool = nullptr;
+    }
+    return *this;
+}
+
+
+FrameHandle FrameHandle::share() const
+{
+    if (!mPool)
+    {
+        return FrameHandle{};
+    }
+    mPool->acquire(mIndex);
+    return FrameHandle{mPool, mIndex};
+}
+
+
+void FrameHandle::reset(void)
+{
+    if (mPool)
+    {
+        mPool->release(mIndex);
+        mPool = nullptr;
+    }
+}
+
+
+FrameIndex FrameHandle::detach(void)
+{
+    FrameIndex index;
+    index.mIndex = mIndex;
+    index.mSendTime = floatTime();
+    mPool = nullptr;
+    return index;
+}
+
+
+uint8_t *FrameHandle::data(void) const { return mPool->data(mIndex); }
+
+
+size_t FrameHandle::size(void) const { return mPool->slot(mIndex).mSize; }
+
+
+void FrameHandle::setSize(size_t size) { mPool->slot(mIndex).mSize = size; }
+
+
+bool FrameHandle::isTick(void) const { return mPool->slot(mIndex).mIsTick; }
+
+
+void FrameHandle::setTick(bool isTick) { mPool->slot(mIndex).mIsTick = isTick; }
+
+
+double FrameHandle::timestamp(void) const { return mPool->slot(mIndex).mTimestamp; }
+
+
+void FrameHandle::setTimestamp(double timestamp) { mPool->slot(mIndex).mTimestamp = timestamp; }
+
+
+double FrameHandle::tickTime(void) const { return mPool->slot(mIndex).mTickTime; }
+
+
+double FrameHandle::tickError(void) const { return mPool->slot(mIndex).mTickError; }
+
+
+void FrameHandle::setTickTime(double time, double error)
+{
+    FramePool::Slot &s = mPool->slot(mIndex);
+    s.mTickTime = time;
+    s.mTickError = error;
+}
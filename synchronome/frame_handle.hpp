@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class FramePool;
+
+/// The trivially copyable form of a FrameHandle that is sent through the message queues. It carries the reference
+/// that the sender gave up with `FrameHandle::detach`, and the receiver takes it back with `FramePool::adopt`. Only the
+/// pool index is sent, so it stays valid when the sender and the receiver are different processes.
+struct FrameIndex
+{
+    uint32_t mIndex;
+    double mSendTime;
+};
+
+
+/// A move-only reference to a buffer in a FramePool. Use `share` to give another part of the application its own
+/// reference to the same buffer. The buffer goes back to the pool when the last reference is released, so it can't be
+/// returned twice or leaked by forgetting to return it.
+class FrameHandle
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS
+    ///////////////////////////////////////////////////////////////////////////
+
+    FrameHandle() = default;
+
+    FrameHandle(const FrameHandle &) = delete;
+
+    FrameHandle &operator=(const FrameHandle &) = delete;
+
+    FrameHandle(FrameHandle &&other) noexcept : mPool(other.mPool), mIndex(other.mIndex) { other.mPool = nullptr; }
+
+    FrameHandle &operator=(FrameHandle &&other) noexcept;
+
+    ~FrameHandle() { reset(); }
+
+    /// Returns a new reference to the same buffer.
+    FrameHandle share() const;
+
+    /// Releases this reference. The buffer is returned to the pool if it was the last one.
+    void reset(void);
+
+    /// Gives up this reference without releasing it so it can be sent through a queue. The receiver must `adopt` it.
+    FrameIndex detach(void);
+
+    explicit operator bool() const { return mPool != nullptr; }
+
+    uint8_t *data(void) const;
+
+    size_t size(void) const;
+
+    void setSize(size_t size);
+
+    bool isTick(void) const;
+
+    void setTick(bool isTick);
+
+    /// The capture time from the camera driver, in seconds.
+    double timestamp(void) const;
+
+    void setTimestamp(double timestamp);
+
+    /// The estimated tick instant and its error bound, in seconds, for frames flagged as ticks.
+    double tickTime(void) const;
+
+    double tickError(void) const;
+
+    void setTickTime(double time, double error);
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // PRIVATE FUNCTIONS
+    ///////////////////////////////////////////////////////////////////////////
+
+    friend class FramePool;
+
+    /// Only the pool creates handles, and the caller must already hold the reference this handle takes over.
+    FrameHandle(FramePool *pool, uint32_t index) : mPool(pool), mIndex(index) {}
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PRIVATE FIELDS
+    ///////////////////////////////////////////////////////////////////////////
+
+    FramePool *mPool{nullptr};
+    uint32_t mIndex{0U};
+};
@@ -0,0 +1,160 @@
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include "frame_pool.hpp"
+#include "util.hpp"
+
+
+void FramePool::create(const char *name, size_t slotSize, size_t numSlots)
+{
+    if (numSlots > sMaxSlots)
+    {
+        printf("FramePool: %zu slots requested, at most %zu are supported\n", numSlots, sMaxSlots);
+        exit(EXIT_FAILURE);
+    }
+
+    mName = name;
+    shm_unlink(mName);
+    int fd = shm_open(mName, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd == -1)
+    {
+        errnoExit("FramePool: shm_open");
+    }
+
+    size_t size = headerSize() + slotSize * numSlots;
+    if (-1 == ftruncate(fd, size))
+    {
+        errnoExit("FramePool: ftruncate");
+    }
+    map(fd, size);
+    mHeader = new (mHeader) Header;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&mHeader->mMutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    mHeader->mSlotSize = slotSize;
+    mHeader->mNumSlots = numSlots;
+    mHeader->mNumFree = numSlots;
+    for (uint32_t i = 0; i < numSlots; ++i)
+    {
+        mHeader->mFree[i] = numSlots - 1 - i;
+        mHeader->mSlots[i].mRefs.store(0, std::memory_order_relaxed);
+        mHeader->mSlots[i].mSize = 0;
+        mHeader->mSlots[i].mIsTick = false;
+    }
+}
+
+
+void FramePool::attach(const char *name)
+{
+    mName = name;
+    int fd = shm_open(mName, O_RDWR, 0);
+    if (fd == -1)
+    {
+        errnoExit("FramePool: shm_open");
+    }
+
+    struct stat st;
+    if (-1 == fstat(fd, &st))
+    {
+        errnoExit("FramePool: fstat");
+    }
+    map(fd, st.st_size);
+}
+
+
+void FramePool::detach(void)
+{
+    if (mHeader && -1 == munmap(mHeader, mMapSize))
+    {
+        errnoExit("FramePool: munmap");
+    }
+    mHeader = nullptr;
+    mSlots = nullptr;
+    mMapSize = 0;
+}
+
+
+void FramePool::unlink(void)
+{
+    if (mName)
+    {
+        shm_unlink(mName);
+    }
+}
+
+
+FrameHandle FramePool::allocate(void)
+{
+    pthread_mutex_lock(&mHeader->mMutex);
+    if (mHeader->mNumFree == 0)
+    {
+        pthread_mutex_unlock(&mHeader->mMutex);
+        return FrameHandle{};
+    }
+    uint32_t index = mHeader->mFree[--mHeader->mNumFree];
+    pthread_mutex_unlock(&mHeader->mMutex);
+
+    Slot &s = slot(index);
+    s.mSize = 0;
+    s.mIsTick = false;
+    s.mTimestamp = 0.0;
+    s.mTickTime = 0.0;
+    s.mTickError = 0.0;
+    s.mRefs.store(1, std::memory_order_relaxed);
+    return FrameHandle{this, index};
+}
+
+
+FrameHandle FramePool::adopt(const FrameIndex &index)
+{
+    if (index.mIndex >= mHeader->mNumSlots || slot(index.mIndex).mRefs.load(std::memory_order_relaxed) == 0)
+    {
+        syslog(LOG_CRIT, "FramePool: adopted buffer %u that is not in use.", index.mIndex);
+        exit(EXIT_FAILURE);
+    }
+    return FrameHandle{this, index.mIndex};
+}
+
+
+void FramePool::acquire(uint32_t index) { slot(index).mRefs.fetch_add(1, std::memory_order_relaxed); }
+
+
+void FramePool::release(uint32_t index)
+{
+    uint32_t refs = slot(index).mRefs.fetch_sub(1, std::memory_order_acq_rel);
+    if (refs == 0)
+    {
+        syslog(LOG_CRIT, "FramePool: buffer %u released with no references.", index);
+        exit(EXIT_FAILURE);
+    }
+    if (refs > 1)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&mHeader->mMutex);
+    mHeader->mFree[mHeader->mNumFree++] = index;
+    pthread_mutex_unlock(&mHeader->mMutex);
+}
+
+
+void FramePool::map(int fd, size_t size)
+{
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        errnoExit("FramePool: mmap");
+    }
+    mMapSize = size;
+    mHeader = reinterpret_cast<Header *>(addr);
+    mSlots = reinterpret_cast<uint8_t *>(addr) + headerSize();
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <pthread.h>
+
+#include "frame_handle.hpp"
+
+
+/// A pool of fixed size frame buffers that lives in POSIX shared memory. Each buffer has a reference count that is
+/// shared by every FrameHandle to it, in any process, and the buffer goes back on the free list when the count drops
+/// to zero. The free list is protected by a process shared mutex.
+class FramePool final
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    // PUBLIC CONSTANTS
+    ///////////////////////////////////////////////////////////////////////////
+
+    static constexpr size_t sMaxSlots = 64;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS
+    ///////////////////////////////////////////////////////////////////////////
+
+    /// Creates the shared memory object `name`, sizes it for `numSlots` buffers of `slotSize` bytes and marks every
+    /// buffer as available.
+    void create(const char *name, size_t slotSize, size_t numSlots);
+
+    /// Maps a pool that was created by another process.
+    void attach(const char *name);
+
+    /// Unmaps the pool from this process.
+    void detach(void);
+
+    /// Removes the name of the shared memory object. Processes that have the pool mapped keep their mapping.
+    void unlink(void);
+
+    /// Get a buffer from the pool with a reference count of one. The handle is empty if no buffers are available.
+    FrameHandle allocate(void);
+
+    /// Takes over the reference carried by an index received from a queue.
+    FrameHandle adopt(const FrameIndex &index);
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // PRIVATE TYPES
+    ///////////////////////////////////////////////////////////////////////////
+
+    friend class FrameHandle;
+
+    /// Per buffer state that is shared by all the handles to it.
+    struct Slot
+    {
+        std::atomic<uint32_t> mRefs;
+        size_t mSize;
+        bool mIsTick;
+        double mTimestamp;
+        double mTickTime;
+        double mTickError;
+    };
+
+    /// Placed at the start of the shared memory object, the buffers follow it.
+    struct Header
+    {
+        pthread_mutex_t mMutex;
+        size_t mSlotSize;
+        uint32_t mNumSlots;
+        uint32_t mNumFree;
+        uint32_t mFree[sMaxSlots];
+        Slot mSlots[sMaxSlots];
+    };
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "Reference counts must be lock free to be shared");
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PRIVATE FUNCTIONS
+    ///////////////////////////////////////////////////////////////////////////
+
+    /// The header is rounded up to a cache line so the buffers are aligned.
+    static constexpr size_t headerSize() { return (sizeof(Header) + 63) & ~static_cast<size_t>(63); }
+
+    void map(int fd, size_t size);
+
+    /// Adds a reference to a buffer that is already in use.
+    void acquire(uint32_t index);
+
+    /// Drops a reference and puts the buffer back on the free list if it was the last.
+    void release(uint32_t index);
+
+    uint8_t *data(uint32_t index) const { return mSlots + index * mHeader->mSlotSize; }
+
+    Slot &slot(uint32_t index) { return mHeader->mSlots[index]; }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PRIVATE FIELDS
+    ///////////////////////////////////////////////////////////////////////////
+
+    const char *mName{nullptr};
+    Header *mHeader{nullptr};
+    uint8_t *mSlots{nullptr};
+    size_t mMapSize{0};
+};
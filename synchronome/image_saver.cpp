@@ -38,7 +38,7 @@ int ImageSaver::dumpPgm(const void *p, int size) const
 }
 
 
-int ImageSaver::dumpPpm(const void *p, int size) const
+int ImageSaver::dumpPpm(const void *p, int size, const FrameTimes &times) const
 {
     double fnow = floatTime();
 
@@ -50,11 +50,19 @@ int ImageSaver::dumpPpm(const void *p, int size) const
         errnoExit("Failed to open file");
     }
 
-    char header[64];
-    long seconds = std::lround(fnow);
-    long milliseconds = std::lround(1000.0 * (fnow - static_cast<double>(seconds)));
-    int headerSize =
-        snprintf(header, sizeof(header), "P6\n#%010d sec %010d msec \n %d %d \n255\n", seconds, milliseconds, 640, 480);
+    char header[192];
+    // Rounded as a whole so 999.6 ms carries into the seconds rather than printing 1000 msec.
+    long long totalMilliseconds = std::llround(1000.0 * fnow);
+    long seconds = static_cast<long>(totalMilliseconds / 1000);
+    long milliseconds = static_cast<long>(totalMilliseconds % 1000);
+    int headerSize = snprintf(header, sizeof(header), "P6\n#%010ld sec %010ld msec \n#capture %.6lf sec \n", seconds,
+        milliseconds, times.capture);
+    if (times.tick)
+    {
+        headerSize += snprintf(header + headerSize, sizeof(header) - headerSize, "#tick %.6lf +- %.6lf sec \n",
+            times.tickTime, times.tickError);
+    }
+    headerSize += snprintf(header + headerSize, sizeof(header) - headerSize, " %d %d \n255\n", 640, 480);
 
     write(dumpfd, header, headerSize);
     int total = 0;
@@ -68,11 +76,10 @@ int ImageSaver::dumpPpm(const void *p, int size) const
 }
 
 
-void ImageSaver::processImage(const uint8_t *p, int size, double startTime)
+void ImageSaver::processImage(const uint8_t *p, int size, double startTime, const FrameTimes &times)
 {
-    double fnow = floatTime();
     mFrameCount++;
     syslog(LOG_CRIT, "ImageSaver: Processing frame %d: ", mFrameCount);
-    int total = dumpPpm(p, size);
+    int total = dumpPpm(p, size, times);
     syslog(LOG_CRIT, "ImageSaver: Frame written to flash at %lf, %d bytes\n", (floatTime() - startTime), total);
 }
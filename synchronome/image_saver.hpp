@@ -15,6 +15,16 @@ public:
 
     using Timespec = struct timespec;
 
+    /// Capture time of a saved frame and, for tick frames, the estimated tick instant with its bound, all in the clock
+    /// of the V4L2 timestamps.
+    struct FrameTimes
+    {
+        double capture;
+        bool tick;
+        double tickTime;
+        double tickError;
+    };
+
     ///////////////////////////////////////////////////////////////////////////
     // PUBLIC FUNCTIONS
     ///////////////////////////////////////////////////////////////////////////
@@ -23,11 +33,13 @@ public:
     /// a time in seconds to add to the header of the image.
     int dumpPgm(const void *p, int size) const;
 
-    /// Writes the image pointed to by `p` to file using the ppm format. `size` is the number of bytes and fnow is
-    /// a time in seconds to add to the header of the image.
-    int dumpPpm(const void *p, int size) const;
+    /// Writes the image pointed to by `p` to file using the ppm format. `size` is the number of bytes. The header
+    /// keeps the time the frame is written as its first comment, followed by the capture time and, for tick frames,
+    /// the tick estimate from `times`.
+    int dumpPpm(const void *p, int size, const FrameTimes &times) const;
 
-    void processImage(const uint8_t *p, int size, double startTime);
+    /// Saves a frame with `times` in its header.
+    void processImage(const uint8_t *p, int size, double startTime, const FrameTimes &times);
 
 private:
     ///////////////////////////////////////////////////////////////////////////
@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <syslog.h>
 
 #include "image_saver_service.hpp"
-#include "rgb_handler.hpp"
+#include "frame_handle.hpp"
+#include "util.hpp"
 
 
 void ImageSaverService::start(const Config &cfg)
@@ -20,19 +22,33 @@ void ImageSaverService::service(void)
     while (count < mConfig.frameCount)
     {
         syslog(LOG_CRIT, "ImageSaverService: awaiting\n");
-        RgbHandler handler;
+        FrameIndex index;
         unsigned int prio;
-        int rc = mq_receive(mymq, reinterpret_cast<char *>(&handler), sizeof(RgbHandler), &prio);
+        int rc = mq_receive(mymq, reinterpret_cast<char *>(&index), sizeof(FrameIndex), &prio);
         if (rc == -1)
         {
             perror("mq_receive");
             break;
         }
-        if (handler.mIsTick || mConfig.saveAll)
+
+        double handoff = floatTime() - index.mSendTime;
+        mHandoffSum += handoff;
+        mHandoffMax = std::max(mHandoffMax, handoff);
+        ++mHandoffCount;
+
+        countFrame();
+        FrameHandle frame = mConfig.pool->adopt(index);
+        if (frame.isTick() || mConfig.saveAll)
         {
-            mSaver.processImage(handler.mStart, handler.mSize, mConfig.startTime);
+            ImageSaver::FrameTimes times{frame.timestamp(), frame.isTick(), frame.tickTime(), frame.tickError()};
+            mSaver.processImage(frame.data(), frame.size(), mConfig.startTime, times);
             ++count;
         }
-        handler.returnBuffer();
+    }
+
+    if (mHandoffCount > 0)
+    {
+        syslog(LOG_CRIT, "ImageSaverService: handoff latency mean %lf sec, max %lf sec over %zu frames\n",
+            mHandoffSum / static_cast<double>(mHandoffCount), mHandoffMax, mHandoffCount);
     }
 }
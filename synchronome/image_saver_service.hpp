@@ -2,6 +2,7 @@
 
 #include <mqueue.h>
 
+#include "frame_pool.hpp"
 #include "image_saver.hpp"
 #include "service.hpp"
 
@@ -21,6 +22,7 @@ public:
         unsigned int frameCount;
         const char *queue;
         bool saveAll;
+        FramePool *pool;
     };
 
     ///////////////////////////////////////////////////////////////////////////
@@ -40,4 +42,9 @@ private:
 
     Config mConfig;
     ImageSaver mSaver;
+
+    /// Time from the tick detector sending a frame to this service receiving it.
+    double mHandoffSum{0.0};
+    double mHandoffMax{0.0};
+    size_t mHandoffCount{0};
 };
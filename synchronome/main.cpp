@@ -1,6 +1,13 @@
+#include <semaphore.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include "popl.hpp"
 
+#include "alloc_audit.hpp"
 #include "camera_service.hpp"
+#include "export_service.hpp"
+#include "frame_pool.hpp"
 #include "image_saver_service.hpp"
 #include "tick_detector_service.hpp"
 
@@ -9,8 +16,12 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 static constexpr size_t sNumMessages = 40;
+static constexpr size_t sNumExportMessages = 4;
 static constexpr const char *sCameraQueue = "/camera_mq";
 static constexpr const char *sTickQueue = "/tick_mq";
+static constexpr const char *sExportQueue = "/export_mq";
+static constexpr const char *sRgbPoolName = "/synchronome_rgb";
+static constexpr const char *sExitSemName = "/synchronome_exit";
 
 ///////////////////////////////////////////////////////////////////////////////
 // SYSTEM COMPONENTS
@@ -19,12 +30,24 @@ static constexpr const char *sTickQueue = "/tick_mq";
 static CameraService sCameraService;
 static TickDetectorService sTickDetectorService;
 static ImageSaverService sImageSaverService;
+static ExportService sExportService;
+static FramePool sRgbPool;
 
 ///////////////////////////////////////////////////////////////////////////////
 // TOP LEVEL FUNCTIONS
 ///////////////////////////////////////////////////////////////////////////////
 
-static std::tuple<std::string, int> processCmdLineArgs(int argc, char **argv)
+struct Options
+{
+    std::string device;
+    int count;
+    bool multiProcess;
+    std::string exportSocket;
+    bool exportAll;
+};
+
+
+static Options processCmdLineArgs(int argc, char **argv)
 {
     using namespace popl;
     OptionParser op("Allowed options");
@@ -32,6 +55,10 @@ static std::tuple<std::string, int> processCmdLineArgs(int argc, char **argv)
     auto deviceOpt = op.add<Value<std::string>>("d", "device", "Camera device, eg. \"/dev/video0\"", "/dev/video0");
     auto helpOpt = op.add<Switch>("h", "help", "Show help message");
     auto countOpt = op.add<Value<int>>("c", "count", "Number of frames to grab", 100);
+    auto multiProcessOpt =
+        op.add<Switch>("m", "multiprocess", "Run the tick detector and image saver as separate processes");
+    auto exportOpt = op.add<Value<std::string>>("x", "export", "Publish tick frames on this Unix socket path");
+    auto exportAllOpt = op.add<Switch>("a", "export-all", "Publish every frame, not just ticks");
 
     op.parse(argc, argv);
 
@@ -46,17 +73,68 @@ static std::tuple<std::string, int> processCmdLineArgs(int argc, char **argv)
         exit(EXIT_SUCCESS);
     }
 
-    return std::make_tuple(deviceOpt->value(), countOpt->value());
+    Options options;
+    options.device = deviceOpt->value();
+    options.count = countOpt->value();
+    options.multiProcess = multiProcessOpt->is_set();
+    options.exportSocket = exportOpt->is_set() ? exportOpt->value() : std::string{};
+    options.exportAll = exportAllOpt->is_set();
+    return options;
+}
+
+
+/// Prints the allocation audit result for this process in audit builds.
+static void reportAllocAudit([[maybe_unused]] const char *process)
+{
+#ifdef ALLOC_AUDIT
+    unsigned long long count = allocAuditCount();
+    printf("AllocAudit: %s made %llu allocations on service threads after warm-up\n", process, count);
+    syslog(LOG_CRIT, "AllocAudit: %s made %llu allocations on service threads after warm-up\n", process, count);
+#endif
+}
+
+
+/// Forks a child process named `name` that runs `service`. If `exitSem` is given the child flags the service to exit
+/// once the semaphore is posted, otherwise the child exits when the service returns. Must be called before any service
+/// threads are started in the parent.
+template <typename S>
+static pid_t forkService(S &service, const typename S::Config &cfg, sem_t *exitSem, const char *name)
+{
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        errnoExit("fork");
+    }
+    if (pid == 0)
+    {
+        service.start(cfg);
+        if (exitSem)
+        {
+            while (sem_wait(exitSem) == -1 && errno == EINTR)
+            {
+            }
+            service.flagExit();
+        }
+        service.join();
+        reportAllocAudit(name);
+        _exit(EXIT_SUCCESS);
+    }
+    return pid;
 }
 
 
 int main(int argc, char **argv)
 {
-    const auto [device, count] = processCmdLineArgs(argc, argv);
+    const Options options = processCmdLineArgs(argc, argv);
+    const int count = options.count;
+    const bool multiProcess = options.multiProcess;
+    const bool exportFrames = !options.exportSocket.empty();
 
     mq_unlink(sCameraQueue);
     mq_unlink(sTickQueue);
-    sCameraService.startCamera(device);
+    mq_unlink(sExportQueue);
+    sRgbPool.create(sRgbPoolName, TickDetector::sBufferSize, TickDetector::sNumOfBuffers);
+    sCameraService.startCamera(options.device);
 
     // Service configuration.
     double startTime = floatTime();
@@ -68,9 +146,12 @@ int main(int argc, char **argv)
 
     struct mq_attr tickMqAttr;
     tickMqAttr.mq_maxmsg = sNumMessages;
-    tickMqAttr.mq_msgsize = sizeof(RgbHandler);
+    tickMqAttr.mq_msgsize = sizeof(FrameIndex);
     tickMqAttr.mq_flags = 0;
 
+    struct mq_attr exportMqAttr = tickMqAttr;
+    exportMqAttr.mq_maxmsg = sNumExportMessages;
+
     CameraService::Config cameraServiceCfg;
     cameraServiceCfg.mqAttr = cameraMqAttr;
     cameraServiceCfg.startTime = startTime;
@@ -85,6 +166,10 @@ int main(int argc, char **argv)
     tickDetectorServiceCfg.outQueue = sTickQueue;
     tickDetectorServiceCfg.tickDetectorConfig.showDiff = false;
     tickDetectorServiceCfg.tickDetectorConfig.startTime = startTime;
+    tickDetectorServiceCfg.tickDetectorConfig.pool = &sRgbPool;
+    tickDetectorServiceCfg.exportQueue = exportFrames ? sExportQueue : nullptr;
+    tickDetectorServiceCfg.exportMqAttr = exportMqAttr;
+    tickDetectorServiceCfg.exportAll = options.exportAll;
 
     ImageSaverService::Config imageSaverServiceCfg;
     imageSaverServiceCfg.mqAttr = tickMqAttr;
@@ -93,14 +178,54 @@ int main(int argc, char **argv)
     imageSaverServiceCfg.frameCount = count;
     imageSaverServiceCfg.saveAll = false;
     imageSaverServiceCfg.queue = sTickQueue;
+    imageSaverServiceCfg.pool = &sRgbPool;
+
+    ExportService::Config exportServiceCfg;
+    exportServiceCfg.mqAttr = exportMqAttr;
+    exportServiceCfg.priority = sched_get_priority_min(SCHED_FIFO);
+    exportServiceCfg.frameSize = TickDetector::sBufferSize;
+    exportServiceCfg.queue = sExportQueue;
+    exportServiceCfg.socketPath = options.exportSocket.c_str();
+    exportServiceCfg.pool = &sRgbPool;
+
+    // In multi-process mode the tick detector and image saver are forked before any threads are started. The
+    // children inherit the camera buffer mappings and the RGB pool, and RGB frames are passed by pool index.
+    sem_t *exitSem = nullptr;
+    pid_t tickDetectorPid = -1;
+    pid_t imageSaverPid = -1;
+    if (multiProcess)
+    {
+        sem_unlink(sExitSemName);
+        exitSem = sem_open(sExitSemName, O_CREAT, 0700, 0);
+        if (exitSem == SEM_FAILED)
+        {
+            errnoExit("sem_open");
+        }
+        tickDetectorPid = forkService(sTickDetectorService, tickDetectorServiceCfg, exitSem, "TickDetectorService");
+        imageSaverPid = forkService(sImageSaverService, imageSaverServiceCfg, nullptr, "ImageSaverService");
+    }
 
     // Start services.
     sCameraService.start(cameraServiceCfg);
-    sTickDetectorService.start(tickDetectorServiceCfg);
-    sImageSaverService.start(imageSaverServiceCfg);
+    if (exportFrames)
+    {
+        sExportService.start(exportServiceCfg);
+    }
+    if (!multiProcess)
+    {
+        sTickDetectorService.start(tickDetectorServiceCfg);
+        sImageSaverService.start(imageSaverServiceCfg);
+    }
 
     // Wait for the image saver service to join, then tell other services to terminate.
-    sImageSaverService.join();
+    if (multiProcess)
+    {
+        waitpid(imageSaverPid, nullptr, 0);
+    }
+    else
+    {
+        sImageSaverService.join();
+    }
 
     double stopTime = floatTime();
     double total = stopTime - startTime;
@@ -108,12 +233,31 @@ int main(int argc, char **argv)
     syslog(LOG_CRIT, "Total capture time=%lf, for %d frames, %lf FPS\n", total, count, rate);
 
     sCameraService.flagExit();
-    sTickDetectorService.flagExit();
+    if (multiProcess)
+    {
+        sem_post(exitSem);
+        waitpid(tickDetectorPid, nullptr, 0);
+        sem_close(exitSem);
+        sem_unlink(sExitSemName);
+    }
+    else
+    {
+        sTickDetectorService.flagExit();
+        sTickDetectorService.join();
+    }
     sCameraService.join();
-    sTickDetectorService.join();
+    if (exportFrames)
+    {
+        sExportService.flagExit();
+        sExportService.join();
+    }
 
     sCameraService.stopCamera();
+    sRgbPool.unlink();
+    sRgbPool.detach();
     mq_unlink(sCameraQueue);
     mq_unlink(sTickQueue);
+    mq_unlink(sExportQueue);
+    reportAllocAudit("synchronome");
     return 0;
 }
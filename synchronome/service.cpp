@@ -1,6 +1,7 @@
 #include <cstdio>
 #include <cstdlib>
 
+#include "alloc_audit.hpp"
 #include "service.hpp"
 #include "util.hpp"
 
@@ -41,3 +42,12 @@ bool Service::doExit()
     }
     return true;
 }
+
+
+void Service::countFrame(void)
+{
+    if (mFrames < sWarmupFrames && ++mFrames == sWarmupFrames)
+    {
+        allocAuditArm();
+    }
+}
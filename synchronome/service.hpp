@@ -13,6 +13,12 @@ public:
 
     using StartRoutine = void *(*)(void *);
 
+    ///////////////////////////////////////////////////////////////////////////
+    // PUBLIC CONSTANTS
+    ///////////////////////////////////////////////////////////////////////////
+
+    static constexpr unsigned int sWarmupFrames = 25;
+
     ///////////////////////////////////////////////////////////////////////////
     // PUBLIC FUNCTIONS
     ///////////////////////////////////////////////////////////////////////////
@@ -30,6 +36,10 @@ public:
     /// Checks the exit semaphore to determine if it should exit.
     bool doExit();
 
+    /// Call from the service routine once per frame. After the warm-up frames the service thread is armed for the
+    /// allocation audit, from then on it must not allocate.
+    void countFrame(void);
+
     template <typename T>
         requires requires(T t) { t.service(); }
     static void *staticService(void *args)
@@ -45,4 +55,5 @@ private:
 
     pthread_t mThread;
     sem_t mSemExit;
+    unsigned int mFrames{0};
 };
@@ -1,51 +1,14 @@
 #include <syslog.h>
+#include <utility>
 
 #include "tick_detector.hpp"
 #include "util.hpp"
 
 
-TickDetector::TickDetector()
-{
-    for (int i = 0; i < sNumOfBuffers; i++)
-    {
-        mAvailable.emplace(RgbHandler{&mBuffers[i][0], this});
-    }
-}
-
-
 void TickDetector::setConfig(const Config &cfg) { mConfig = cfg; }
 
 
-void TickDetector::returnBuffer(RgbHandler &handler)
-{
-    std::lock_guard<std::mutex> guard(mRgbQueueMutex);
-    if (handler.mStart)
-    {
-        handler.mIsTick = false;
-        mAvailable.push(handler);
-    }
-    if (mAvailable.size() > sNumOfBuffers)
-    {
-        syslog(LOG_CRIT, "Available queue has too many elements.");
-        exit(EXIT_FAILURE);
-    }
-}
-
-
-RgbHandler TickDetector::allocate(void)
-{
-    std::lock_guard<std::mutex> guard(mRgbQueueMutex);
-    if (mAvailable.empty())
-    {
-        return RgbHandler{};
-    }
-    RgbHandler rgb = mAvailable.front();
-    mAvailable.pop();
-    return rgb;
-}
-
-
-RgbHandler TickDetector::colorConvert(const BufferHandler &bufferHandler)
+FrameHandle TickDetector::colorConvert(const BufferHandler &bufferHandler)
 {
     syslog(LOG_CRIT, "TickDetector: Converting pixels %lf\n", floatTime() - mConfig.startTime);
     auto yuv2rgb = [](int y, int u, int v) -> Pixel
@@ -72,22 +35,22 @@ RgbHandler TickDetector::colorConvert(const BufferHandler &bufferHandler)
         return std::make_tuple(r1, g1, b1);
     };
 
-    RgbHandler rgb = allocate();
-    if (!rgb.mStart)
+    FrameHandle rgb = mConfig.pool->allocate();
+    if (!rgb)
     {
         return rgb;
     }
+    uint8_t *out = rgb.data();
 
     // Pixels are YU and YV alternating, so YUYV which is 4 bytes. We want RGB, so RGBRGB which is 6 bytes.
     auto pptr = reinterpret_cast<uint8_t *>(bufferHandler.mStart);
     for (int i = 0, newi = 0; i < bufferHandler.mSize; i = i + 4, newi = newi + 6)
     {
-        std::tie(rgb.mStart[newi], rgb.mStart[newi + 1], rgb.mStart[newi + 2]) =
-            yuv2rgb(pptr[i], pptr[i + 1], pptr[i + 3]);
-        std::tie(rgb.mStart[newi + 3], rgb.mStart[newi + 4], rgb.mStart[newi + 5]) =
+        std::tie(out[newi], out[newi + 1], out[newi + 2]) = yuv2rgb(pptr[i], pptr[i + 1], pptr[i + 3]);
+        std::tie(out[newi + 3], out[newi + 4], out[newi + 5]) =
             yuv2rgb(pptr[i + 2], pptr[i + 1], pptr[i + 3]);
     }
-    rgb.mSize = ((bufferHandler.mSize * 6) / 4);
+    rgb.setSize((bufferHandler.mSize * 6) / 4);
     syslog(LOG_CRIT, "TickDetector: Finished converting pixels %lf\n", floatTime() - mConfig.startTime);
     return rgb;
 }
@@ -107,26 +70,28 @@ uint32_t TickDetector::sumDifference(size_t size, const uint8_t *newImg, const u
 }
 
 
-RgbHandler TickDetector::execute(BufferHandler &yuyvHandler)
+FrameHandle TickDetector::execute(BufferHandler &yuyvHandler)
 {
-    RgbHandler rgb = colorConvert(yuyvHandler);
-    if (!rgb.mStart)
+    FrameHandle rgb = colorConvert(yuyvHandler);
+    if (!rgb)
     {
         syslog(LOG_CRIT, "TickDetector: Failed to allocate rgb buffer.");
         exit(EXIT_FAILURE);
     }
+    const struct timeval &ts = yuyvHandler.mBuf.timestamp;
+    rgb.setTimestamp(static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_usec) / 1000000.0);
 
     if (mCount == 0)
     {
-        mExpectedSize = rgb.mSize;
-        mOldImage = rgb;
-        mMaxDiff = static_cast<double>(rgb.mSize) * 255.0;
+        mExpectedSize = rgb.size();
+        mMaxDiff = static_cast<double>(rgb.size()) * 255.0;
+        mOldImage = std::move(rgb);
         syslog(LOG_CRIT, "TickDetector: mMaxDiff is %lf\n", mMaxDiff);
         ++mCount;
-        return RgbHandler{};
+        return FrameHandle{};
     }
 
-    if (mExpectedSize != rgb.mSize)
+    if (mExpectedSize != rgb.size())
     {
         printf("Expected image size and actual image size don't match");
         exit(EXIT_FAILURE);
@@ -134,10 +99,11 @@ RgbHandler TickDetector::execute(BufferHandler &yuyvHandler)
 
     ++mCount;
     double timeNow = floatTime() - mConfig.startTime;
-    uint32_t sum = sumDifference(mExpectedSize, rgb.mStart, mOldImage.mStart);
+    uint32_t sum = sumDifference(mExpectedSize, rgb.data(), mOldImage.data());
     double percentDiff = static_cast<double>(sum) / mMaxDiff;
-    syslog(LOG_CRIT, "TickDetector: time %lf, percent diff %lf, cnt %u, sum %u\n", timeNow, percentDiff, mCount, sum);
-    rgb.mIsTick = false;
+    syslog(LOG_CRIT, "TickDetector: time %lf, percent diff %lf, cnt %zu, sum %u\n", timeNow, percentDiff, mCount, sum);
+    rgb.setTick(false);
+    mEstimator.push(percentDiff, mOldImage.timestamp(), rgb.timestamp());
 
     if (mState == ImgState::Still && percentDiff > sMovingThreshold)
     {
@@ -146,12 +112,20 @@ RgbHandler TickDetector::execute(BufferHandler &yuyvHandler)
     else if (mState == ImgState::Moving && percentDiff < sStillThreshold)
     {
         mState = ImgState::Still;
-        rgb.mIsTick = true;
-        syslog(LOG_CRIT, "TickDetector: tick on image %u\n", mCount);
+        rgb.setTick(true);
+        TickEstimator::Estimate est = mEstimator.estimate(sStillThreshold);
+        if (!est.valid)
+        {
+            // Without a pulse to fit, the tick is only known to the frame it was detected on.
+            est.time = rgb.timestamp();
+            est.error = rgb.timestamp() - mOldImage.timestamp();
+        }
+        rgb.setTickTime(est.time, est.error);
+        syslog(LOG_CRIT, "TickDetector: tick on image %zu at %lf +- %lf\n", mCount, est.time, est.error);
     }
 
-    RgbHandler returnImage = mOldImage;
-    mOldImage = rgb;
+    FrameHandle returnImage = std::move(mOldImage);
+    mOldImage = std::move(rgb);
 
     if (mConfig.showDiff)
     {
@@ -167,7 +141,7 @@ RgbHandler TickDetector::execute(BufferHandler &yuyvHandler)
             }
         };
 
-        modImg(mExpectedSize, mOldImage.mStart, returnImage.mStart);
+        modImg(mExpectedSize, mOldImage.data(), returnImage.data());
     }
 
     return returnImage;
@@ -3,14 +3,14 @@
 #include <cstddef>
 #include <cstdint>
 #include <tuple>
-#include <mutex>
-#include <queue>
 
-#include "rgb_handler.hpp"
 #include "buffer_handler.hpp"
+#include "frame_handle.hpp"
+#include "frame_pool.hpp"
+#include "tick_estimator.hpp"
 
 
-class TickDetector final : public RgbHandler::Allocator
+class TickDetector final
 {
 public:
     ///////////////////////////////////////////////////////////////////////////
@@ -26,12 +26,11 @@ public:
     // PUBLIC TYPES
     ///////////////////////////////////////////////////////////////////////////
 
-    using RgbBuffer = uint8_t[sBufferSize];
-
     struct Config
     {
         double startTime;
         bool showDiff;
+        FramePool *pool;
     };
 
     enum class ImgState
@@ -46,18 +45,9 @@ public:
     // PUBLIC FUNCTIONS
     ///////////////////////////////////////////////////////////////////////////
 
-    /// Initialize the available queue to allocate RGB buffers to the applications.
-    TickDetector();
-
-    /// COnfiguration setter.
+    /// COnfiguration setter. The RGB buffers are allocated from `cfg.pool`.
     void setConfig(const Config &cfg);
 
-    /// Places a RGB buffer back on the available queue.
-    void returnBuffer(RgbHandler &handler) override;
-
-    /// Get a RGB buffer from the queue. The RgbHandler::mStart field is nullptr if no buffers are available.
-    RgbHandler allocate(void);
-
     /// This is probably the most acceptable conversion from camera YUYV to RGB
     ///
     /// Wikipedia has a good discussion on the details of various conversions and cites good references:
@@ -74,7 +64,7 @@ public:
     ///      YUV420, where for every 4 Ys, there is a single UV pair, 1.5 bytes for each pixel or 36 bytes for 24
     ///              pixels
     //void colorConvert(const unsigned char *pptr, int size);
-    RgbHandler colorConvert(const BufferHandler &bufferHandler);
+    FrameHandle colorConvert(const BufferHandler &bufferHandler);
 
     /// Sum the difference between the Y (grey) pixels of two YUYV images.
     uint32_t sumDifference(size_t size, const uint8_t *newImg, const uint8_t *oldImg) const;
@@ -85,8 +75,8 @@ public:
     /// 3. Take the sum of the difference as a percentage of the max difference possible.
     /// 4. Threshold with hystersis the percentage difference to determine when a transition has been made.
     ///
-    /// We return true on the transition from moving to still.
-    RgbHandler execute(BufferHandler &yuyvHandler);
+    /// The returned frame is flagged as a tick on the transition from moving to still.
+    FrameHandle execute(BufferHandler &yuyvHandler);
 
 private:
     ///////////////////////////////////////////////////////////////////////////
@@ -94,12 +84,10 @@ private:
     ///////////////////////////////////////////////////////////////////////////
 
     Config mConfig;
-    RgbHandler mOldImage;
+    FrameHandle mOldImage;
     double mMaxDiff;
     size_t mCount{0};
     size_t mExpectedSize;
     ImgState mState{ImgState::Still};
-    std::mutex mRgbQueueMutex;
-    std::queue<RgbHandler> mAvailable;
-    RgbBuffer mBuffers[sNumOfBuffers];
+    TickEstimator mEstimator;
 };
@@ -2,7 +2,7 @@
 #include <syslog.h>
 
 #include "buffer_handler.hpp"
-#include "rgb_handler.hpp"
+#include "frame_handle.hpp"
 #include "tick_detector_service.hpp"
 #include "util.hpp"
 
@@ -21,6 +21,13 @@ void TickDetectorService::service(void)
     mqd_t inmq = mq_open(mConfig.inQueue, O_CREAT | O_RDWR, S_IRWXU, &mConfig.inMqAttr);
     mqd_t outmq = mq_open(mConfig.outQueue, O_CREAT | O_RDWR, S_IRWXU, &mConfig.outMqAttr);
 
+    // The export queue is non-blocking so a stalled exporter drops frames instead of stalling this service.
+    mqd_t exportmq = -1;
+    if (mConfig.exportQueue)
+    {
+        exportmq = mq_open(mConfig.exportQueue, O_CREAT | O_RDWR | O_NONBLOCK, S_IRWXU, &mConfig.exportMqAttr);
+    }
+
     while (!doExit())
     {
         syslog(LOG_CRIT, "TickDetectorService: awaiting frame\n");
@@ -44,17 +51,30 @@ void TickDetectorService::service(void)
             }
         }
 
-        RgbHandler rgbHandler = mTickDetector.execute(handler);
+        FrameHandle rgb = mTickDetector.execute(handler);
         handler.returnBuffer();
 
-        if (rgbHandler.mStart)
+        if (rgb && exportmq != -1 && (rgb.isTick() || mConfig.exportAll))
+        {
+            FrameHandle exported = rgb.share();
+            FrameIndex index = exported.detach();
+            if (-1 == mq_send(exportmq, reinterpret_cast<char *>(&index), sizeof(FrameIndex), sOutQueuePrio))
+            {
+                // Take the reference back so the frame returns to the pool.
+                mConfig.tickDetectorConfig.pool->adopt(index);
+            }
+        }
+
+        if (rgb)
         {
-            int rc = mq_send(outmq, reinterpret_cast<char *>(&rgbHandler), sizeof(RgbHandler), sOutQueuePrio);
+            FrameIndex index = rgb.detach();
+            int rc = mq_send(outmq, reinterpret_cast<char *>(&index), sizeof(FrameIndex), sOutQueuePrio);
             if (rc == -1)
             {
                 errnoExit("TickDetectorService: send");
             }
         }
+        countFrame();
     }
     syslog(LOG_CRIT, "TickDetectorService: exiting");
 }
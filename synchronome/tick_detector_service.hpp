@@ -28,6 +28,13 @@ public:
         unsigned int priority;
         const char *inQueue;
         const char *outQueue;
+
+        /// Optional queue that frames are shared to for the ExportService, nullptr to disable. Only ticks are
+        /// exported unless `exportAll` is set. `exportMqAttr` should hold fewer messages than the frame pool has
+        /// buffers, every queued frame holds a pool reference until the exporter takes it.
+        const char *exportQueue;
+        struct mq_attr exportMqAttr;
+        bool exportAll;
     };
 
     ///////////////////////////////////////////////////////////////////////////
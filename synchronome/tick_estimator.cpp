@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cmath>
+
+#include "tick_estimator.hpp"
+
+
+void TickEstimator::push(double percentDiff, double startTime, double endTime)
+{
+    mSamples[mHead] = Sample{percentDiff, startTime, endTime};
+    mHead = (mHead + 1) % sHistory;
+    mCount = std::min(mCount + 1, sHistory);
+}
+
+
+TickEstimator::Estimate TickEstimator::estimate(double stillThreshold)
+{
+    // Walk back over the pulse, the samples above the still threshold before the latest one.
+    size_t first = 1;
+    while (first < mCount && sample(first).diff > stillThreshold)
+    {
+        ++first;
+    }
+    size_t pulseLength = first - 1;
+    if (pulseLength == 0)
+    {
+        return Estimate{0.0, 0.0, false};
+    }
+    const Sample &onset = sample(pulseLength);
+    double interval = onset.endTime - onset.startTime;
+
+    // The motion can start in the interval before the onset by too little to cross the still threshold, so that
+    // interval is kept out of the noise floor.
+    bool havePre = pulseLength + 1 < mCount;
+    const Sample &pre = sample(pulseLength + 1);
+
+    // The still frames before the pulse give the noise floor.
+    double sum = 0.0, sumSq = 0.0;
+    size_t n = 0;
+    for (size_t age = pulseLength + 2; age < mCount && n < sBaselineSamples; ++age, ++n)
+    {
+        sum += sample(age).diff;
+        sumSq += sample(age).diff * sample(age).diff;
+    }
+    double baseline = n ? sum / n : 0.0;
+    double noise = n > 1 ? std::sqrt(std::max(0.0, (sumSq - n * baseline * baseline) / (n - 1))) : stillThreshold;
+
+    // The spread of the frame intervals gives the timestamp jitter.
+    sum = sumSq = 0.0;
+    for (size_t age = 0; age < mCount; ++age)
+    {
+        double dt = sample(age).endTime - sample(age).startTime;
+        sum += dt;
+        sumSq += dt * dt;
+    }
+    double meanInterval = sum / mCount;
+    double jitter = std::sqrt(std::max(0.0, sumSq / mCount - meanInterval * meanInterval) / 2.0);
+
+    // The interior of the pulse is fully covered by the motion.
+    for (size_t age = 2; age < pulseLength; ++age)
+    {
+        const Sample &s = sample(age);
+        double rate = (s.diff - baseline) / (s.endTime - s.startTime);
+        if (mRateSamples == 0)
+        {
+            mRate = rate;
+            mRateSq = rate * rate;
+        }
+        mRate += sRateGain * (rate - mRate);
+        mRateSq += sRateGain * (rate * rate - mRateSq);
+        ++mRateSamples;
+    }
+
+    // Until a rate has been learned only the onset interval is known.
+    if (mRateSamples < sMinRateSamples || mRate <= 0.0)
+    {
+        return Estimate{onset.startTime + 0.5 * interval, 0.5 * interval, true};
+    }
+
+    // Each difference carries the noise of the sample and of the mean floor it is measured against.
+    double sampleSigma = noise * std::sqrt(1.0 + 1.0 / std::max<size_t>(n, 1)) / mRate;
+    double lead = (onset.diff - baseline) / mRate;
+    double leadVar = sampleSigma * sampleSigma;
+
+    // A fully covered onset may only be the first interval to cross the still threshold, the rest of the motion is in
+    // the interval before.
+    if (havePre && lead > interval - 3.0 * sampleSigma)
+    {
+        lead = interval + std::clamp((pre.diff - baseline) / mRate, 0.0, pre.endTime - pre.startTime);
+        leadVar += sampleSigma * sampleSigma;
+    }
+    lead = std::max(lead, 0.0);
+
+    // The learned rate scales the whole lead, so its spread matters most for early starts.
+    double rateSpread = std::sqrt(std::max(0.0, mRateSq - mRate * mRate)) / mRate;
+    double sigma = std::sqrt(leadVar + lead * lead * rateSpread * rateSpread + jitter * jitter);
+
+    // An estimate less certain than the frame interval is no better than the detection itself.
+    return Estimate{onset.endTime - lead, 2.0 * sigma, 2.0 * sigma <= interval};
+}
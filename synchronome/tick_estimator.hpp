@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+
+/// Estimates when a tick happened to better than the frame period. Each frame difference measures how much the
+/// second hand moved between two captures. While the hand moves at a steady rate, a frame interval that only partly
+/// overlaps the motion has a proportionally smaller difference than a fully covered interval. So the difference of the
+/// first interval of the motion pulse, divided by the rate of motion, gives how long before the end of that interval
+/// the motion started. The hand moves the same way every tick, so the rate is learned from the fully covered interior
+/// samples of previous pulses.
+class TickEstimator
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    // PUBLIC CONSTANTS
+    ///////////////////////////////////////////////////////////////////////////
+
+    static constexpr size_t sHistory = 32;
+    static constexpr size_t sBaselineSamples = 16;
+    static constexpr double sRateGain = 0.1;
+    static constexpr size_t sMinRateSamples = 4;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PUBLIC TYPES
+    ///////////////////////////////////////////////////////////////////////////
+
+    struct Estimate
+    {
+        /// The estimated tick instant in the same clock as the frame timestamps.
+        double time;
+
+        /// Two standard deviations of the estimate, from the noise of each difference used and of the floor, the spread
+        /// of the learned rate and the jitter of the frame timestamps.
+        double error;
+
+        /// False when the error is wider than the frame interval, the frame timestamp is then as good.
+        bool valid;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PUBLIC FUNCTIONS
+    ///////////////////////////////////////////////////////////////////////////
+
+    /// Records the difference between the frames captured at `startTime` and `endTime`.
+    void push(double percentDiff, double startTime, double endTime);
+
+    /// Locates the motion pulse that has just ended, the latest sample must be below `stillThreshold`. The interior of
+    /// the pulse updates the learned rate of motion.
+    Estimate estimate(double stillThreshold);
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // PRIVATE TYPES
+    ///////////////////////////////////////////////////////////////////////////
+
+    struct Sample
+    {
+        double diff;
+        double startTime;
+        double endTime;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PRIVATE FUNCTIONS
+    ///////////////////////////////////////////////////////////////////////////
+
+    /// Sample `age` pushes ago, zero is the latest.
+    const Sample &sample(size_t age) const { return mSamples[(mHead + sHistory - 1 - age) % sHistory]; }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // PRIVATE FIELDS
+    ///////////////////////////////////////////////////////////////////////////
+
+    Sample mSamples[sHistory];
+    size_t mHead{0};
+    size_t mCount{0};
+
+    /// Running mean and mean square of the difference per second while the hand is moving.
+    double mRate{0.0};
+    double mRateSq{0.0};
+    size_t mRateSamples{0};
+};
@@ -0,0 +1,128 @@
+#include <cmath>
+#include <random>
+
+#include "popl.hpp"
+
+#include "tick_detector.hpp"
+#include "tick_estimator.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+// TOP LEVEL FUNCTIONS
+///////////////////////////////////////////////////////////////////////////////
+
+/// Replays synthetic frame difference sequences through the same hysteresis as TickDetector and through the
+/// TickEstimator. Each second the hand starts moving at a known instant and moves at a steady rate for a random
+/// duration, frames arrive every 40 ms with timestamp jitter and the differences have a noisy floor. Prints the error
+/// of the frame-quantized tick time and of the estimate, and how often the truth fell inside the reported bound.
+/// Detections outside any tick's motion are counted as spurious, and estimates the estimator rejects as no better than
+/// the frame are counted apart. Exits with failure when the coverage of the accepted estimates is below `-c`.
+int main(int argc, char **argv)
+{
+    using namespace popl;
+    OptionParser op("Allowed options");
+    auto ticksOpt = op.add<Value<int>>("n", "ticks", "Number of ticks to simulate", 1000);
+    auto noiseOpt = op.add<Value<double>>("s", "noise", "Standard deviation of the difference floor", 0.0001);
+    auto jitterOpt = op.add<Value<double>>("j", "jitter", "Standard deviation of frame timestamps in seconds", 0.001);
+    auto coverageOpt = op.add<Value<double>>("c", "coverage", "Least fraction of ticks within the bound to pass", 0.95);
+    auto helpOpt = op.add<Switch>("h", "help", "Show help message");
+    op.parse(argc, argv);
+    if (helpOpt->is_set())
+    {
+        std::cout << op << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    constexpr double framePeriod = 0.040;
+    constexpr double floorLevel = 0.0005;
+    constexpr double amplitude = 0.01;
+
+    std::mt19937 rng(5623);
+    std::normal_distribution<double> noise(0.0, noiseOpt->value());
+    std::normal_distribution<double> jitter(0.0, jitterOpt->value());
+    std::uniform_real_distribution<double> phase(0.0, framePeriod);
+    std::uniform_real_distribution<double> duration(0.050, 0.120);
+
+    TickEstimator estimator;
+    TickDetector::ImgState state = TickDetector::ImgState::Still;
+    double prevTime = 0.0;
+
+    // Each tick gets its own phase against the frames, so the whole sub-frame range is exercised.
+    double tickSecond = 0.5;
+    double tickStart = tickSecond + phase(rng);
+    double tickDuration = duration(rng);
+    bool tickDetected = false;
+
+    int ticks = 0, detected = 0, spurious = 0, rejected = 0, inBound = 0;
+    double quantSum = 0.0, quantMax = 0.0, estSum = 0.0, estMax = 0.0, boundSum = 0.0;
+
+    for (int frame = 1; ticks < ticksOpt->value(); ++frame)
+    {
+        double time = frame * framePeriod + jitter(rng);
+
+        // The difference is proportional to how much of the motion falls between the two captures.
+        double overlap = std::max(0.0, std::min(time, tickStart + tickDuration) - std::max(prevTime, tickStart));
+        double diff = floorLevel + noise(rng) + amplitude * overlap / framePeriod;
+        estimator.push(diff, prevTime, time);
+
+        if (state == TickDetector::ImgState::Still && diff > TickDetector::sMovingThreshold)
+        {
+            state = TickDetector::ImgState::Moving;
+        }
+        else if (state == TickDetector::ImgState::Moving && diff < TickDetector::sStillThreshold)
+        {
+            state = TickDetector::ImgState::Still;
+            TickEstimator::Estimate est = estimator.estimate(TickDetector::sStillThreshold);
+            // Only the first detection after the tick started can be the tick.
+            if (time < tickStart || tickDetected)
+            {
+                ++spurious;
+                prevTime = time;
+                continue;
+            }
+            ++detected;
+            tickDetected = true;
+            if (!est.valid)
+            {
+                ++rejected;
+                prevTime = time;
+                continue;
+            }
+            double quantError = std::fabs(time - tickStart);
+            double estError = std::fabs(est.time - tickStart);
+            quantSum += quantError;
+            quantMax = std::max(quantMax, quantError);
+            estSum += estError;
+            estMax = std::max(estMax, estError);
+            boundSum += est.error;
+            inBound += estError <= est.error;
+        }
+
+        prevTime = time;
+        if (time > tickStart + tickDuration + 2 * framePeriod)
+        {
+            ++ticks;
+            tickSecond += 1.0;
+            tickStart = tickSecond + phase(rng);
+            tickDuration = duration(rng);
+            tickDetected = false;
+        }
+    }
+
+    int accepted = detected - rejected;
+    double coverage = accepted ? static_cast<double>(inBound) / accepted : 0.0;
+    printf("ticks %d, detected %d, spurious %d, estimates rejected %d\n", ticks, detected, spurious, rejected);
+    if (accepted == 0)
+    {
+        printf("FAIL: no accepted estimates\n");
+        return EXIT_FAILURE;
+    }
+    printf("frame quantized: mean error %.3f ms, max %.3f ms\n", 1000.0 * quantSum / accepted, 1000.0 * quantMax);
+    printf("estimated:       mean error %.3f ms, max %.3f ms\n", 1000.0 * estSum / accepted, 1000.0 * estMax);
+    printf("mean bound %.3f ms, truth within bound %.1f%%\n", 1000.0 * boundSum / accepted, 100.0 * coverage);
+    if (coverage < coverageOpt->value())
+    {
+        printf("FAIL: coverage below %.1f%%\n", 100.0 * coverageOpt->value());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
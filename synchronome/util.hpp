@@ -3,6 +3,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <string>
 #include <sys/ioctl.h>
 
@@ -14,10 +15,11 @@ void clear(T &dest)
 }
 
 
-/// Convience function to print an error message to std::err and then exit.
-inline void errnoExit(std::string s)
+/// Convience function to print an error message to std::err and then exit. `detail` is appended to the message, it
+/// takes C strings so the error paths of the real-time services don't allocate.
+inline void errnoExit(const char *s, const char *detail = "")
 {
-    fprintf(stderr, "%s error %d, %s\n", s.c_str(), errno, strerror(errno));
+    fprintf(stderr, "%s%s error %d, %s\n", s, detail, errno, strerror(errno));
     exit(EXIT_FAILURE);
 }
 